@@ -31,6 +31,42 @@ VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
 #include <atomic>
 #include <chrono>
 #include <filesystem>
+#include <unordered_map>
+#include <numeric>
+#include <span>
+#include <charconv>
+#include <bit>
+#include <mutex>
+#include <condition_variable>
+#include <set>
+#include <future>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <stdexcept>
+
+/*Platform includes, file memory mapping*/
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/*SIMD includes, bounding volumes*/
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOULKAN_SSE
+#include <immintrin.h>
+#endif
+#if defined(SOULKAN_SSE) && defined(__AVX2__)
+#define SOULKAN_AVX2
+#endif
 
 /*GLM includes*/
 #include <glm.hpp>
@@ -190,6 +226,22 @@ namespace SOULKAN_NAMESPACE
 		independentThread.detach(); //Let it do its thing away from our render loop
 	}
 
+	//Calls function(c) for every chunk c in [0, chunkCount), each chunk on its own thread, returns once every chunk is done
+	void parallelChunks(size_t chunkCount, std::function<void(size_t)>&& function)
+	{
+		std::vector<std::thread> threads;
+		threads.reserve(chunkCount - 1);
+
+		for (size_t c = 1; c < chunkCount; c++)
+		{
+			threads.emplace_back(function, c);
+		}
+
+		function(0); //Calling thread takes the first chunk
+
+		for (auto& t : threads) { t.join(); }
+	}
+
 	void waitingForOperation(ref<std::map<std::string, bool>> operationsStatus, std::string operationName, bool log = false)
 	{
 		if (operationsStatus.get().find(operationName) == operationsStatus.get().end())
@@ -231,6 +283,556 @@ namespace SOULKAN_NAMESPACE
 			waitingForOperations = !operationsFinished;
 		}
 	}
+	//Read only memory mapping of a whole file, the OS pages it in on demand instead of copying it through iostreams
+	//Non copyable movable
+	class MappedFile : Destroyable
+	{
+	public:
+		MappedFile(std::string filename) : filename_(filename)
+		{
+#ifdef _WIN32
+			file_ = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (file_ == INVALID_HANDLE_VALUE) { KILL(std::format("Could not open following file : {}", filename)); }
+
+			LARGE_INTEGER fileSize = {};
+			GetFileSizeEx(file_, &fileSize);
+			size_ = static_cast<size_t>(fileSize.QuadPart);
+
+			if (size_ == 0) { return; } //INFO:Empty files can not be mapped
+
+			mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mapping_ == nullptr) { KILL(std::format("Could not map following file : {}", filename)); }
+
+			data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+#else
+			file_ = open(filename.c_str(), O_RDONLY);
+			if (file_ < 0) { KILL(std::format("Could not open following file : {}", filename)); }
+
+			struct stat fileStat = {};
+			fstat(file_, &fileStat);
+			size_ = static_cast<size_t>(fileStat.st_size);
+
+			if (size_ == 0) { return; } //INFO:Empty files can not be mapped
+
+			void* mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file_, 0);
+			if (mapped == MAP_FAILED) { KILL(std::format("Could not map following file : {}", filename)); }
+
+			madvise(mapped, size_, MADV_SEQUENTIAL);
+			data_ = static_cast<const char*>(mapped);
+#endif
+			if (data_ == nullptr) { KILL(std::format("Could not map following file : {}", filename)); }
+		}
+
+		MappedFile(MappedFile&& other) noexcept : filename_(other.filename_), data_(other.data_), size_(other.size_),
+			file_(other.file_), mapping_(other.mapping_)
+		{
+			destroyed_ = other.destroyed_;
+			other.destroyed_ = true;
+
+			manual_ = other.manual_;
+			other.manual_ = false;
+
+			other.data_ = nullptr;
+			other.size_ = 0;
+		}
+
+		MappedFile& operator=(MappedFile&& other) noexcept
+		{
+			destroy();
+
+			destroyed_ = other.destroyed_;
+			other.destroyed_ = true;
+
+			manual_ = other.manual_;
+			other.manual_ = false;
+
+			filename_ = other.filename_;
+
+			data_ = other.data_;
+			other.data_ = nullptr;
+
+			size_ = other.size_;
+			other.size_ = 0;
+
+			file_ = other.file_;
+			mapping_ = other.mapping_;
+
+			return *this;
+		}
+
+		//No copy constructors
+		MappedFile(MappedFile& other) = delete;
+		MappedFile& operator=(MappedFile& other) = delete;
+
+		void destroy()
+		{
+			if (destroyed_) { return; }
+#ifdef _WIN32
+			if (data_ != nullptr) { UnmapViewOfFile(data_); }
+			if (mapping_ != nullptr) { CloseHandle(mapping_); }
+			if (file_ != INVALID_HANDLE_VALUE) { CloseHandle(file_); }
+#else
+			if (data_ != nullptr) { munmap(const_cast<char*>(data_), size_); }
+			if (file_ >= 0) { close(file_); }
+#endif
+			destroyed_ = true;
+		}
+
+		~MappedFile()
+		{
+			if (manual_) { return; }
+			destroy();
+		}
+
+		std::string filename() const { return filename_; }
+		const char* data() const { return data_; }
+		size_t size() const { return size_; }
+
+	private:
+		std::string filename_ = "";
+		const char* data_ = nullptr;
+		size_t size_ = 0;
+
+#ifdef _WIN32
+		HANDLE file_ = INVALID_HANDLE_VALUE;
+		HANDLE mapping_ = nullptr;
+#else
+		int file_ = -1;
+		int mapping_ = -1; //INFO:Unused, the file descriptor is enough to map on POSIX
+#endif
+	};
+
+	/*---------------------PARSING---------------------*/
+	//INFO:Helpers for text formats (.obj, .mtl, glTF JSON), they read from [p, end) and advance p past what they parsed
+
+	bool isDigit(char c)
+	{
+		return static_cast<unsigned char>(c - '0') < 10;
+	}
+
+	//INFO:SWAR (SIMD within a register), checks that the 8 bytes of chunk are all ascii digits
+	bool eightDigits(uint64_t chunk)
+	{
+		return (((chunk & 0xF0F0F0F0F0F0F0F0) | (((chunk + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) == 0x3333333333333333);
+	}
+
+	//INFO:SWAR conversion of 8 ascii digits (little endian load) to their value, 3 multiplications instead of 8
+	uint32_t parseEightDigits(uint64_t chunk)
+	{
+		chunk -= 0x3030303030303030;
+		chunk = (chunk * 10) + (chunk >> 8);
+		chunk = (((chunk & 0x000000FF000000FF) * 0x000F424000000064) + (((chunk >> 16) & 0x000000FF000000FF) * 0x0000271000000001)) >> 32;
+
+		return static_cast<uint32_t>(chunk);
+	}
+
+	//Accumulates digits into mantissa, 8 at a time while they fit in 19 digits, returns the number of digits read
+	size_t parseDigits(const char*& p, const char* end, uint64_t& mantissa, size_t digits)
+	{
+		const char* start = p;
+
+		while (end - p >= 8 && digits + (p - start) + 8 <= 19)
+		{
+			uint64_t chunk;
+			memcpy(&chunk, p, sizeof(chunk));
+			if (!eightDigits(chunk)) { break; }
+
+			mantissa = mantissa * 100'000'000 + parseEightDigits(chunk);
+			p += 8;
+		}
+
+		while (p < end && isDigit(*p))
+		{
+			if (digits + (p - start) < 19) { mantissa = mantissa * 10 + (*p - '0'); }
+			else { digits = 20; } //INFO:Too many digits for the fast path, value gets parsed again by from_chars
+			p++;
+		}
+
+		return digits + (p - start);
+	}
+
+	//Parses a decimal float, through a double computed directly when the mantissa and power of ten fit in it (Clinger's fast path), from_chars otherwise
+	bool parseFloat(const char*& p, const char* end, float& value)
+	{
+		static constexpr double powersOfTen[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+												  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+		const char* start = p;
+
+		bool negative = (p < end && *p == '-');
+		if (p < end && (*p == '-' || *p == '+')) { p++; }
+
+		const char* numberStart = p;
+
+		uint64_t mantissa = 0;
+		size_t digits = parseDigits(p, end, mantissa, 0);
+		int64_t exponent = 0;
+
+		if (p < end && *p == '.')
+		{
+			p++;
+			const char* fractionStart = p;
+			digits = parseDigits(p, end, mantissa, digits);
+			exponent -= (p - fractionStart);
+		}
+
+		if (p == numberStart || (p == numberStart + 1 && *numberStart == '.'))
+		{
+			p = start;
+			return false; //No digits
+		}
+
+		if (p < end && (*p == 'e' || *p == 'E'))
+		{
+			const char* exponentStart = p;
+			p++;
+
+			bool negativeExponent = (p < end && *p == '-');
+			if (p < end && (*p == '-' || *p == '+')) { p++; }
+
+			if (p < end && isDigit(*p))
+			{
+				int64_t explicitExponent = 0;
+				while (p < end && isDigit(*p))
+				{
+					if (explicitExponent < 100'000) { explicitExponent = explicitExponent * 10 + (*p - '0'); }
+					p++;
+				}
+				exponent += negativeExponent ? -explicitExponent : explicitExponent;
+			}
+			else
+			{
+				p = exponentStart; //Not an exponent, "1e" is 1
+			}
+		}
+
+		if (digits <= 19 && mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22)
+		{
+			double result = static_cast<double>(mantissa);
+			result = (exponent < 0) ? result / powersOfTen[-exponent] : result * powersOfTen[exponent];
+
+			value = static_cast<float>(negative ? -result : result);
+			return true;
+		}
+
+		//Slow but exact path
+		double result = 0.0;
+		auto [last, error] = std::from_chars(numberStart, p, result);
+		if (error != std::errc()) { p = start; return false; }
+
+		value = static_cast<float>(negative ? -result : result);
+		return true;
+	}
+
+	bool parseInt(const char*& p, const char* end, int32_t& value)
+	{
+		bool negative = (p < end && *p == '-');
+		if (p < end && (*p == '-' || *p == '+')) { p++; }
+
+		if (p == end || !isDigit(*p)) { return false; }
+
+		int64_t result = 0;
+		while (p < end && isDigit(*p))
+		{
+			result = result * 10 + (*p - '0');
+			p++;
+		}
+
+		value = static_cast<int32_t>(negative ? -result : result);
+		return true;
+	}
+
+	void skipSpaces(const char*& p, const char* end)
+	{
+		while (p < end && (*p == ' ' || *p == '\t')) { p++; }
+	}
+
+	//Returns the start of the next line, or end
+	const char* nextLine(const char* p, const char* end)
+	{
+		const char* newLine = static_cast<const char*>(memchr(p, '\n', end - p));
+		return newLine == nullptr ? end : newLine + 1;
+	}
+
+	//Minimal JSON document (RFC 8259), enough for glTF, parsed recursively from [p, end)
+	//INFO:Objects keep their members in file order in a vector, glTF objects are small and read once
+	//Copyable movable
+	class JsonValue
+	{
+	public:
+		enum class Type
+		{
+			NUL,
+			BOOLEAN,
+			NUMBER,
+			STRING,
+			ARRAY,
+			OBJECT
+		};
+
+		JsonValue() = default;
+
+		static JsonValue parse(const char* data, size_t size)
+		{
+			const char* p = data;
+			const char* end = data + size;
+
+			JsonValue value;
+			if (!value.parseValue(p, end, 0)) { KILL(std::format("Could not parse JSON at offset {}", p - data)); }
+
+			skipWhitespace(p, end);
+			if (p != end && *p != '\0') { KILL(std::format("Unexpected JSON content at offset {}", p - data)); } //INFO:GLB pads its JSON chunk with spaces, some writers with zeros
+
+			return value;
+		}
+
+		Type type() const { return type_; }
+		bool isNull() const { return type_ == Type::NUL; }
+
+		//Member of an object, a null value if missing or if this is not an object
+		const JsonValue& operator[](std::string_view key) const
+		{
+			for (const auto& [name, value] : members_)
+			{
+				if (name == key) { return value; }
+			}
+
+			return null();
+		}
+
+		//Element of an array, a null value if out of range or if this is not an array
+		const JsonValue& operator[](size_t index) const
+		{
+			return (type_ == Type::ARRAY && index < elements_.size()) ? elements_[index] : null();
+		}
+
+		bool contains(std::string_view key) const
+		{
+			return !(*this)[key].isNull();
+		}
+
+		//Element count of an array, member count of an object
+		size_t size() const
+		{
+			return (type_ == Type::ARRAY) ? elements_.size() : members_.size();
+		}
+
+		double number(double fallback = 0.0) const { return (type_ == Type::NUMBER) ? number_ : fallback; }
+		int64_t integer(int64_t fallback = 0) const { return (type_ == Type::NUMBER) ? static_cast<int64_t>(number_) : fallback; }
+		bool boolean(bool fallback = false) const { return (type_ == Type::BOOLEAN) ? boolean_ : fallback; }
+		std::string string(std::string fallback = "") const { return (type_ == Type::STRING) ? string_ : fallback; }
+
+		const std::vector<JsonValue>& elements() const { return elements_; }
+		const std::vector<std::pair<std::string, JsonValue>>& members() const { return members_; }
+	private:
+		Type type_ = Type::NUL;
+		bool boolean_ = false;
+		double number_ = 0.0;
+		std::string string_ = "";
+		std::vector<JsonValue> elements_{};
+		std::vector<std::pair<std::string, JsonValue>> members_{};
+
+		static constexpr size_t maxDepth_ = 256;
+
+		static const JsonValue& null()
+		{
+			static const JsonValue value;
+			return value;
+		}
+
+		static void skipWhitespace(const char*& p, const char* end)
+		{
+			while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) { p++; }
+		}
+
+		static bool consume(const char*& p, const char* end, std::string_view literal)
+		{
+			if (static_cast<size_t>(end - p) < literal.size() || std::string_view(p, literal.size()) != literal) { return false; }
+
+			p += literal.size();
+			return true;
+		}
+
+		bool parseValue(const char*& p, const char* end, size_t depth)
+		{
+			skipWhitespace(p, end);
+			if (p == end || depth > maxDepth_) { return false; }
+
+			switch (*p)
+			{
+			case '{':
+				type_ = Type::OBJECT;
+				return parseObject(p, end, depth);
+			case '[':
+				type_ = Type::ARRAY;
+				return parseArray(p, end, depth);
+			case '"':
+				type_ = Type::STRING;
+				return parseString(p, end, string_);
+			case 't':
+				type_ = Type::BOOLEAN;
+				boolean_ = true;
+				return consume(p, end, "true");
+			case 'f':
+				type_ = Type::BOOLEAN;
+				return consume(p, end, "false");
+			case 'n':
+				return consume(p, end, "null");
+			default:
+			{
+				type_ = Type::NUMBER;
+
+				auto [last, error] = std::from_chars(p, end, number_);
+				if (error != std::errc()) { return false; }
+
+				p = last;
+				return true;
+			}
+			}
+		}
+
+		bool parseObject(const char*& p, const char* end, size_t depth)
+		{
+			p++; //{
+			skipWhitespace(p, end);
+			if (p < end && *p == '}') { p++; return true; }
+
+			while (true)
+			{
+				std::string key;
+				skipWhitespace(p, end);
+				if (!parseString(p, end, key)) { return false; }
+
+				skipWhitespace(p, end);
+				if (p == end || *p != ':') { return false; }
+				p++;
+
+				JsonValue value;
+				if (!value.parseValue(p, end, depth + 1)) { return false; }
+				members_.push_back(std::make_pair(std::move(key), std::move(value)));
+
+				skipWhitespace(p, end);
+				if (p == end) { return false; }
+				if (*p == '}') { p++; return true; }
+				if (*p != ',') { return false; }
+				p++;
+			}
+		}
+
+		bool parseArray(const char*& p, const char* end, size_t depth)
+		{
+			p++; //[
+			skipWhitespace(p, end);
+			if (p < end && *p == ']') { p++; return true; }
+
+			while (true)
+			{
+				JsonValue value;
+				if (!value.parseValue(p, end, depth + 1)) { return false; }
+				elements_.push_back(std::move(value));
+
+				skipWhitespace(p, end);
+				if (p == end) { return false; }
+				if (*p == ']') { p++; return true; }
+				if (*p != ',') { return false; }
+				p++;
+			}
+		}
+
+		//INFO:\u escapes are written as UTF-8, surrogate pairs included
+		static bool parseString(const char*& p, const char* end, std::string& out)
+		{
+			if (p == end || *p != '"') { return false; }
+			p++;
+
+			while (p < end && *p != '"')
+			{
+				if (*p != '\\')
+				{
+					const char* run = p;
+					while (p < end && *p != '"' && *p != '\\') { p++; }
+					out.append(run, p);
+					continue;
+				}
+
+				p++;
+				if (p == end) { return false; }
+
+				char escaped = *p++;
+				switch (escaped)
+				{
+				case '"': out += '"'; break;
+				case '\\': out += '\\'; break;
+				case '/': out += '/'; break;
+				case 'b': out += '\b'; break;
+				case 'f': out += '\f'; break;
+				case 'n': out += '\n'; break;
+				case 'r': out += '\r'; break;
+				case 't': out += '\t'; break;
+				case 'u':
+				{
+					uint32_t codePoint = 0;
+					if (!parseHex(p, end, codePoint)) { return false; }
+
+					if (codePoint >= 0xD800 && codePoint < 0xDC00 && consume(p, end, "\\u"))
+					{
+						uint32_t low = 0;
+						if (!parseHex(p, end, low)) { return false; }
+						codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+					}
+
+					appendUtf8(out, codePoint);
+					break;
+				}
+				default:
+					return false;
+				}
+			}
+
+			if (p == end) { return false; }
+			p++; //Closing quote
+
+			return true;
+		}
+
+		static bool parseHex(const char*& p, const char* end, uint32_t& value)
+		{
+			if (end - p < 4) { return false; }
+
+			auto [last, error] = std::from_chars(p, p + 4, value, 16);
+			if (error != std::errc() || last != p + 4) { return false; }
+
+			p += 4;
+			return true;
+		}
+
+		static void appendUtf8(std::string& out, uint32_t codePoint)
+		{
+			if (codePoint < 0x80)
+			{
+				out += static_cast<char>(codePoint);
+			}
+			else if (codePoint < 0x800)
+			{
+				out += static_cast<char>(0xC0 | (codePoint >> 6));
+				out += static_cast<char>(0x80 | (codePoint & 0x3F));
+			}
+			else if (codePoint < 0x10000)
+			{
+				out += static_cast<char>(0xE0 | (codePoint >> 12));
+				out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+				out += static_cast<char>(0x80 | (codePoint & 0x3F));
+			}
+			else
+			{
+				out += static_cast<char>(0xF0 | (codePoint >> 18));
+				out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+				out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+				out += static_cast<char>(0x80 | (codePoint & 0x3F));
+			}
+		}
+	};
+
 	/*---------------------GLFW---------------------*/
 	class Window : Destroyable
 	{
@@ -591,9 +1193,12 @@ namespace SOULKAN_NAMESPACE
 	class Swapchain;
 	class Fence; //For Queue::submit
 	class Semaphore; //For Queue::submit
+	class TimelineSemaphore; //For Queue::submit
+	class UploadScheduler; //For Device::uploads
 
 	//QUEUE
 	//Implement a busy queue index system: if end user got a queue from device.getQueue, mark queue as busy. when user calls getQueue return appropriate queue family with available index
+	//INFO:Submits and presents lock the mutex the device keeps for the VkQueue (see Device::queueMutex), they can be made from any thread
 	class Queue
 	{
 	public:
@@ -630,6 +1235,10 @@ namespace SOULKAN_NAMESPACE
 
 		void submit(CommandBuffer& commandBuffer, Semaphore &waitSemaphore, Semaphore &signalSemaphore, Fence &fence);
 		void submit(CommandBuffer& commandBuffer, Fence& signalFence);
+		//Signals signalValue on timeline once commandBuffer completed, its commands waiting for each (timeline semaphore, value) pair first
+		void submit(CommandBuffer& commandBuffer, TimelineSemaphore& timeline, uint64_t signalValue, std::span<const std::pair<vk::Semaphore, uint64_t>> timelineWaits = {});
+		//Also waits for each (timeline semaphore, value) pair before vertex input, used to wait for uploads made on other queues
+		void submit(CommandBuffer& commandBuffer, Semaphore &waitSemaphore, Semaphore &signalSemaphore, Fence &fence, std::span<const std::pair<vk::Semaphore, uint64_t>> timelineWaits);
 
 		void present(Swapchain& swapchain, Semaphore &waitSemaphore, uint32_t imageIndex);//Defined after swapchain definition (alongside submit)
 
@@ -675,6 +1284,10 @@ namespace SOULKAN_NAMESPACE
 
 			enabledExtensions_.push_back(VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME);//INFO:Descriptors are backed by buffers
 
+			if (isSupported(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+			{
+				enabledExtensions_.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);//INFO:Heap usage and budget of the whole process, see Allocator::stats
+			}
 
 			std::vector<const char*> enabledExtensionsC;
 			enabledExtensionsC.reserve(enabledExtensions_.size());
@@ -697,6 +1310,8 @@ namespace SOULKAN_NAMESPACE
 			features12.runtimeDescriptorArray = true; //INFO:Descriptors in runtime arrays
 			features12.descriptorBindingVariableDescriptorCount = true; //INFO:Allows variable sized last binding in descriptor set
 
+			features12.timelineSemaphore = true; //INFO:Local buffer transfers are retired by polling timeline values instead of waiting fences
+
 
 			vk::PhysicalDeviceVulkan13Features features13 = {};
 			features13.dynamicRendering = true;
@@ -718,11 +1333,15 @@ namespace SOULKAN_NAMESPACE
 			VK_CHECK(physicalDevice_.createDevice(&deviceCreateInfo, nullptr, &device_));
 
 			VULKAN_HPP_DEFAULT_DISPATCHER.init(device_);
+
+			createUploadScheduler();
 		}
 
 		//TODO:Implement move constructors
+		//INFO:The upload scheduler is moved along, like every object of the device it keeps referring to the device it was created by
 		Device(Device&& other) noexcept : device_(other.device_), window_(other.window_), surface_(other.surface_),
-			queueFamilies_(other.queueFamilies_), physicalDevice_(physicalDevice_)
+			queueFamilies_(other.queueFamilies_), physicalDevice_(physicalDevice_), queueMutexes_(std::move(other.queueMutexes_)),
+			uploadScheduler_(std::move(other.uploadScheduler_))
 		{
 			destroyed_ = other.destroyed_;
 			other.destroyed_ = true;
@@ -765,6 +1384,10 @@ namespace SOULKAN_NAMESPACE
 			supportedExtensions_ = other.supportedExtensions_;
 			other.supportedExtensions_ = {};
 
+			queueMutexes_ = std::move(other.queueMutexes_);
+
+			uploadScheduler_ = std::move(other.uploadScheduler_);
+
 			return *this;
 		}
 
@@ -772,32 +1395,61 @@ namespace SOULKAN_NAMESPACE
 		Device(Device& other) = delete;
 		Device& operator=(Device& other) = delete;
 
-		void destroy()
-		{
-			if (destroyed_) { return; }
-			device_.destroy();
-			destroyed_ = true;
-		}
+		void destroy(); //Defined after UploadScheduler definition
 
 		~Device()
 		{
 			if (manual_) { return; }
 			destroy();
 		}
-		//TODO:Implement generic destroy, calling getProcAddr to get correct destroyFunction according to type of parameter
-		//Fence
-
-		void waitFence(Fence &fence);
 
-		void resetFence(Fence &fence);
+		//Batches the copies of every local buffer and image of the device into one submit per frame
+		UploadScheduler& uploads()
+		{
+			if (uploadScheduler_ == nullptr) { KILL("Device has no upload scheduler, it was moved from another device"); }
 
+			return *uploadScheduler_;
+		}
 
-		vk::Extent2D extent()
+		//Submits and presents on a VkQueue must be externally synchronized, every Queue of the same VkQueue locks this mutex
+		//INFO:The upload scheduler submits from loading threads, its transfer queue may be the graphics one
+		//Thread safe
+		std::mutex& queueMutex(vk::Queue queue)
 		{
-			auto surfaceCapabilities = physicalDevice_.getSurfaceCapabilitiesKHR(surface_);
+			std::scoped_lock lock(queueMutexesMutex_);
 
-			int width, height = 0;
-			glfwGetFramebufferSize(window_.get().window(), &width, &height);
+			std::unique_ptr<std::mutex>& mutex = queueMutexes_[static_cast<VkQueue>(queue)];
+			if (mutex == nullptr) { mutex = std::make_unique<std::mutex>(); }
+
+			return *mutex;
+		}
+
+		//vkDeviceWaitIdle, holding every queue mutex as it requires
+		//Thread safe
+		void waitIdle()
+		{
+			std::scoped_lock lock(queueMutexesMutex_);
+
+			std::vector<std::unique_lock<std::mutex>> queueLocks;
+			queueLocks.reserve(queueMutexes_.size());
+			for (auto& [queue, mutex] : queueMutexes_) { queueLocks.emplace_back(*mutex); }
+
+			device_.waitIdle();
+		}
+		//TODO:Implement generic destroy, calling getProcAddr to get correct destroyFunction according to type of parameter
+		//Fence
+
+		void waitFence(Fence &fence);
+
+		void resetFence(Fence &fence);
+
+
+		vk::Extent2D extent()
+		{
+			auto surfaceCapabilities = physicalDevice_.getSurfaceCapabilitiesKHR(surface_);
+
+			int width, height = 0;
+			glfwGetFramebufferSize(window_.get().window(), &width, &height);
 
 			vk::Extent2D extent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
 
@@ -892,6 +1544,11 @@ namespace SOULKAN_NAMESPACE
 			return std::find(supportedExtensions_.begin(), supportedExtensions_.end(), extension) != supportedExtensions_.end();
 		}
 
+		bool isEnabled(std::string extension)
+		{
+			return std::find(enabledExtensions_.begin(), enabledExtensions_.end(), extension) != enabledExtensions_.end();
+		}
+
 		//                                        GENERAL, GRAPHICS, COMPUTE, TRANSFER
 		//std::array<uint32_t, 4> queueFamilies = {x,      y,        z,       w}
 		std::array<uint32_t, 4> queueFamilies()
@@ -1011,6 +1668,14 @@ namespace SOULKAN_NAMESPACE
 		vk::PhysicalDevice physicalDevice_ = nullptr;
 		std::vector<std::string> supportedExtensions_ = {};
 
+		//Boxed so that the references handed by queueMutex stay valid when the map changes or the device is moved
+		std::map<VkQueue, std::unique_ptr<std::mutex>> queueMutexes_{};
+		std::mutex queueMutexesMutex_;
+
+		std::unique_ptr<UploadScheduler> uploadScheduler_{}; //Reset by destroy, before the device
+
+		void createUploadScheduler(); //Defined after UploadScheduler definition
+
 		//If queue at index is defined (other than uint32_t max) then it is available to use
 		bool queueAvailable(QueueFamilyCapability capability)
 		{
@@ -1155,6 +1820,95 @@ namespace SOULKAN_NAMESPACE
 		vk::Semaphore semaphore_;
 	};
 
+	//TIMELINE SEMAPHORE
+	//Semaphore holding an increasing 64 bit value, signaled by submits and polled or waited for by the host
+	class TimelineSemaphore : Destroyable
+	{
+	public:
+		TimelineSemaphore(ref<Device> device, uint64_t initialValue = 0) : device_(device)
+		{
+			vk::SemaphoreTypeCreateInfo typeInfo = {};
+			typeInfo.semaphoreType = vk::SemaphoreType::eTimeline;
+			typeInfo.initialValue = initialValue;
+
+			vk::SemaphoreCreateInfo createInfo = {};
+			createInfo.pNext = &typeInfo;
+
+			VK_CHECK(device_.get().vk().createSemaphore(&createInfo, nullptr, &semaphore_));
+		}
+
+		TimelineSemaphore(TimelineSemaphore&& other) noexcept : device_(other.device_), semaphore_(other.semaphore_)
+		{
+			destroyed_ = other.destroyed_;
+			other.destroyed_ = true;
+
+			manual_ = other.manual_;
+			other.manual_ = false;
+
+			other.semaphore_ = vk::Semaphore(nullptr);
+		}
+
+		TimelineSemaphore& operator=(TimelineSemaphore&& other) noexcept
+		{
+			destroy();
+
+			destroyed_ = other.destroyed_;
+			other.destroyed_ = true;
+
+			manual_ = other.manual_;
+			other.manual_ = false;
+
+			device_ = other.device_;
+
+			semaphore_ = other.semaphore_;
+			other.semaphore_ = vk::Semaphore(nullptr);
+
+			return *this;
+		}
+
+		//No copy constructors
+		TimelineSemaphore(TimelineSemaphore& other) = delete;
+		TimelineSemaphore& operator=(TimelineSemaphore& other) = delete;
+
+		void destroy()
+		{
+			if (destroyed_) { return; }
+			device_.get().vk().destroySemaphore(semaphore_);
+			destroyed_ = true;
+		}
+
+		~TimelineSemaphore()
+		{
+			if (manual_) { return; }
+			destroy();
+		}
+
+		//Last value signaled on the device, does not block
+		uint64_t value() const
+		{
+			return device_.get().vk().getSemaphoreCounterValue(semaphore_);
+		}
+
+		//Blocks until value is signaled
+		void wait(uint64_t value) const
+		{
+			vk::SemaphoreWaitInfo waitInfo = {};
+			waitInfo.semaphoreCount = 1;
+			waitInfo.pSemaphores = &semaphore_;
+			waitInfo.pValues = &value;
+
+			VK_CHECK(device_.get().vk().waitSemaphores(&waitInfo, std::numeric_limits<uint64_t>::max()));
+		}
+
+		vk::Semaphore vk() const
+		{
+			return semaphore_;
+		}
+	private:
+		ref<Device> device_;
+		vk::Semaphore semaphore_{};
+	};
+
 	//DEVICE
 	void Device::waitFence(Fence &fence)
 	{
@@ -1189,7 +1943,8 @@ namespace SOULKAN_NAMESPACE
 			extent_ = device_.get().extent();
 
 			//Concurrency
-			auto sharingMode = vk::SharingMode::eConcurrent; //TODO:Defaulting to concurrent, read up on it later on
+			//INFO:Exclusive, images are only rendered to and presented from the graphics queue. Concurrent sharing can disable compression on many drivers
+			auto sharingMode = vk::SharingMode::eExclusive;
 
 			//SurfaceFormat
 			surfaceFormat_ = device_.get().surfaceFormat();
@@ -1197,9 +1952,6 @@ namespace SOULKAN_NAMESPACE
 			//PresentMode
 			presentMode_ = device_.get().presentMode();
 
-			//Queues
-			auto queues = device_.get().queueConcentrate();
-
 			auto createInfo = vk::SwapchainCreateInfoKHR(vk::SwapchainCreateFlagsKHR());
 
 			createInfo.surface = surface;
@@ -1213,9 +1965,6 @@ namespace SOULKAN_NAMESPACE
 			createInfo.imageArrayLayers = 1; //1 for non-stereoscopic 3D apps
 			createInfo.imageUsage = vk::ImageUsageFlagBits::eColorAttachment; //Image can be used to create a VkImageView
 
-			createInfo.queueFamilyIndexCount = static_cast<uint32_t>(queues.size());
-			createInfo.pQueueFamilyIndices = queues.data();
-
 			createInfo.imageSharingMode = sharingMode;
 
 			createInfo.preTransform = surfaceCapabilities.currentTransform; //TODO:Read up on both lines
@@ -1470,14 +2219,20 @@ namespace SOULKAN_NAMESPACE
 			commandBuffer_.endRendering();
 		}
 
+		//srcFamily and dstFamily transfer the ownership of an exclusive image, the same barrier being recorded on both queues
+		//(release on srcFamily, with dst stages ignored, then acquire on dstFamily, with src stages ignored, after a semaphore wait)
 		void imageLayoutTransition(vk::ImageLayout old, vk::ImageLayout next, vk::Image image,
 								   vk::PipelineStageFlags2 src, vk::AccessFlags2 srcAccess,
-								   vk::PipelineStageFlags2 dst, vk::AccessFlags2 dstAccess)
+								   vk::PipelineStageFlags2 dst, vk::AccessFlags2 dstAccess,
+								   uint32_t srcFamily = VK_QUEUE_FAMILY_IGNORED, uint32_t dstFamily = VK_QUEUE_FAMILY_IGNORED)
 		{
 			vk::ImageMemoryBarrier2 imageBarrier = {};
 			imageBarrier.oldLayout = old;
 			imageBarrier.newLayout = next;
 
+			imageBarrier.srcQueueFamilyIndex = srcFamily;
+			imageBarrier.dstQueueFamilyIndex = dstFamily;
+
 			imageBarrier.image = image;
 			imageBarrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor; //TODO:Understand what's a subresourcerange
 			imageBarrier.subresourceRange.baseMipLevel = 0;
@@ -1498,7 +2253,35 @@ namespace SOULKAN_NAMESPACE
 			commandBuffer_.pipelineBarrier2(dependencyInfo);
 		}
 
+		//Barrier on a range of buffer, transferring its ownership from srcFamily to dstFamily like imageLayoutTransition
+		void bufferBarrier(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize size,
+						   vk::PipelineStageFlags2 src, vk::AccessFlags2 srcAccess,
+						   vk::PipelineStageFlags2 dst, vk::AccessFlags2 dstAccess,
+						   uint32_t srcFamily = VK_QUEUE_FAMILY_IGNORED, uint32_t dstFamily = VK_QUEUE_FAMILY_IGNORED)
+		{
+			vk::BufferMemoryBarrier2 bufferBarrier = {};
+			bufferBarrier.buffer = buffer;
+			bufferBarrier.offset = offset;
+			bufferBarrier.size = size;
+
+			bufferBarrier.srcQueueFamilyIndex = srcFamily;
+			bufferBarrier.dstQueueFamilyIndex = dstFamily;
+
+			bufferBarrier.srcStageMask = src;
+			bufferBarrier.srcAccessMask = srcAccess;
+
+			bufferBarrier.dstStageMask = dst;
+			bufferBarrier.dstAccessMask = dstAccess;
+
+			vk::DependencyInfo dependencyInfo = {};
+			dependencyInfo.bufferMemoryBarrierCount = 1;
+			dependencyInfo.pBufferMemoryBarriers = &bufferBarrier;
+
+			commandBuffer_.pipelineBarrier2(dependencyInfo);
+		}
+
 		bool graphics() const;//Defined after CommandPool definition
+		uint32_t queueFamily() const;//Defined after CommandPool definition
 
 		vk::CommandBuffer vk() const  { return commandBuffer_; }
 
@@ -1612,6 +2395,12 @@ namespace SOULKAN_NAMESPACE
 			(commandPool_.get().index() == commandPool_.get().device().get().queueFamilies()[INDEX(QueueFamilyCapability::GRAPHICS)]);
 	}
 
+	//Queue family index of the command pool, the family whose queues can execute the command buffer
+	uint32_t CommandBuffer::queueFamily() const
+	{
+		return commandPool_.get().index();
+	}
+
 	//QUEUE
 	void Queue::submit(CommandBuffer& commandBuffer, Semaphore &waitSemaphore, Semaphore &signalSemaphore, Fence &signalFence)//Defined after CommandBuffer definition
 	{
@@ -1633,6 +2422,7 @@ namespace SOULKAN_NAMESPACE
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &vkCommandBuffer;
 
+		std::scoped_lock lock(device_.get().queueMutex(queue_));
 		//signalFence 
 		VK_CHECK(queue_.submit(1, &submitInfo, signalFence.vk()));
 	}
@@ -1651,9 +2441,71 @@ namespace SOULKAN_NAMESPACE
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &vkBuffer;
 
+		std::scoped_lock lock(device_.get().queueMutex(queue_));
 		VK_CHECK(queue_.submit(1, &submitInfo, signalFence.vk()));
 	}
 
+	void Queue::submit(CommandBuffer& commandBuffer, TimelineSemaphore& timeline, uint64_t signalValue, std::span<const std::pair<vk::Semaphore, uint64_t>> timelineWaits)
+	{
+		std::vector<vk::SemaphoreSubmitInfo> waitInfos(timelineWaits.size());
+		for (size_t i = 0; i < timelineWaits.size(); i++)
+		{
+			waitInfos[i].semaphore = timelineWaits[i].first;
+			waitInfos[i].value = timelineWaits[i].second;
+			waitInfos[i].stageMask = vk::PipelineStageFlagBits2::eAllCommands;
+		}
+
+		vk::CommandBufferSubmitInfo commandBufferInfo = {};
+		commandBufferInfo.commandBuffer = commandBuffer.vk();
+
+		vk::SemaphoreSubmitInfo signalInfo = {};
+		signalInfo.semaphore = timeline.vk();
+		signalInfo.value = signalValue;
+		signalInfo.stageMask = vk::PipelineStageFlagBits2::eAllCommands;
+
+		vk::SubmitInfo2 submitInfo = {};
+		submitInfo.waitSemaphoreInfoCount = static_cast<uint32_t>(waitInfos.size());
+		submitInfo.pWaitSemaphoreInfos = waitInfos.data();
+		submitInfo.commandBufferInfoCount = 1;
+		submitInfo.pCommandBufferInfos = &commandBufferInfo;
+		submitInfo.signalSemaphoreInfoCount = 1;
+		submitInfo.pSignalSemaphoreInfos = &signalInfo;
+
+		std::scoped_lock lock(device_.get().queueMutex(queue_));
+		VK_CHECK(queue_.submit2(1, &submitInfo, vk::Fence(nullptr)));
+	}
+
+	void Queue::submit(CommandBuffer& commandBuffer, Semaphore &waitSemaphore, Semaphore &signalSemaphore, Fence &signalFence, std::span<const std::pair<vk::Semaphore, uint64_t>> timelineWaits)
+	{
+		std::vector<vk::SemaphoreSubmitInfo> waitInfos(1 + timelineWaits.size());
+		waitInfos[0].semaphore = waitSemaphore.vk();
+		waitInfos[0].stageMask = vk::PipelineStageFlagBits2::eColorAttachmentOutput;
+		for (size_t i = 0; i < timelineWaits.size(); i++)
+		{
+			waitInfos[i + 1].semaphore = timelineWaits[i].first;
+			waitInfos[i + 1].value = timelineWaits[i].second;
+			waitInfos[i + 1].stageMask = vk::PipelineStageFlagBits2::eIndexInput | vk::PipelineStageFlagBits2::eVertexShader; //INFO:Vertex pulling reads vertices and matrices from the vertex shader
+		}
+
+		vk::SemaphoreSubmitInfo signalInfo = {};
+		signalInfo.semaphore = signalSemaphore.vk();
+		signalInfo.stageMask = vk::PipelineStageFlagBits2::eAllCommands;
+
+		vk::CommandBufferSubmitInfo commandBufferInfo = {};
+		commandBufferInfo.commandBuffer = commandBuffer.vk();
+
+		vk::SubmitInfo2 submitInfo = {};
+		submitInfo.waitSemaphoreInfoCount = static_cast<uint32_t>(waitInfos.size());
+		submitInfo.pWaitSemaphoreInfos = waitInfos.data();
+		submitInfo.commandBufferInfoCount = 1;
+		submitInfo.pCommandBufferInfos = &commandBufferInfo;
+		submitInfo.signalSemaphoreInfoCount = 1;
+		submitInfo.pSignalSemaphoreInfos = &signalInfo;
+
+		std::scoped_lock lock(device_.get().queueMutex(queue_));
+		VK_CHECK(queue_.submit2(1, &submitInfo, signalFence.vk()));
+	}
+
 	void Queue::present(Swapchain& swapchain, Semaphore &waitSemaphore, uint32_t imageIndex)
 	{
 		vk::PresentInfoKHR presentInfo = {};
@@ -1668,1160 +2520,7362 @@ namespace SOULKAN_NAMESPACE
 
 		presentInfo.pImageIndices = &imageIndex;
 
+		std::scoped_lock lock(device_.get().queueMutex(queue_));
 		VK_CHECK(queue_.presentKHR(&presentInfo));
 	}
 
-	//TODO:Save compiled spirv to file for later re-use
-	class Shader : Destroyable
+	//UPLOAD SCHEDULER
+	//Collects the copies of every local buffer and image of a device, recording them into one command buffer submitted once per frame
+	//with a single timeline signal (see submit). Requests return the value their batch signals, consumers waiting for that value
+	//INFO:Requests are recorded in order with a transfer barrier between them, a copy reading bytes written by an earlier request sees them
+	//INFO:Resources are exclusive, when the consumer family differs from the transfer one the batch releases what it wrote to the consumer,
+	//acquired by a command buffer of that family with acquire. Ranges a batch reads while a consumer owns them (defragmentation, growth)
+	//are released back by a submit of the scheduler on a queue of that family and acquired by the batch, which releases them again
+	//Thread safe
+	//Non copyable non movable, owned by its device
+	class UploadScheduler : Destroyable
 	{
 	public:
-		//Does nothing, acts as default constructor
-		Shader(ref<Device> device) : device_(device) {}
-		Shader(ref<Device> device, std::string filename, vk::ShaderStageFlagBits shaderStage) : device_(device), filename_(filename), stage_(shaderStage) {}
-
-		//TODO:Implement move constructors
-		Shader(Shader&& other) noexcept : device_(other.device_), filename_(other.filename_), source_(other.source_),
-			module_(other.module_), stage_(other.stage_)
-		{
-			destroyed_ = other.destroyed_;
-			other.destroyed_ = true;
+		UploadScheduler(Device& device) :
+			device_(device),
+			pool_(device, device.queueIndex(QueueFamilyCapability::TRANSFER)),
+			timeline_(device),
+			queue_(device.queue(QueueFamilyCapability::TRANSFER, 0))
+		{
+			commandBuffers_.reserve(BATCHES_IN_FLIGHT);
+			for (size_t i = 0; i < BATCHES_IN_FLIGHT; i++)
+			{
+				commandBuffers_.push_back(pool_.allocate());
+			}
+		}
 
-			manual_ = other.manual_;
-			other.manual_ = false;
+		//No copy constructors
+		UploadScheduler(UploadScheduler& other) = delete;
+		UploadScheduler& operator=(UploadScheduler& other) = delete;
 
-			other.filename_ = "";
-			other.source_ = "";
-			other.module_ = vk::ShaderModule(nullptr);
+		//Waits for the submitted batches, the command buffers, pool and semaphore being destroyed along with the scheduler
+		void destroy()
+		{
+			if (destroyed_) { return; }
+			timeline_.wait(submittedValue_);
+			for (auto& [family, returnQueue] : returnQueues_) { returnQueue->timeline.wait(returnQueue->value); }
+			destroyed_ = true;
 		}
-		Shader& operator=(Shader&& other) noexcept
+
+		~UploadScheduler()
 		{
+			if (manual_) { return; }
 			destroy();
+		}
 
-			destroyed_ = other.destroyed_;
-			other.destroyed_ = true;
-
-			manual_ = other.manual_;
-			other.manual_ = false;
+		//Queues copies of regions from src to dst, read by consumer, returns the value signaled once they are done
+		//lastRead when no consumer reads src after these copies, the ranges of src returned for them then staying with the transfer family
+		uint64_t copyBuffer(vk::Buffer src, vk::Buffer dst, std::vector<vk::BufferCopy2> regions, QueueFamilyCapability consumer = QueueFamilyCapability::GRAPHICS,
+							bool lastRead = false)
+		{
+			std::scoped_lock lock(mutex_);
 
-			filename_ = other.filename_;
-			other.filename_ = "";
+			Request request = {};
+			request.src = src;
+			request.lastRead = lastRead;
+			request.dstBuffer = dst;
+			request.regions = std::move(regions);
+			request.consumer = consumer;
+			request.consumerFamily = consumerFamily(consumer);
+			pending_.push_back(std::move(request));
 
-			source_ = other.source_;
-			other.source_ = "";
+			return submittedValue_ + 1;
+		}
 
-			module_ = other.module_;
-			other.module_ = vk::ShaderModule(nullptr);
+		//Queues the copy of tightly packed texels from src to the first level and layer of image, left in finalLayout
+		//INFO:The previous content of image is discarded
+		uint64_t copyImage(vk::Buffer src, vk::Image image, vk::Extent3D extent, vk::ImageLayout finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+						   QueueFamilyCapability consumer = QueueFamilyCapability::GRAPHICS)
+		{
+			std::scoped_lock lock(mutex_);
 
-			stage_ = other.stage_;
+			Request request = {};
+			request.src = src;
+			request.dstImage = image;
+			request.extent = extent;
+			request.finalLayout = finalLayout;
+			request.consumer = consumer;
+			request.consumerFamily = consumerFamily(consumer);
+			pending_.push_back(std::move(request));
 
-			return *this;
+			return submittedValue_ + 1;
 		}
 
-		//No copy constructors
-		Shader(Shader& other) = delete;
-		Shader& operator=(Shader& other) = delete;
-
-		void destroy()
+		//Records every queued request into the next command buffer and submits it, returns the value it signals
+		//(the last submitted one when nothing is queued). To be called once per frame, before the submits waiting for uploads
+		//INFO:Requests reading ranges owned by a consumer family are left queued, along with the ones after them, unless called from the thread calling acquire
+		uint64_t submit()
 		{
-			if (destroyed_) { return; }
-			device_.get().vk().destroyShaderModule(module_);
-			destroyed_ = true;
+			std::scoped_lock lock(mutex_);
+			return submitPending(std::this_thread::get_id() == consumerThread_);
 		}
 
-		~Shader()
-		{
-			if (manual_) { return; }
-			destroy();
-		}
-		
-		//INFO:Expensive, reads entire file
-		//INFO:Reads the entire file again if readAgain is set to true
-		std::string source(bool readAgain = false)
+		//Blocks until value is signaled, submitting the queued requests first when value belongs to them
+		//INFO:When they read ranges owned by a consumer family, only the thread calling acquire submits them (see submit)
+		void wait(uint64_t value)
 		{
-			if (source_.size() != 0 && !readAgain)
 			{
-				return source_;
+				std::scoped_lock lock(mutex_);
+				if (value > submittedValue_) { submitPending(std::this_thread::get_id() == consumerThread_); }
 			}
 
-			std::ifstream in(filename_);
-
-			if (!in.is_open()) { KILL("Shader file does not exist"); }
+			timeline_.wait(value);
+		}
 
-			std::stringstream buffer;
-			buffer << in.rdbuf();
+		//Last value known to be signaled, polled without waiting
+		uint64_t completedValue()
+		{
+			std::scoped_lock lock(mutex_);
 
-			source_ = buffer.str();
+			if (completedValue_ < submittedValue_)
+			{
+				completedValue_ = timeline_.value();
+			}
 
-			in.close();
+			return completedValue_;
+		}
 
-			return source_;
+		//Timeline semaphore and last submitted value, for the submits reading what was uploaded
+		std::pair<vk::Semaphore, uint64_t> signal()
+		{
+			std::scoped_lock lock(mutex_);
+			return std::make_pair(timeline_.vk(), submittedValue_);
 		}
 
-		//INFO:Expensive, will compile glsl to spirv and then create module according to spirv binary if it has not been compiled yet
-		//INFO:Recompile if needed
-		vk::ShaderModule shader()
+		//Submits the queued requests then records into commandBuffer the acquire of every range and image released to its family,
+		//returns the value its submit must wait for on the timeline semaphore. To be called once per frame, replacing submit
+		//INFO:Acquired ranges are visible to every stage, commandBuffer being the first one of its family to read them
+		//The batches returning ranges to the transfer family are submitted by this thread only, they must come before the submits reading these ranges
+		//on the queue of the consumer: the thread must not wait for uploads (see wait) between acquire and the submit of commandBuffer
+		uint64_t acquire(CommandBuffer& commandBuffer)
 		{
-			std::vector<uint32_t> spirv;
+			std::scoped_lock lock(mutex_);
+			consumerThread_ = std::this_thread::get_id();
+			submitPending(true);
 
-			bool loadSpirv = false;
+			std::vector<vk::BufferMemoryBarrier2> bufferBarriers = {};
+			std::vector<vk::ImageMemoryBarrier2> imageBarriers = {};
 
-			std::ifstream lastSpirv(filename_ + ".spv", std::ios::binary);
-			std::ifstream lastSrc(filename_);
-			if (lastSpirv.good() && lastSrc.good())
-			{
-				auto lastWriteSrc = std::filesystem::last_write_time(std::filesystem::path(filename_));
-				auto lastWriteSpirv = std::filesystem::last_write_time(std::filesystem::path(filename_ + ".spv"));
-				
-				if (lastWriteSrc < lastWriteSpirv)
+			uint32_t family = commandBuffer.queueFamily();
+			std::erase_if(released_, [&](const Ownership& ownership)
 				{
-					if (compiled)
+					if (ownership.dstFamily != family) { return false; }
+
+					if (ownership.image)
 					{
-						return module_;
+						imageBarriers.push_back(ownershipBarrier<vk::ImageMemoryBarrier2>(ownership, false));
 					}
-					
-					loadSpirv = true;
+					else
+					{
+						bufferBarriers.push_back(ownershipBarrier<vk::BufferMemoryBarrier2>(ownership, false));
 
-				}
+						//INFO:Overwritten parts of older ranges are owned through this one
+						subtractRange(acquired_, ownership.buffer, ownership.offset, ownership.size);
+						acquired_.push_back(ownership);
+					}
+					return true;
+				});
 
-			}
+			pipelineBarriers(commandBuffer, bufferBarriers, imageBarriers);
 
-			vk::ShaderModuleCreateInfo createInfo = {};
-			if (!loadSpirv)
-			{
-				shaderc::Compiler compiler;
-				shaderc::CompileOptions options;
+			return submittedValue_;
+		}
 
-				shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(source(), kind(), filename_.c_str());
+		//Drops the pending acquires of image or buffer, to be called before destroying it
+		void discard(vk::Image image)
+		{
+			std::scoped_lock lock(mutex_);
+			std::erase_if(released_, [&](const Ownership& ownership) { return ownership.image == image; });
+		}
 
-				if (result.GetCompilationStatus() != shaderc_compilation_status_success)
-				{
-					std::string errorMessage = std::format("Could not compile shader : [{}], error: [{}]", filename_, result.GetErrorMessage());
-					KILL(errorMessage);
-				}
+		void discard(vk::Buffer buffer)
+		{
+			std::scoped_lock lock(mutex_);
+			std::erase_if(released_, [&](const Ownership& ownership) { return ownership.buffer == buffer; });
+			std::erase_if(acquired_, [&](const Ownership& ownership) { return ownership.buffer == buffer; });
+		}
 
-				spirv.assign(result.cbegin(), result.cend());
-				createInfo.codeSize = spirv.size() * sizeof(uint32_t);
-				createInfo.pCode = spirv.data();
+	private:
+		struct Request
+		{
+			vk::Buffer src{};
+			vk::Buffer dstBuffer{};
+			std::vector<vk::BufferCopy2> regions{};
+			bool lastRead = false;
 
-				std::ofstream spirvFile(filename_ + ".spv", std::ios::binary);
-				spirvFile.write((char*)spirv.data(), spirv.size() * sizeof(uint32_t));
-				spirvFile.close();
+			vk::Image dstImage{}; //Image requests only
+			vk::Extent3D extent{};
+			vk::ImageLayout finalLayout = vk::ImageLayout::eUndefined;
 
-				VK_CHECK(device_.get().vk().createShaderModule(&createInfo, nullptr, &module_));
-			}
+			QueueFamilyCapability consumer = QueueFamilyCapability::GRAPHICS;
+			uint32_t consumerFamily = VK_QUEUE_FAMILY_IGNORED;
+		};
 
-			if (loadSpirv)
-			{
-				lastSpirv.seekg(0, std::ios::end);
-				size_t fileSize = lastSpirv.tellg();
-				lastSpirv.seekg(0, std::ios::beg);				
+		//Range or image released by a submitted batch, waiting for the acquire of dstFamily (then owned by it, see acquired_)
+		struct Ownership
+		{
+			vk::Buffer buffer{};
+			vk::DeviceSize offset = 0;
+			vk::DeviceSize size = 0;
 
-				std::vector<uint32_t> spirvData(fileSize / sizeof(uint32_t));
-				lastSpirv.read((char*)spirvData.data(), fileSize);
+			vk::Image image{}; //Image ownerships only
+			vk::ImageLayout oldLayout = vk::ImageLayout::eUndefined;
+			vk::ImageLayout newLayout = vk::ImageLayout::eUndefined;
 
-				createInfo.codeSize = fileSize;
+			QueueFamilyCapability consumer = QueueFamilyCapability::GRAPHICS;
+			uint32_t srcFamily = VK_QUEUE_FAMILY_IGNORED;
+			uint32_t dstFamily = VK_QUEUE_FAMILY_IGNORED;
+		};
+
+		//Command buffers are used in turn, each one only being waited for when reused BATCHES_IN_FLIGHT submits later
+		static constexpr size_t BATCHES_IN_FLIGHT = 4;
+
+		//Queue of a consumer family releasing ranges back to the transfer family, see returnOwnerships
+		//INFO:Its own timeline semaphore, values signaled by different queues could otherwise be reached out of order
+		struct ReturnQueue
+		{
+			ReturnQueue(Device& device, QueueFamilyCapability consumer) :
+				pool(device, device.queueIndex(consumer)),
+				timeline(device),
+				queue(device.queue(consumer, 0))
+			{
+				commandBuffers.reserve(BATCHES_IN_FLIGHT);
+				for (size_t i = 0; i < BATCHES_IN_FLIGHT; i++)
+				{
+					commandBuffers.push_back(pool.allocate());
+				}
+			}
+
+			CommandPool pool;
+			std::vector<CommandBuffer> commandBuffers{};
+			std::array<uint64_t, BATCHES_IN_FLIGHT> commandValues{};
+			size_t next = 0;
+
+			TimelineSemaphore timeline;
+			uint64_t value = 0;
+			Queue queue;
+		};
+
+		ref<Device> device_;
+		CommandPool pool_;
+		std::vector<CommandBuffer> commandBuffers_{};
+		std::array<uint64_t, BATCHES_IN_FLIGHT> commandValues_{}; //Value signaled by the last submit of each command buffer
+		size_t next_ = 0;
+
+		TimelineSemaphore timeline_;
+		uint64_t submittedValue_ = 0;
+		uint64_t completedValue_ = 0;
+		Queue queue_;
+
+		std::mutex mutex_;
+		std::vector<Request> pending_{};
+		std::vector<Ownership> released_{};
+		std::vector<Ownership> acquired_{}; //Buffer ranges owned by a consumer family since its acquire, disjoint
+
+		std::map<uint32_t, std::unique_ptr<ReturnQueue>> returnQueues_{}; //By consumer family, created by their first return
+		std::thread::id consumerThread_{}; //Thread calling acquire
+
+		//Ignored when the consumer shares the transfer family, nothing then being released
+		uint32_t consumerFamily(QueueFamilyCapability consumer)
+		{
+			uint32_t family = device_.get().queueIndex(consumer);
+			return (family == pool_.index()) ? VK_QUEUE_FAMILY_IGNORED : family;
+		}
+
+		//Requests reading ranges owned by a consumer family are only submitted (along with the others) when returning, see acquire
+		//mutex_ must be held
+		uint64_t submitPending(bool returning)
+		{
+			if (pending_.empty()) { return submittedValue_; }
+
+			//Owned ranges the batch reads, the ones released by an earlier batch and not acquired yet being acquired before their return
+			std::vector<Ownership> returned = {};
+			std::vector<Ownership> unacquired = {};
+			auto read = [&](const Ownership& ownership) { return readByPending(ownership); };
+			if (std::any_of(acquired_.begin(), acquired_.end(), read) || std::any_of(released_.begin(), released_.end(), read))
+			{
+				if (!returning) { return submittedValue_; }
+
+				std::erase_if(acquired_, [&](const Ownership& ownership)
+					{
+						if (!read(ownership)) { return false; }
+						returned.push_back(ownership);
+						return true;
+					});
+				std::erase_if(released_, [&](const Ownership& ownership)
+					{
+						if (!read(ownership)) { return false; }
+						unacquired.push_back(ownership);
+						returned.push_back(ownership);
+						return true;
+					});
+			}
+
+			if (commandValues_[next_] > completedValue_)
+			{
+				timeline_.wait(commandValues_[next_]);
+				completedValue_ = commandValues_[next_];
+			}
+
+			std::vector<std::pair<vk::Semaphore, uint64_t>> returnWaits = returnOwnerships(returned, unacquired);
+
+			CommandBuffer& commandBuffer = commandBuffers_[next_];
+			commandBuffer.begin();
+
+			std::vector<vk::BufferMemoryBarrier2> acquireBarriers = {};
+			for (const Ownership& ownership : returned)
+			{
+				acquireBarriers.push_back(ownershipBarrier<vk::BufferMemoryBarrier2>(returnOf(ownership), false));
+			}
+			pipelineBarriers(commandBuffer, acquireBarriers);
+
+			for (size_t r = 0; r < pending_.size(); r++)
+			{
+				const Request& request = pending_[r];
+				if (r > 0)
+				{
+					memoryBarrier(commandBuffer, vk::PipelineStageFlagBits2::eTransfer, vk::AccessFlagBits2::eTransferRead | vk::AccessFlagBits2::eTransferWrite);
+				}
+
+				if (request.dstImage)
+				{
+					recordImageCopy(commandBuffer, request);
+					continue;
+				}
+
+				vk::CopyBufferInfo2 bufferCopy = {};
+				bufferCopy.srcBuffer = request.src;
+				bufferCopy.dstBuffer = request.dstBuffer;
+				bufferCopy.regionCount = static_cast<uint32_t>(request.regions.size());
+				bufferCopy.pRegions = request.regions.data();
+
+				commandBuffer.vk().copyBuffer2(&bufferCopy);
+			}
+
+			//Reads and later writes of every consumer happen after the whole batch
+			memoryBarrier(commandBuffer, vk::PipelineStageFlagBits2::eAllCommands, vk::AccessFlagBits2::eMemoryRead | vk::AccessFlagBits2::eMemoryWrite);
+			releaseOwnerships(commandBuffer, returned);
+
+			commandBuffer.end();
+
+			submittedValue_++;
+			queue_.submit(commandBuffer, timeline_, submittedValue_, returnWaits);
+
+			commandValues_[next_] = submittedValue_;
+			next_ = (next_ + 1) % BATCHES_IN_FLIGHT;
+			pending_.clear();
+
+			return submittedValue_;
+		}
+
+		void recordImageCopy(CommandBuffer& commandBuffer, const Request& request)
+		{
+			commandBuffer.imageLayoutTransition(vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, request.dstImage,
+				vk::PipelineStageFlagBits2::eNone, vk::AccessFlagBits2::eNone,
+				vk::PipelineStageFlagBits2::eTransfer, vk::AccessFlagBits2::eTransferWrite);
+
+			vk::BufferImageCopy2 copyRegion = {};
+			copyRegion.bufferOffset = 0;
+			copyRegion.bufferRowLength = 0;
+			copyRegion.bufferImageHeight = 0;
+
+			copyRegion.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+			copyRegion.imageSubresource.mipLevel = 0;
+			copyRegion.imageSubresource.baseArrayLayer = 0;
+			copyRegion.imageSubresource.layerCount = 1;
+			copyRegion.imageExtent = request.extent;
+
+			vk::CopyBufferToImageInfo2 copy = {};
+			copy.regionCount = 1;
+			copy.pRegions = &copyRegion;
+			copy.srcBuffer = request.src;
+			copy.dstImage = request.dstImage;
+			copy.dstImageLayout = vk::ImageLayout::eTransferDstOptimal;
+
+			commandBuffer.vk().copyBufferToImage2(&copy);
+
+			//Released images are transitioned by their release and acquire barriers
+			if (request.consumerFamily != VK_QUEUE_FAMILY_IGNORED) { return; }
+
+			//INFO:The transfer queue may not support shader stages, the final barrier of the batch makes the image visible to them
+			commandBuffer.imageLayoutTransition(vk::ImageLayout::eTransferDstOptimal, request.finalLayout, request.dstImage,
+				vk::PipelineStageFlagBits2::eTransfer, vk::AccessFlagBits2::eTransferWrite,
+				vk::PipelineStageFlagBits2::eAllCommands, vk::AccessFlagBits2::eMemoryRead);
+		}
+
+		//Records the release of every range and image written for another family and of the returned ranges, remembered until acquired
+		//INFO:Returned ranges go back whole to their family, the parts of the written ranges inside them are not released twice
+		//mutex_ must be held
+		void releaseOwnerships(CommandBuffer& commandBuffer, const std::vector<Ownership>& returned)
+		{
+			std::vector<vk::BufferMemoryBarrier2> bufferBarriers = {};
+			std::vector<vk::ImageMemoryBarrier2> imageBarriers = {};
+
+			for (const Ownership& ownership : returned)
+			{
+				bool lastRead = std::any_of(pending_.begin(), pending_.end(), [&](const Request& request) { return request.lastRead && request.src == ownership.buffer; });
+				if (lastRead) { continue; }
+
+				bufferBarriers.push_back(ownershipBarrier<vk::BufferMemoryBarrier2>(ownership, true));
+				released_.push_back(ownership);
+			}
+
+			for (const Request& request : pending_)
+			{
+				if (request.consumerFamily == VK_QUEUE_FAMILY_IGNORED) { continue; }
+
+				Ownership ownership = {};
+				ownership.consumer = request.consumer;
+				ownership.srcFamily = pool_.index();
+				ownership.dstFamily = request.consumerFamily;
+
+				if (request.dstImage)
+				{
+					ownership.image = request.dstImage;
+					ownership.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+					ownership.newLayout = request.finalLayout;
+
+					imageBarriers.push_back(ownershipBarrier<vk::ImageMemoryBarrier2>(ownership, true));
+					released_.push_back(ownership);
+					continue;
+				}
+
+				ownership.buffer = request.dstBuffer;
+				for (const vk::BufferCopy2& region : request.regions)
+				{
+					std::vector<Ownership> parts = { ownership };
+					parts[0].offset = region.dstOffset;
+					parts[0].size = region.size;
+					for (const Ownership& back : returned) { subtractRange(parts, back.buffer, back.offset, back.size); }
+
+					for (const Ownership& part : parts)
+					{
+						bufferBarriers.push_back(ownershipBarrier<vk::BufferMemoryBarrier2>(part, true));
+						released_.push_back(part);
+					}
+				}
+			}
+
+			pipelineBarriers(commandBuffer, bufferBarriers, imageBarriers);
+		}
+
+		//Whether a pending request reads the range of ownership, which has to be returned to the transfer family first
+		//mutex_ must be held
+		bool readByPending(const Ownership& ownership)
+		{
+			if (ownership.image) { return false; }
+
+			for (const Request& request : pending_)
+			{
+				if (request.dstImage || request.src != ownership.buffer) { continue; }
+
+				for (const vk::BufferCopy2& region : request.regions)
+				{
+					if (region.srcOffset < ownership.offset + ownership.size && ownership.offset < region.srcOffset + region.size) { return true; }
+				}
+			}
+
+			return false;
+		}
+
+		//Records and submits on the queue of each consumer family the release back to the transfer family of the returned ranges it owns,
+		//acquiring first the ones still released to it. Returns the (timeline semaphore, value) pairs the batch must wait for
+		//mutex_ must be held
+		std::vector<std::pair<vk::Semaphore, uint64_t>> returnOwnerships(const std::vector<Ownership>& returned, const std::vector<Ownership>& unacquired)
+		{
+			std::map<uint32_t, QueueFamilyCapability> families = {};
+			for (const Ownership& ownership : returned) { families[ownership.dstFamily] = ownership.consumer; }
+
+			std::vector<std::pair<vk::Semaphore, uint64_t>> waits = {};
+			for (const auto& [family, consumer] : families)
+			{
+				std::vector<vk::BufferMemoryBarrier2> acquireBarriers = {};
+				for (const Ownership& ownership : unacquired)
+				{
+					if (ownership.dstFamily == family) { acquireBarriers.push_back(ownershipBarrier<vk::BufferMemoryBarrier2>(ownership, false)); }
+				}
+
+				std::vector<vk::BufferMemoryBarrier2> releaseBarriers = {};
+				for (const Ownership& ownership : returned)
+				{
+					if (ownership.dstFamily == family) { releaseBarriers.push_back(ownershipBarrier<vk::BufferMemoryBarrier2>(returnOf(ownership), true)); }
+				}
+
+				std::unique_ptr<ReturnQueue>& returnQueue = returnQueues_[family];
+				if (returnQueue == nullptr) { returnQueue = std::make_unique<ReturnQueue>(device_.get(), consumer); }
+
+				uint64_t reusedValue = returnQueue->commandValues[returnQueue->next];
+				returnQueue->timeline.wait(reusedValue);
+
+				CommandBuffer& commandBuffer = returnQueue->commandBuffers[returnQueue->next];
+				commandBuffer.begin();
+				pipelineBarriers(commandBuffer, acquireBarriers);
+				pipelineBarriers(commandBuffer, releaseBarriers);
+				commandBuffer.end();
+
+				//INFO:The acquired ranges were released by the last submitted batch at the latest
+				std::array<std::pair<vk::Semaphore, uint64_t>, 1> batchWait = { std::make_pair(timeline_.vk(), submittedValue_) };
+
+				returnQueue->value++;
+				returnQueue->queue.submit(commandBuffer, returnQueue->timeline, returnQueue->value, batchWait);
+
+				returnQueue->commandValues[returnQueue->next] = returnQueue->value;
+				returnQueue->next = (returnQueue->next + 1) % BATCHES_IN_FLIGHT;
+
+				waits.push_back(std::make_pair(returnQueue->timeline.vk(), returnQueue->value));
+			}
+
+			return waits;
+		}
+
+		//Same range going back from its consumer family to the transfer one
+		static Ownership returnOf(const Ownership& ownership)
+		{
+			Ownership back = ownership;
+			std::swap(back.srcFamily, back.dstFamily);
+			return back;
+		}
+
+		//Removes [offset, offset + size) of buffer from ownerships, splitting the ones it cuts
+		static void subtractRange(std::vector<Ownership>& ownerships, vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize size)
+		{
+			std::vector<Ownership> parts = {};
+			std::erase_if(ownerships, [&](const Ownership& ownership)
+				{
+					if (ownership.image || ownership.buffer != buffer || ownership.offset >= offset + size || offset >= ownership.offset + ownership.size) { return false; }
+
+					if (ownership.offset < offset)
+					{
+						Ownership left = ownership;
+						left.size = offset - ownership.offset;
+						parts.push_back(left);
+					}
+					if (ownership.offset + ownership.size > offset + size)
+					{
+						Ownership right = ownership;
+						right.offset = offset + size;
+						right.size = ownership.offset + ownership.size - right.offset;
+						parts.push_back(right);
+					}
+					return true;
+				});
+
+			ownerships.insert(ownerships.end(), parts.begin(), parts.end());
+		}
+
+		static void pipelineBarriers(CommandBuffer& commandBuffer, std::span<const vk::BufferMemoryBarrier2> bufferBarriers,
+									 std::span<const vk::ImageMemoryBarrier2> imageBarriers = {})
+		{
+			if (bufferBarriers.empty() && imageBarriers.empty()) { return; }
+
+			vk::DependencyInfo dependency = {};
+			dependency.bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size());
+			dependency.pBufferMemoryBarriers = bufferBarriers.data();
+			dependency.imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size());
+			dependency.pImageMemoryBarriers = imageBarriers.data();
+
+			commandBuffer.vk().pipelineBarrier2(&dependency);
+		}
+
+		//Release or acquire half of an ownership transfer, identical but for their stages
+		//INFO:Towards a consumer the batch releases after its transfers and the consumer acquires for any stage,
+		//back to the transfer family the consumer releases after any stage and the batch acquires for its transfers
+		template<typename Barrier>
+		Barrier ownershipBarrier(const Ownership& ownership, bool release)
+		{
+			Barrier barrier = {};
+			barrier.srcQueueFamilyIndex = ownership.srcFamily;
+			barrier.dstQueueFamilyIndex = ownership.dstFamily;
+
+			bool toConsumer = ownership.srcFamily == pool_.index();
+			if (release)
+			{
+				barrier.srcStageMask = toConsumer ? vk::PipelineStageFlagBits2::eTransfer : vk::PipelineStageFlagBits2::eAllCommands;
+				barrier.srcAccessMask = toConsumer ? vk::AccessFlagBits2::eTransferWrite : vk::AccessFlagBits2::eMemoryWrite;
+			}
+			else
+			{
+				barrier.dstStageMask = toConsumer ? vk::PipelineStageFlagBits2::eAllCommands : vk::PipelineStageFlagBits2::eTransfer;
+				barrier.dstAccessMask = toConsumer ? vk::AccessFlagBits2::eMemoryRead : (vk::AccessFlagBits2::eTransferRead | vk::AccessFlagBits2::eTransferWrite);
+			}
+
+			if constexpr (std::is_same_v<Barrier, vk::ImageMemoryBarrier2>)
+			{
+				barrier.oldLayout = ownership.oldLayout;
+				barrier.newLayout = ownership.newLayout;
+
+				barrier.image = ownership.image;
+				barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+				barrier.subresourceRange.baseMipLevel = 0;
+				barrier.subresourceRange.levelCount = 1;
+				barrier.subresourceRange.baseArrayLayer = 0;
+				barrier.subresourceRange.layerCount = 1;
+			}
+			else
+			{
+				barrier.buffer = ownership.buffer;
+				barrier.offset = ownership.offset;
+				barrier.size = ownership.size;
+			}
+
+			return barrier;
+		}
+
+		void memoryBarrier(CommandBuffer& commandBuffer, vk::PipelineStageFlags2 dstStage, vk::AccessFlags2 dstAccess)
+		{
+			vk::MemoryBarrier2 barrier = {};
+			barrier.srcStageMask = vk::PipelineStageFlagBits2::eTransfer;
+			barrier.srcAccessMask = vk::AccessFlagBits2::eTransferWrite;
+
+			barrier.dstStageMask = dstStage;
+			barrier.dstAccessMask = dstAccess;
+
+			vk::DependencyInfo dependency = {};
+			dependency.memoryBarrierCount = 1;
+			dependency.pMemoryBarriers = &barrier;
+
+			commandBuffer.vk().pipelineBarrier2(&dependency);
+		}
+	};
+
+	//DEVICE
+	void Device::createUploadScheduler()
+	{
+		uploadScheduler_ = std::make_unique<UploadScheduler>(*this);
+	}
+
+	void Device::destroy()
+	{
+		if (destroyed_) { return; }
+		uploadScheduler_.reset(); //INFO:Waits for its last batch, its objects belong to the device
+		device_.destroy();
+		destroyed_ = true;
+	}
+
+	//TODO:Save compiled spirv to file for later re-use
+	class Shader : Destroyable
+	{
+	public:
+		//Does nothing, acts as default constructor
+		Shader(ref<Device> device) : device_(device) {}
+		Shader(ref<Device> device, std::string filename, vk::ShaderStageFlagBits shaderStage) : device_(device), filename_(filename), stage_(shaderStage) {}
+
+		//TODO:Implement move constructors
+		Shader(Shader&& other) noexcept : device_(other.device_), filename_(other.filename_), source_(other.source_),
+			module_(other.module_), stage_(other.stage_), injections_(other.injections_)
+		{
+			destroyed_ = other.destroyed_;
+			other.destroyed_ = true;
+
+			manual_ = other.manual_;
+			other.manual_ = false;
+
+			other.filename_ = "";
+			other.source_ = "";
+			other.module_ = vk::ShaderModule(nullptr);
+		}
+		Shader& operator=(Shader&& other) noexcept
+		{
+			destroy();
+
+			destroyed_ = other.destroyed_;
+			other.destroyed_ = true;
+
+			manual_ = other.manual_;
+			other.manual_ = false;
+
+			filename_ = other.filename_;
+			other.filename_ = "";
+
+			source_ = other.source_;
+			other.source_ = "";
+
+			module_ = other.module_;
+			other.module_ = vk::ShaderModule(nullptr);
+
+			stage_ = other.stage_;
+
+			injections_ = other.injections_;
+
+			return *this;
+		}
+
+		//No copy constructors
+		Shader(Shader& other) = delete;
+		Shader& operator=(Shader& other) = delete;
+
+		void destroy()
+		{
+			if (destroyed_) { return; }
+			device_.get().vk().destroyShaderModule(module_);
+			destroyed_ = true;
+		}
+
+		~Shader()
+		{
+			if (manual_) { return; }
+			destroy();
+		}
+		
+		std::string filename()
+		{
+			return filename_;
+		}
+
+		//INFO:Expensive, reads entire file
+		//INFO:Reads the entire file again if readAgain is set to true
+		std::string source(bool readAgain = false)
+		{
+			if (source_.size() != 0 && !readAgain)
+			{
+				return source_;
+			}
+
+			std::ifstream in(filename_);
+
+			if (!in.is_open()) { KILL("Shader file does not exist"); }
+
+			std::stringstream buffer;
+			buffer << in.rdbuf();
+
+			source_ = buffer.str();
+
+			in.close();
+
+			return source_;
+		}
+
+		//Replaces placeholder (usually a comment line) by code before compilation, along with the default code following it up to placeholder_END when there is one
+		//variant names the injected code, it is added to the .spv filename so that every variant of the shader keeps its own spirv
+		void inject(std::string placeholder, std::string code, std::string variant)
+		{
+			injections_[placeholder] = std::make_pair(code, variant);
+			compiled = false;
+		}
+
+		//Vertex fetch and decode code of a VertexBuffer layout, injected at //SOULKAN_VERTEX_LAYOUT
+		template<typename Layout>
+		void vertexLayout()
+		{
+			inject("//SOULKAN_VERTEX_LAYOUT", Layout::glsl(), Layout::layoutName);
+		}
+
+		//INFO:Expensive, will compile glsl to spirv and then create module according to spirv binary if it has not been compiled yet
+		//INFO:Recompile if needed
+		vk::ShaderModule shader()
+		{
+			std::vector<uint32_t> spirv;
+
+			bool loadSpirv = false;
+
+			std::ifstream lastSpirv(spirvFilename(), std::ios::binary);
+			std::ifstream lastSrc(filename_);
+			if (lastSpirv.good() && lastSrc.good())
+			{
+				auto lastWriteSrc = std::filesystem::last_write_time(std::filesystem::path(filename_));
+				auto lastWriteSpirv = std::filesystem::last_write_time(std::filesystem::path(spirvFilename()));
+				
+				if (lastWriteSrc < lastWriteSpirv)
+				{
+					if (compiled)
+					{
+						return module_;
+					}
+					
+					loadSpirv = true;
+
+				}
+
+			}
+
+			vk::ShaderModuleCreateInfo createInfo = {};
+			if (!loadSpirv)
+			{
+				shaderc::Compiler compiler;
+				shaderc::CompileOptions options;
+
+				shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(injectedSource(), kind(), filename_.c_str());
+
+				if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+				{
+					std::string errorMessage = std::format("Could not compile shader : [{}], error: [{}]", filename_, result.GetErrorMessage());
+					KILL(errorMessage);
+				}
+
+				spirv.assign(result.cbegin(), result.cend());
+				createInfo.codeSize = spirv.size() * sizeof(uint32_t);
+				createInfo.pCode = spirv.data();
+
+				std::ofstream spirvFile(spirvFilename(), std::ios::binary);
+				spirvFile.write((char*)spirv.data(), spirv.size() * sizeof(uint32_t));
+				spirvFile.close();
+
+				VK_CHECK(device_.get().vk().createShaderModule(&createInfo, nullptr, &module_));
+			}
+
+			if (loadSpirv)
+			{
+				lastSpirv.seekg(0, std::ios::end);
+				size_t fileSize = lastSpirv.tellg();
+				lastSpirv.seekg(0, std::ios::beg);				
+
+				std::vector<uint32_t> spirvData(fileSize / sizeof(uint32_t));
+				lastSpirv.read((char*)spirvData.data(), fileSize);
+
+				createInfo.codeSize = fileSize;
 				createInfo.pCode = spirvData.data();
 
-				VK_CHECK(device_.get().vk().createShaderModule(&createInfo, nullptr, &module_));
+				VK_CHECK(device_.get().vk().createShaderModule(&createInfo, nullptr, &module_));
+			}
+
+			lastSrc.close();
+			lastSpirv.close();
+			
+			compiled = true;
+
+			return module_;
+		}
+
+		vk::ShaderStageFlagBits stage() const
+		{
+			return stage_;
+		}
+	private:
+		ref<Device> device_;
+		std::string filename_{};
+		std::string source_{};
+		vk::ShaderModule module_;
+		vk::ShaderStageFlagBits stage_;
+
+		bool compiled = false; //Compilation state after latest changes
+
+		//Placeholder -> (code, variant), see inject
+		std::map<std::string, std::pair<std::string, std::string>> injections_{};
+
+		//filename.spv, or filename.variant1.variant2.spv when code is injected
+		std::string spirvFilename()
+		{
+			std::string spirvFilename = filename_;
+			for (auto& [placeholder, injection] : injections_)
+			{
+				//INFO:The hash of the injected code keeps spirv compiled with an older version of it from being loaded
+				spirvFilename += std::format(".{}.{:x}", injection.second, std::hash<std::string>{}(injection.first));
+			}
+
+			return spirvFilename + ".spv";
+		}
+
+		std::string injectedSource()
+		{
+			std::string code = source();
+			for (auto& [placeholder, injection] : injections_)
+			{
+				size_t position = code.find(placeholder);
+				if (position == std::string::npos)
+				{
+					KILL(std::format("Could not find [{}] in shader [{}]", placeholder, filename_));
+				}
+
+				size_t end = position + placeholder.size();
+				size_t defaultEnd = code.find(placeholder + "_END", end);
+				if (defaultEnd != std::string::npos) { end = defaultEnd + placeholder.size() + 4; }
+
+				code.replace(position, end - position, injection.first);
+			}
+
+			return code;
+		}
+
+		shaderc_shader_kind kind()
+		{
+			if (stage_ == vk::ShaderStageFlagBits::eVertex) { return shaderc_shader_kind::shaderc_vertex_shader; }
+			if (stage_ == vk::ShaderStageFlagBits::eFragment) { return shaderc_shader_kind::shaderc_fragment_shader; }
+
+			return shaderc_shader_kind::shaderc_vertex_shader;
+		}
+	};
+
+	class GraphicsPipeline : Destroyable
+	{
+	public:
+		//Acts as default constructor
+		GraphicsPipeline(ref<Device> device) : device_(device) {}
+		//INFO:Very expensive, might compile shader if not already compiled, lots of structs, ...
+		GraphicsPipeline(ref<Device> device, vec_ref<Shader> shaders, vk::PrimitiveTopology topology, vk::PolygonMode polygonMode, vk::Extent2D extent, vk::Format imageFormat) :
+			device_(device), shaders_(shaders), topology_(topology), polygonMode_(polygonMode), extent_(extent), imageFormat_(imageFormat)
+		{
+			//Shader stages
+			std::vector<vk::PipelineShaderStageCreateInfo> shaderStages;
+			for (auto s : shaders_)
+			{
+				vk::PipelineShaderStageCreateInfo createInfo = {};
+				createInfo.stage = s.get().stage();
+				createInfo.module = s.get().shader();//INFO:Expensive, might read file and compile
+				createInfo.pName = "main";
+
+				shaderStages.push_back(createInfo);
+			}
+
+			//Vertex input
+			vk::PipelineVertexInputStateCreateInfo vertexInput = {};
+
+			//Input assembly
+			vk::PipelineInputAssemblyStateCreateInfo inputAssembly = {};
+			inputAssembly.topology = topology_;
+
+			//Rasterizer
+			vk::PipelineRasterizationStateCreateInfo rasterization = {};
+			rasterization.polygonMode = polygonMode_;
+			rasterization.lineWidth = 1.0f;
+
+			rasterization.cullMode = vk::CullModeFlagBits::eNone;
+			rasterization.frontFace = vk::FrontFace::eClockwise;
+
+			//Multisampling
+			vk::PipelineMultisampleStateCreateInfo multisample = {};
+			multisample.rasterizationSamples = vk::SampleCountFlagBits::e1;
+
+			multisample.minSampleShading = 1.0f;
+
+			//Color blend
+			vk::PipelineColorBlendAttachmentState colorBlendAttachment = {};
+			colorBlendAttachment.colorWriteMask = vk::ColorComponentFlagBits::eR |
+												  vk::ColorComponentFlagBits::eG |
+												  vk::ColorComponentFlagBits::eB |
+												  vk::ColorComponentFlagBits::eA;
+
+			vk::PipelineColorBlendStateCreateInfo colorBlend = {};
+			colorBlend.logicOp = vk::LogicOp::eCopy;
+
+			colorBlend.attachmentCount = 1;
+			colorBlend.pAttachments = &colorBlendAttachment;
+
+			//Depth
+
+			vk::PipelineDepthStencilStateCreateInfo depth = {};
+			depth.depthTestEnable = true; //Depth test
+			depth.depthWriteEnable = true; //Depth write
+			depth.depthCompareOp = vk::CompareOp::eLessOrEqual; //Draw if Z less or equal
+
+			depth.minDepthBounds = 0.f;
+			depth.maxDepthBounds = 1.f;
+
+			//Scissor
+			vk::Rect2D scissor = {};
+			scissor.offset = vk::Offset2D{ 0, 0 };
+			scissor.extent = extent_;
+
+			//Viewport
+			vk::Viewport viewport = {};
+			viewport.width = static_cast<float>(extent_.width);
+			viewport.height = static_cast<float>(extent_.height);
+			
+			viewport.minDepth = 0.0f;
+			viewport.maxDepth = 1.0f;
+
+			vk::PipelineViewportStateCreateInfo viewportState = {};
+			viewportState.viewportCount = 1;
+			viewportState.pViewports = &viewport;
+
+			viewportState.scissorCount = 1;
+			viewportState.pScissors = &scissor;
+
+
+			//Pipeline layout
+			vk::PipelineLayoutCreateInfo pipelineLayout = {};
+
+			//INFO:Vertex buffer device address + Mesh matrix buffer device address + Mesh matrix index
+			vk::PushConstantRange bdaPushConstants = {};
+			bdaPushConstants.offset = 0;
+			bdaPushConstants.size = 2*sizeof(vk::DeviceAddress)+1*sizeof(vk::DeviceSize);
+			bdaPushConstants.stageFlags = vk::ShaderStageFlagBits::eVertex;
+
+			pipelineLayout.pushConstantRangeCount = 1;
+			pipelineLayout.pPushConstantRanges = &bdaPushConstants;
+			VK_CHECK(device_.get().vk().createPipelineLayout(&pipelineLayout, nullptr, &pipelineLayout_));
+
+			//Pipeline rendering
+			vk::PipelineRenderingCreateInfo rendering = {};
+			rendering.colorAttachmentCount = 1;
+			rendering.pColorAttachmentFormats = &imageFormat;
+			rendering.depthAttachmentFormat = vk::Format::eD32Sfloat;
+
+
+			//Creating pipeline
+			vk::GraphicsPipelineCreateInfo createInfo = {};
+			createInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
+			createInfo.pStages = shaderStages.data();
+
+			createInfo.pVertexInputState = &vertexInput;
+			createInfo.pInputAssemblyState = &inputAssembly;
+
+			createInfo.pViewportState = &viewportState;
+
+			createInfo.pRasterizationState = &rasterization;
+
+			createInfo.pMultisampleState = &multisample;
+
+			createInfo.pColorBlendState = &colorBlend;
+
+			createInfo.pDepthStencilState = &depth;
+
+			createInfo.layout = pipelineLayout_;
+
+			createInfo.pNext = &rendering;
+
+			auto result = device_.get().vk().createGraphicsPipeline(nullptr, createInfo);
+
+			VK_CHECK(result.result);
+
+			pipeline_ = result.value;
+		}
+
+		//TODO:Implement move constructors
+		GraphicsPipeline(GraphicsPipeline&& other) = delete;
+		GraphicsPipeline& operator=(GraphicsPipeline&& other) noexcept
+		{
+			destroy();
+
+			destroyed_ = other.destroyed_;
+			other.destroyed_ = true;
+
+			manual_ = other.manual_;
+			other.manual_ = false;
+
+			pipeline_ = other.pipeline_;
+			other.pipeline_ = nullptr;
+
+			pipelineLayout_ = other.pipelineLayout_;
+			other.pipelineLayout_ = nullptr;
+
+			//TODO:Device should be the same, or implement stuff in Device
+
+			shaders_ = other.shaders_;
+			other.shaders_ = vec_ref<Shader>();
+
+			topology_ = other.topology_;
+			polygonMode_ = other.polygonMode_;
+			extent_ = other.extent_;
+			imageFormat_ = other.imageFormat_;
+
+			return *this;
+		}
+
+		//No copy constructors
+		GraphicsPipeline(GraphicsPipeline& other) = delete;
+		GraphicsPipeline& operator=(GraphicsPipeline& other) = delete;
+
+		void destroy()
+		{
+			if (destroyed_) { return; }
+			device_.get().vk().destroyPipelineLayout(pipelineLayout_);
+			device_.get().vk().destroyPipeline(pipeline_);
+			destroyed_ = true;
+		}
+
+		~GraphicsPipeline()
+		{
+			if (manual_) { return; }
+			destroy();
+		}
+
+		vk::Pipeline vk() const  { return pipeline_; }
+		vk::PipelineLayout layout() const  { return pipelineLayout_; }
+
+	private:
+		vk::Pipeline pipeline_{};
+		vk::PipelineLayout pipelineLayout_{};
+
+		ref<Device> device_;
+
+		vec_ref<Shader> shaders_{};
+
+		vk::PrimitiveTopology topology_{};
+		vk::PolygonMode polygonMode_{};
+		vk::Extent2D extent_{};
+		vk::Format imageFormat_{};
+	};
+
+	//Subsystem owning an allocation, memory being accounted per tag (see Allocator::stats)
+	enum class MemoryTag
+	{
+		VERTEX,
+		INDEX,
+		MATRIX,
+		STAGING,
+		IMAGE,
+		DEPTH,
+		OTHER,
+		COUNT
+	};
+
+	//Custom VMA pool an allocation comes from, keeping resources of different lifetimes apart (see Allocator::PoolConfig)
+	//INFO:DEFAULT uses the default pools of VMA, chosen for render targets and allocations too large for their pool
+	enum class MemoryPool
+	{
+		DEFAULT,
+		STAGING, //Linear, short lived uploads (the long lived staging rings of LocalBuffer use DEFAULT)
+		FRAME, //Linear, per frame data
+		GEOMETRY, //Blocks, meshes and matrices
+		TEXTURE, //Blocks, sampled images
+		COUNT
+	};
+
+	//Usage and budget of a memory heap, usage being that of the whole process when VK_EXT_memory_budget is enabled
+	//Copyable
+	struct HeapStats
+	{
+		vk::DeviceSize usage = 0;
+		vk::DeviceSize budget = 0;
+
+		vk::DeviceSize blockBytes = 0; //Device memory allocated by this allocator
+		vk::DeviceSize allocationBytes = 0; //Bytes of blockBytes used by resources
+
+		bool deviceLocal = false;
+	};
+
+	//Copyable
+	struct MemoryStats
+	{
+		std::vector<HeapStats> heaps{};
+		std::array<vk::DeviceSize, INDEX(MemoryTag::COUNT)> tags{}; //Bytes allocated per MemoryTag
+		std::array<vk::DeviceSize, INDEX(MemoryPool::COUNT)> poolBlocks{}; //Device memory held by the blocks of each custom pool
+	};
+
+	class Allocator : Destroyable
+	{
+	public:
+		Allocator(ref<Instance> instance, ref<Device> device) : instance_(instance), device_(device)
+		{
+			VmaAllocatorCreateInfo createInfo = {};
+
+			createInfo.physicalDevice = device_.get().physicalDevice();
+			createInfo.device = device_.get().vk();
+			createInfo.instance = instance_.get().vk();
+			createInfo.flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
+			if (device_.get().isEnabled(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+			{
+				createInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT; //INFO:Otherwise VMA estimates usage from its own blocks and budget as 80% of each heap
+			}
+
+			VmaVulkanFunctions vulkanFunctions = {};
+			vulkanFunctions.vkGetInstanceProcAddr = vkGetInstanceProcAddress;
+			vulkanFunctions.vkGetDeviceProcAddr = vkGetDeviceProcAddress;
+
+			createInfo.pVulkanFunctions = &vulkanFunctions;
+
+			VK_CHECK(vk::Result(vmaCreateAllocator(&createInfo, &allocator_)));
+		}
+
+		//TODO:Implement move constructors
+		Allocator(Allocator&& other) noexcept : allocator_(other.allocator_), instance_(other.instance_), device_(other.device_),
+			pressureCallbacks_(std::move(other.pressureCallbacks_)), pressureThreshold_(other.pressureThreshold_), frameIndex_(other.frameIndex_.load()),
+			poolConfigs_(other.poolConfigs_), pools_(std::move(other.pools_))
+		{
+			destroyed_ = other.destroyed_;
+			other.destroyed_ = true;
+
+			manual_ = other.manual_;
+			other.manual_ = false;
+
+			other.allocator_ = VmaAllocator(nullptr);
+
+			for (size_t t = 0; t < tagBytes_.size(); t++) { tagBytes_[t] = other.tagBytes_[t].load(); }
+		}
+		Allocator& operator=(Allocator&& other) noexcept
+		{
+			destroy();
+
+			destroyed_ = other.destroyed_;
+			other.destroyed_ = true;
+
+			manual_ = other.manual_;
+			other.manual_ = false;
+
+			allocator_ = other.allocator_;
+			other.allocator_ = VmaAllocator(nullptr);
+
+			instance_ = other.instance_;
+
+			device_ = other.device_;
+
+			for (size_t t = 0; t < tagBytes_.size(); t++) { tagBytes_[t] = other.tagBytes_[t].load(); }
+			pressureCallbacks_ = std::move(other.pressureCallbacks_);
+			pressureThreshold_ = other.pressureThreshold_;
+			frameIndex_ = other.frameIndex_.load();
+
+			poolConfigs_ = other.poolConfigs_;
+			pools_ = std::move(other.pools_);
+			other.pools_.clear();
+
+			return *this;
+		}
+
+		//No copy constructors
+		Allocator(Allocator& other) = delete;
+		Allocator& operator=(Allocator& other) = delete;
+
+		//INFO:Every buffer and image must be destroyed beforehand, including those of custom pools
+		void destroy()
+		{
+			if (destroyed_) { return; }
+			for (auto& [key, pool] : pools_) { vmaDestroyPool(allocator_, pool); }
+			pools_.clear();
+			vmaDestroyAllocator(allocator_);
+			destroyed_ = true;
+		}
+
+		~Allocator()
+		{
+			if (manual_) { return; }
+			destroy();
+		}
+
+		VmaAllocator vma() const { return allocator_; }
+
+		//Accounts the memory of allocation to tag, until untrack is called with the same tag
+		//Thread safe
+		void track(MemoryTag tag, VmaAllocation allocation)
+		{
+			tagBytes_[INDEX(tag)] += allocationSize(allocation);
+		}
+
+		//Thread safe
+		void untrack(MemoryTag tag, VmaAllocation allocation)
+		{
+			tagBytes_[INDEX(tag)] -= allocationSize(allocation);
+		}
+
+		//Usage and budget of every heap and bytes allocated per tag
+		//INFO:Heap budgets are refreshed by VMA once per frame index (see nextFrame), or after allocations made through it
+		//Thread safe
+		MemoryStats stats()
+		{
+			MemoryStats stats = {};
+
+			const VkPhysicalDeviceMemoryProperties* properties = nullptr;
+			vmaGetMemoryProperties(allocator_, &properties);
+
+			std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets = {};
+			vmaGetHeapBudgets(allocator_, budgets.data());
+
+			stats.heaps.resize(properties->memoryHeapCount);
+			for (uint32_t h = 0; h < properties->memoryHeapCount; h++)
+			{
+				stats.heaps[h].usage = budgets[h].usage;
+				stats.heaps[h].budget = budgets[h].budget;
+				stats.heaps[h].blockBytes = budgets[h].statistics.blockBytes;
+				stats.heaps[h].allocationBytes = budgets[h].statistics.allocationBytes;
+				stats.heaps[h].deviceLocal = (properties->memoryHeaps[h].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+			}
+
+			for (size_t t = 0; t < tagBytes_.size(); t++) { stats.tags[t] = tagBytes_[t].load(); }
+
+			std::scoped_lock lock(poolMutex_);
+			for (auto& [key, pool] : pools_)
+			{
+				VmaStatistics poolStats = {};
+				vmaGetPoolStatistics(allocator_, pool, &poolStats);
+				stats.poolBlocks[INDEX(key.first)] += poolStats.blockBytes;
+			}
+
+			return stats;
+		}
+
+		//Block size and algorithm of a custom pool, blockSize 0 being the VMA default
+		//Copyable
+		struct PoolConfig
+		{
+			vk::DeviceSize blockSize = 0;
+			bool linear = false; //Allocations placed one after the other, freed space being reused once the allocations around it are freed
+		};
+
+		//Changes the configuration of pool, only applied to the memory types it has no VMA pool for yet (call before allocating from it)
+		void configurePool(MemoryPool pool, PoolConfig config)
+		{
+			std::scoped_lock lock(poolMutex_);
+			poolConfigs_[INDEX(pool)] = config;
+		}
+
+		//VMA pool of selector for the memory type VMA picks for createInfo and allocationInfo, created on first use.
+		//nullptr for DEFAULT and for allocations larger than half a block, left to the default pools (dedicated memory) like VMA would do
+		//Thread safe
+		VmaPool pool(MemoryPool selector, const VkBufferCreateInfo& createInfo, const VmaAllocationCreateInfo& allocationInfo)
+		{
+			if (selector == MemoryPool::DEFAULT) { return VmaPool(nullptr); }
+
+			uint32_t memoryType = 0;
+			VK_CHECK(vk::Result(vmaFindMemoryTypeIndexForBufferInfo(allocator_, &createInfo, &allocationInfo, &memoryType)));
+
+			return pool(selector, createInfo.size, memoryType);
+		}
+
+		//Thread safe
+		VmaPool pool(MemoryPool selector, const VkImageCreateInfo& createInfo, const VmaAllocationCreateInfo& allocationInfo)
+		{
+			if (selector == MemoryPool::DEFAULT) { return VmaPool(nullptr); }
+
+			uint32_t memoryType = 0;
+			VK_CHECK(vk::Result(vmaFindMemoryTypeIndexForImageInfo(allocator_, &createInfo, &allocationInfo, &memoryType)));
+
+			//INFO:Size the driver will ask for (tiling, mips and alignment included), queried without creating the image (core in 1.3)
+			vk::DeviceImageMemoryRequirements requirementsInfo = {};
+			requirementsInfo.pCreateInfo = reinterpret_cast<const vk::ImageCreateInfo*>(&createInfo);
+			vk::DeviceSize size = device_.get().vk().getImageMemoryRequirements(requirementsInfo).memoryRequirements.size;
+
+			return pool(selector, size, memoryType);
+		}
+
+		//Called by nextFrame with the index of every heap whose usage reaches threshold times its budget, so that streaming systems
+		//stop loading or evict before allocations fail. threshold is shared by every callback, the last one given being kept
+		void onBudgetPressure(std::function<void(uint32_t heap, const HeapStats& stats)> callback, float threshold = 0.9f)
+		{
+			std::scoped_lock lock(pressureMutex_);
+			pressureCallbacks_.push_back(std::move(callback));
+			pressureThreshold_ = threshold;
+		}
+
+		//To be called once per frame, refreshes the heap budgets then calls the budget pressure callbacks
+		void nextFrame()
+		{
+			vmaSetCurrentFrameIndex(allocator_, ++frameIndex_);
+
+			//INFO:Callbacks are copied out and called unlocked, so that they can register other callbacks without deadlocking
+			std::vector<std::function<void(uint32_t, const HeapStats&)>> callbacks;
+			float threshold = 0.0f;
+			{
+				std::scoped_lock lock(pressureMutex_);
+				callbacks = pressureCallbacks_;
+				threshold = pressureThreshold_;
+			}
+			if (callbacks.empty()) { return; }
+
+			MemoryStats current = stats();
+			for (uint32_t h = 0; h < current.heaps.size(); h++)
+			{
+				const HeapStats& heap = current.heaps[h];
+				if (heap.budget == 0 || heap.usage < static_cast<vk::DeviceSize>(threshold * heap.budget)) { continue; }
+
+				for (auto& callback : callbacks) { callback(h, heap); }
+			}
+		}
+
+	private:
+		VmaAllocator allocator_{};
+
+		ref<Instance> instance_;
+		ref<Device> device_;
+
+		std::array<std::atomic<vk::DeviceSize>, INDEX(MemoryTag::COUNT)> tagBytes_{};
+
+		std::mutex pressureMutex_;
+		std::vector<std::function<void(uint32_t, const HeapStats&)>> pressureCallbacks_{};
+		float pressureThreshold_ = 0.9f;
+		std::atomic<uint32_t> frameIndex_ = 0;
+
+		//INFO:Staging and frame data churn in linear blocks, geometry and textures live in large blocks apart from them
+		std::array<PoolConfig, INDEX(MemoryPool::COUNT)> poolConfigs_ =
+		{{
+			{ 0, false }, //DEFAULT, unused
+			{ 64 * 1024 * 1024, true }, //STAGING
+			{ 16 * 1024 * 1024, true }, //FRAME
+			{ 256 * 1024 * 1024, false }, //GEOMETRY
+			{ 128 * 1024 * 1024, false } //TEXTURE
+		}};
+
+		std::mutex poolMutex_;
+		std::map<std::pair<MemoryPool, uint32_t>, VmaPool> pools_{}; //Per selector and memory type
+
+		VmaPool pool(MemoryPool selector, vk::DeviceSize size, uint32_t memoryType)
+		{
+			std::scoped_lock lock(poolMutex_);
+
+			const PoolConfig& config = poolConfigs_[INDEX(selector)];
+			if (config.blockSize != 0 && size > config.blockSize / 2) { return VmaPool(nullptr); } //INFO:Custom pools with a block size never fall back to dedicated memory
+
+			auto found = pools_.find(std::make_pair(selector, memoryType));
+			if (found != pools_.end()) { return found->second; }
+
+			VmaPoolCreateInfo createInfo = {};
+			createInfo.memoryTypeIndex = memoryType;
+			createInfo.blockSize = config.blockSize;
+			createInfo.flags = config.linear ? VMA_POOL_CREATE_LINEAR_ALGORITHM_BIT : 0;
+
+			VmaPool pool;
+			VK_CHECK(vk::Result(vmaCreatePool(allocator_, &createInfo, &pool)));
+
+			static constexpr std::array<const char*, INDEX(MemoryPool::COUNT)> names = { "DEFAULT", "STAGING", "FRAME", "GEOMETRY", "TEXTURE" };
+			vmaSetPoolName(allocator_, pool, names[INDEX(selector)]);
+
+			pools_[std::make_pair(selector, memoryType)] = pool;
+			return pool;
+		}
+
+		vk::DeviceSize allocationSize(VmaAllocation allocation)
+		{
+			VmaAllocationInfo info = {};
+			vmaGetAllocationInfo(allocator_, allocation, &info);
+			return info.size;
+		}
+	};
+
+	class Buffer : public Destroyable
+	{
+	public:
+		Buffer(ref<Device> device, ref<Allocator> allocator, vk::Flags<vk::BufferUsageFlagBits> usage, vk::DeviceSize size, bool mappable = false, bool systemMemory = false,
+			bool deviceLocal = false, MemoryTag tag = MemoryTag::OTHER, MemoryPool pool = MemoryPool::DEFAULT)
+			: device_(device), allocator_(allocator), size_(size), mappable_(mappable), tag_(tag)
+		{
+			vk::BufferCreateInfo createInfo = {};
+
+			createInfo.size = size;
+			createInfo.usage = usage | vk::BufferUsageFlagBits::eShaderDeviceAddress;
+			
+
+			VkBufferCreateInfo vkCreateInfo = static_cast<VkBufferCreateInfo>(createInfo);
+
+			VmaAllocationCreateInfo allocInfo = {};
+			allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+			if (systemMemory)
+			{
+				allocInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;//TODO:Later pick cpu memory only when device local host visible memory is not enough
+				allocInfo.preferredFlags = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT; //Prefer system memory
+			}
+
+			if (mappable)
+			{
+				allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+			}
+
+			//INFO:Mappable device local memory (resizable BAR) when there is some, VMA falling back to host memory read by the device through PCIe
+			if (mappable && deviceLocal)
+			{
+				allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+				allocInfo.preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+			}
+
+			allocInfo.pool = allocator_.get().pool(pool, vkCreateInfo, allocInfo);
+
+			VkBuffer buffer;
+
+			VK_CHECK(vk::Result(vmaCreateBuffer(allocator_.get().vma(), &vkCreateInfo, &allocInfo, &buffer, &allocation_, nullptr)));
+
+			buffer_ = vk::Buffer(buffer);
+			allocator_.get().track(tag_, allocation_);
+
+			//TODO:Look into VMA Persistently mapped memory
+			if (mappable_)
+			{
+				vmaMapMemory(allocator_.get().vma(), allocation_, &mappedMemory);
+			}
+		}
+
+		//TODO:Implement move constructors
+		Buffer(Buffer&& other) noexcept : device_(other.device_), allocator_(other.allocator_), buffer_(other.buffer_),
+			allocation_(other.allocation_), size_(other.size_), address_(other.address_), mappable_(other.mappable_), mappedMemory(other.mappedMemory), tag_(other.tag_)
+		{
+			destroyed_ = other.destroyed_;
+			other.destroyed_ = true;
+
+			manual_ = other.manual_;
+			other.manual_ = false;
+
+			other.buffer_ = vk::Buffer(nullptr);
+			other.allocation_ = VmaAllocation(nullptr);
+			other.size_ = 0;
+			other.address_ = 0;
+			other.mappable_ = false;
+			other.mappedMemory = nullptr;
+		}
+		Buffer& operator=(Buffer&& other) noexcept
+		{
+			destroy();
+
+			destroyed_ = other.destroyed_;
+			other.destroyed_ = true;
+
+			manual_ = other.manual_;
+			other.manual_ = false;
+
+			device_ = other.device_;
+
+			allocator_ = other.allocator_;
+
+			buffer_ = other.buffer_;
+			other.buffer_ = vk::Buffer(nullptr);
+
+			allocation_ = other.allocation_;
+			other.allocation_ = VmaAllocation(nullptr);
+
+			size_ = other.size_;
+			other.size_ = 0;
+
+			address_ = other.address_;
+			other.address_ = 0;
+
+			mappable_ = other.mappable_;
+			other.mappable_ = false;
+
+			mappedMemory = other.mappedMemory;
+			other.mappedMemory = nullptr;
+
+			tag_ = other.tag_;
+
+			return *this;
+		}
+
+		//No copy constructors
+		Buffer(Buffer& other) = delete;
+		Buffer& operator=(Buffer& other) = delete;
+
+
+		void destroy()
+		{
+			if (destroyed_) { return; }
+			if (mappable_) { vmaUnmapMemory(allocator_.get().vma(), allocation_); }
+			allocator_.get().untrack(tag_, allocation_);
+			vmaDestroyBuffer(allocator_.get().vma(), buffer_, allocation_);
+			destroyed_ = true;
+		}
+
+		~Buffer()
+		{
+			if (manual_) { return; }
+			destroy();
+		}
+
+		void upload(const void *data, size_t size, uint32_t offset = 0)
+		{
+			if (!mappable_) { KILL("Trying to map to a buffer that is not mappable"); }
+			
+			char* offsetDst = static_cast<char*>(mappedMemory) + offset;//We assume that sizeof(char) = 1
+
+			memcpy(offsetDst, data, size);
+		}
+
+		//Persistently mapped memory, for callers writing their data in place
+		void* mapped()
+		{
+			if (!mappable_) { KILL("Trying to map to a buffer that is not mappable"); }
+
+			return mappedMemory;
+		}
+
+		vk::DeviceAddress address()
+		{
+			if (address_ != 0) { return address_; }
+
+			vk::BufferDeviceAddressInfo addressInfo = {};
+			addressInfo.buffer = buffer_;
+
+			address_ = device_.get().vk().getBufferAddress(&addressInfo);
+			return address_;
+		}
+
+		vk::DeviceSize size()
+		{
+			return size_;
+		}
+
+		vk::Buffer vk()
+		{
+			return buffer_;
+		}
+
+		VmaAllocation allocation()
+		{
+			return allocation_;
+		}
+
+	protected:
+		ref<Device> device_;
+		ref<Allocator> allocator_;
+
+		vk::Buffer buffer_;
+		VmaAllocation allocation_;
+
+		//Exchanges the buffers and memory of two buffers made with the same allocator, for buffers replacing theirs (see LocalBuffer::growth)
+		void swap(Buffer& other)
+		{
+			std::swap(buffer_, other.buffer_);
+			std::swap(allocation_, other.allocation_);
+			std::swap(size_, other.size_);
+			std::swap(address_, other.address_);
+			std::swap(mappable_, other.mappable_);
+			std::swap(mappedMemory, other.mappedMemory);
+			std::swap(tag_, other.tag_);
+		}
+
+		vk::DeviceSize size_ = 0;
+
+		vk::DeviceAddress address_ = 0;
+
+		bool mappable_ = false;
+		void* mappedMemory = nullptr;
+
+		MemoryTag tag_;
+	};
+
+	class DepthImage : Destroyable
+	{
+	public:
+		DepthImage(ref<Device> device, ref<Allocator> allocator, vk::Extent2D extent, MemoryPool pool = MemoryPool::DEFAULT) : device_(device), allocator_(allocator)
+		{
+			vk::Extent3D depthImageExtent = {};
+			depthImageExtent.width = extent.width;
+			depthImageExtent.height = extent.height;
+			depthImageExtent.depth = 1;
+
+			vk::Format depthFormat = vk::Format::eD32Sfloat;
+
+			vk::ImageCreateInfo createInfo = {};
+			createInfo.imageType = vk::ImageType::e2D;
+
+			createInfo.format = depthFormat;
+			createInfo.extent = depthImageExtent;
+
+			createInfo.mipLevels = 1;
+			createInfo.arrayLayers = 1;
+			createInfo.samples = vk::SampleCountFlagBits::e1;
+			createInfo.tiling = vk::ImageTiling::eOptimal;
+			createInfo.usage = vk::ImageUsageFlagBits::eDepthStencilAttachment;
+
+			VkImageCreateInfo vkCreateInfo = static_cast<VkImageCreateInfo>(createInfo);
+
+			VmaAllocationCreateInfo allocationCreateInfo = {};
+			allocationCreateInfo.usage = VMA_MEMORY_USAGE_AUTO; //Use auto for depth-stencil https://gpuopen-librariesandsdks.github.io/VulkanMemoryAllocator/html/usage_patterns.html
+			allocationCreateInfo.requiredFlags = static_cast<VkMemoryPropertyFlags>(vk::MemoryPropertyFlagBits::eDeviceLocal);//TODO:Not sure about that here
+			allocationCreateInfo.pool = allocator_.get().pool(pool, vkCreateInfo, allocationCreateInfo);
+
+			VkImage vkImage;
+			VK_CHECK(vk::Result(vmaCreateImage(allocator_.get().vma(), &vkCreateInfo, &allocationCreateInfo, &vkImage, &allocation_, nullptr)));
+			image_ = vk::Image(vkImage);
+			allocator_.get().track(MemoryTag::DEPTH, allocation_);
+
+			vk::ImageViewCreateInfo viewCreateInfo = {};
+			viewCreateInfo.viewType = vk::ImageViewType::e2D;
+
+			viewCreateInfo.image = image_;
+			viewCreateInfo.format = depthFormat;
+
+			viewCreateInfo.subresourceRange.baseMipLevel = 0;
+			viewCreateInfo.subresourceRange.levelCount = 1;
+
+			viewCreateInfo.subresourceRange.baseArrayLayer = 0;
+			viewCreateInfo.subresourceRange.layerCount = 1;
+
+			viewCreateInfo.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eDepth;
+
+			VK_CHECK(device_.get().vk().createImageView(&viewCreateInfo, nullptr, &view_));
+		}
+		//TODO:Implement move constructors
+		DepthImage(DepthImage&& other) noexcept : image_(other.image_), view_(other.view_), allocation_(other.allocation_),
+			device_(other.device_), allocator_(other.allocator_)
+		{
+			destroyed_ = other.destroyed_;
+			other.destroyed_ = true;
+
+			manual_ = other.manual_;
+			other.manual_ = false;
+
+			other.image_ = vk::Image(nullptr);
+			other.view_ = vk::ImageView(nullptr);
+			other.allocation_ = VmaAllocation(nullptr);
+
+		}
+		DepthImage& operator=(DepthImage&& other) noexcept
+		{
+			destroy();
+
+			destroyed_ = other.destroyed_;
+			other.destroyed_ = true;
+
+			manual_ = other.manual_;
+			other.manual_ = false;
+
+			image_ = other.image_;
+			other.image_ = vk::Image(nullptr);
+
+			view_ = other.view_;
+			other.view_ = vk::ImageView(nullptr);
+
+			allocation_ = other.allocation_;
+			other.allocation_ = VmaAllocation(nullptr);
+
+			device_ = other.device_;
+
+			allocator_ = other.allocator_;
+		}
+
+		//No copy constructors
+		DepthImage(DepthImage& other) = delete;
+		DepthImage& operator=(DepthImage& other) = delete;
+
+		void destroy()
+		{
+			if (destroyed_) { return; }
+			device_.get().vk().destroyImageView(view_);
+			allocator_.get().untrack(MemoryTag::DEPTH, allocation_);
+			vmaDestroyImage(allocator_.get().vma(), image_, allocation_);
+			destroyed_ = true;
+		}
+
+		~DepthImage()
+		{
+			if (manual_) { return; }
+			destroy();
+		}
+
+		vk::Image image() const { return image_; }
+		vk::ImageView view() const { return view_; }
+
+	private:
+		vk::Image image_;
+		vk::ImageView view_;
+		VmaAllocation allocation_;
+
+		ref<Device> device_;
+		ref<Allocator> allocator_;
+	};
+
+	//Axis aligned bounding box, in mesh space
+	//Copyable
+	struct Bounds
+	{
+		glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+		glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+
+		void extend(const glm::vec3& point)
+		{
+			min = glm::min(min, point);
+			max = glm::max(max, point);
+		}
+
+		bool empty() const
+		{
+			return min.x > max.x || min.y > max.y || min.z > max.z;
+		}
+
+		glm::vec3 center() const
+		{
+			return (min + max) * 0.5f;
+		}
+
+		//Bounds of the box once transformed by matrix, from its center and half extent (Arvo)
+		Bounds transformed(const glm::mat4& matrix) const
+		{
+			if (empty()) { return {}; }
+
+			glm::vec3 halfExtent = (max - min) * 0.5f;
+			glm::vec3 transformedCenter = glm::vec3(matrix * glm::vec4(center(), 1.f));
+
+			Bounds bounds = {};
+#ifdef SOULKAN_SSE
+			__m128 signMask = _mm_set1_ps(-0.f);
+			__m128 extent = _mm_mul_ps(_mm_andnot_ps(signMask, _mm_loadu_ps(&matrix[0][0])), _mm_set1_ps(halfExtent.x));
+			extent = _mm_add_ps(extent, _mm_mul_ps(_mm_andnot_ps(signMask, _mm_loadu_ps(&matrix[1][0])), _mm_set1_ps(halfExtent.y)));
+			extent = _mm_add_ps(extent, _mm_mul_ps(_mm_andnot_ps(signMask, _mm_loadu_ps(&matrix[2][0])), _mm_set1_ps(halfExtent.z)));
+
+			alignas(16) float transformedExtent[4];
+			_mm_store_ps(transformedExtent, extent);
+			glm::vec3 extentVector(transformedExtent[0], transformedExtent[1], transformedExtent[2]);
+#else
+			glm::vec3 extentVector(0.f);
+			for (int column = 0; column < 3; column++)
+			{
+				extentVector += glm::abs(glm::vec3(matrix[column])) * halfExtent[column];
+			}
+#endif
+			bounds.min = transformedCenter - extentVector;
+			bounds.max = transformedCenter + extentVector;
+
+			return bounds;
+		}
+	};
+
+	//Bounding sphere, in mesh space
+	//Copyable
+	struct BoundingSphere
+	{
+		glm::vec3 center = glm::vec3(0.f);
+		float radius = 0.f;
+
+		//Sphere once transformed by matrix, the radius being scaled by the largest axis scale
+		BoundingSphere transformed(const glm::mat4& matrix) const
+		{
+			BoundingSphere sphere = {};
+			sphere.center = glm::vec3(matrix * glm::vec4(center, 1.f));
+
+			float scale = std::max({ glm::length(glm::vec3(matrix[0])), glm::length(glm::vec3(matrix[1])), glm::length(glm::vec3(matrix[2])) });
+			sphere.radius = radius * scale;
+
+			return sphere;
+		}
+	};
+
+	//Planes of a view frustum, xyz being the normal pointing inside and w the offset (dot(normal, point) + w >= 0 inside)
+	//Copyable
+	struct Frustum
+	{
+		std::array<glm::vec4, 6> planes{};
+
+		//Planes of clip space out of a projection * view matrix (Gribb and Hartmann), world space planes for a world space matrix
+		//INFO:The near plane is taken for a [-1, 1] depth range, which also contains the [0, 1] Vulkan one
+		static Frustum fromMatrix(const glm::mat4& matrix)
+		{
+			auto row = [&](int r) { return glm::vec4(matrix[0][r], matrix[1][r], matrix[2][r], matrix[3][r]); };
+
+			Frustum frustum = {};
+			frustum.planes = { row(3) + row(0), row(3) + row(0) * -1.f, row(3) + row(1), row(3) + row(1) * -1.f, row(3) + row(2), row(3) + row(2) * -1.f };
+
+			for (auto& plane : frustum.planes)
+			{
+				plane = plane * (1.f / glm::length(glm::vec3(plane)));
+			}
+
+			return frustum;
+		}
+
+		//Conservative, spheres near the corners can be kept while outside
+		bool intersects(const BoundingSphere& sphere) const
+		{
+			for (const auto& plane : planes)
+			{
+				if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius) { return false; }
+			}
+
+			return true;
+		}
+	};
+
+	//Bounds of count points, the x, y, z of point i being at base[offset(i)] with base holding floatCount floats
+	//INFO:Vectorized with AVX2 gathers (8 points per iteration) or SSE (one point per instruction), the scalar loop being the fallback
+	template<typename Offset>
+	Bounds pointBounds(const float* base, size_t floatCount, size_t count, Offset&& offset)
+	{
+		Bounds bounds = {};
+		size_t i = 0;
+
+#ifdef SOULKAN_AVX2
+		__m256 minX = _mm256_set1_ps(bounds.min.x), minY = minX, minZ = minX;
+		__m256 maxX = _mm256_set1_ps(bounds.max.x), maxY = maxX, maxZ = maxX;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256i offsets = _mm256_setr_epi32(static_cast<int>(offset(i + 0)), static_cast<int>(offset(i + 1)), static_cast<int>(offset(i + 2)),
+				static_cast<int>(offset(i + 3)), static_cast<int>(offset(i + 4)), static_cast<int>(offset(i + 5)), static_cast<int>(offset(i + 6)),
+				static_cast<int>(offset(i + 7)));
+
+			__m256 x = _mm256_i32gather_ps(base, offsets, 4);
+			__m256 y = _mm256_i32gather_ps(base + 1, offsets, 4);
+			__m256 z = _mm256_i32gather_ps(base + 2, offsets, 4);
+
+			minX = _mm256_min_ps(minX, x); maxX = _mm256_max_ps(maxX, x);
+			minY = _mm256_min_ps(minY, y); maxY = _mm256_max_ps(maxY, y);
+			minZ = _mm256_min_ps(minZ, z); maxZ = _mm256_max_ps(maxZ, z);
+		}
+
+		alignas(32) float lanes[6][8];
+		_mm256_store_ps(lanes[0], minX); _mm256_store_ps(lanes[1], minY); _mm256_store_ps(lanes[2], minZ);
+		_mm256_store_ps(lanes[3], maxX); _mm256_store_ps(lanes[4], maxY); _mm256_store_ps(lanes[5], maxZ);
+		for (size_t lane = 0; lane < 8 && i > 0; lane++)
+		{
+			bounds.extend(glm::vec3(lanes[0][lane], lanes[1][lane], lanes[2][lane]));
+			bounds.extend(glm::vec3(lanes[3][lane], lanes[4][lane], lanes[5][lane]));
+		}
+#elif defined(SOULKAN_SSE)
+		//INFO:The fourth float loaded with every point is ignored, points too close to the end of base are left to the scalar loop
+		__m128 minimum = _mm_set1_ps(bounds.min.x);
+		__m128 maximum = _mm_set1_ps(bounds.max.x);
+		for (; i < count && offset(i) + 4 <= floatCount; i++)
+		{
+			__m128 point = _mm_loadu_ps(base + offset(i));
+			minimum = _mm_min_ps(minimum, point);
+			maximum = _mm_max_ps(maximum, point);
+		}
+
+		alignas(16) float lanes[2][4];
+		_mm_store_ps(lanes[0], minimum);
+		_mm_store_ps(lanes[1], maximum);
+		if (i > 0)
+		{
+			bounds.extend(glm::vec3(lanes[0][0], lanes[0][1], lanes[0][2]));
+			bounds.extend(glm::vec3(lanes[1][0], lanes[1][1], lanes[1][2]));
+		}
+#endif
+		for (; i < count; i++)
+		{
+			const float* point = base + offset(i);
+			bounds.extend(glm::vec3(point[0], point[1], point[2]));
+		}
+
+		return bounds;
+	}
+
+	//Sphere around the center of bounds, its radius reaching the farthest point, points being addressed like in pointBounds
+	template<typename Offset>
+	BoundingSphere pointSphere(const float* base, size_t floatCount, size_t count, Offset&& offset, const Bounds& bounds)
+	{
+		BoundingSphere sphere = {};
+		if (count == 0) { return sphere; }
+
+		sphere.center = bounds.center();
+		float maxDistance = 0.f;
+		size_t i = 0;
+
+#ifdef SOULKAN_AVX2
+		__m256 centerX = _mm256_set1_ps(sphere.center.x);
+		__m256 centerY = _mm256_set1_ps(sphere.center.y);
+		__m256 centerZ = _mm256_set1_ps(sphere.center.z);
+		__m256 maximum = _mm256_setzero_ps();
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256i offsets = _mm256_setr_epi32(static_cast<int>(offset(i + 0)), static_cast<int>(offset(i + 1)), static_cast<int>(offset(i + 2)),
+				static_cast<int>(offset(i + 3)), static_cast<int>(offset(i + 4)), static_cast<int>(offset(i + 5)), static_cast<int>(offset(i + 6)),
+				static_cast<int>(offset(i + 7)));
+
+			__m256 x = _mm256_sub_ps(_mm256_i32gather_ps(base, offsets, 4), centerX);
+			__m256 y = _mm256_sub_ps(_mm256_i32gather_ps(base + 1, offsets, 4), centerY);
+			__m256 z = _mm256_sub_ps(_mm256_i32gather_ps(base + 2, offsets, 4), centerZ);
+
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+			maximum = _mm256_max_ps(maximum, distance);
+		}
+
+		alignas(32) float lanes[8];
+		_mm256_store_ps(lanes, maximum);
+		maxDistance = *std::max_element(lanes, lanes + 8);
+#elif defined(SOULKAN_SSE)
+		__m128 center = _mm_setr_ps(sphere.center.x, sphere.center.y, sphere.center.z, 0.f);
+		__m128 xyzMask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+		__m128 maximum = _mm_setzero_ps();
+		for (; i < count && offset(i) + 4 <= floatCount; i++)
+		{
+			__m128 delta = _mm_and_ps(_mm_sub_ps(_mm_loadu_ps(base + offset(i)), center), xyzMask);
+			__m128 squared = _mm_mul_ps(delta, delta);
+
+			//Horizontal sum, the distance ending up in every lane
+			squared = _mm_add_ps(squared, _mm_shuffle_ps(squared, squared, _MM_SHUFFLE(2, 3, 0, 1)));
+			squared = _mm_add_ps(squared, _mm_shuffle_ps(squared, squared, _MM_SHUFFLE(1, 0, 3, 2)));
+			maximum = _mm_max_ss(maximum, squared);
+		}
+		maxDistance = _mm_cvtss_f32(maximum);
+#endif
+		for (; i < count; i++)
+		{
+			const float* point = base + offset(i);
+			glm::vec3 delta = glm::vec3(point[0], point[1], point[2]) - sphere.center;
+			maxDistance = std::max(maxDistance, glm::dot(delta, delta));
+		}
+
+		sphere.radius = std::sqrt(maxDistance);
+		return sphere;
+	}
+
+	//Copyable
+	//TODO:Should become vec3 position, vec3 normal, vec3 uv
+	struct Vertex
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 uv;
+
+		//Vertex layout interface, see VertexBuffer
+		static constexpr const char* layoutName = "Vertex";
+		static constexpr bool boundsRelative = false; //Encoding does not depend on the mesh bounds
+
+		static Vertex encode(const Vertex& vertex, [[maybe_unused]] const Bounds& bounds)
+		{
+			return vertex;
+		}
+
+		static glm::mat4 decodeMatrix([[maybe_unused]] const Bounds& bounds)
+		{
+			return glm::mat4(1.f);
+		}
+
+		static std::string glsl()
+		{
+			return R"(
+struct PackedVertex
+{
+	vec3 position;
+	vec3 normal;
+	vec2 uv;
+};
+
+struct Vertex
+{
+	vec3 position;
+	vec3 normal;
+	vec2 uv;
+};
+
+Vertex decodeVertex(PackedVertex packed)
+{
+	return Vertex(packed.position, packed.normal, packed.uv);
+}
+)";
+		}
+	};
+
+	//IEEE 754 half precision, rounded to nearest even
+	uint16_t floatToHalf(float value)
+	{
+		uint32_t bits = std::bit_cast<uint32_t>(value);
+		uint32_t sign = (bits >> 16) & 0x8000;
+		uint32_t floatExponent = (bits >> 23) & 0xff;
+		int32_t exponent = static_cast<int32_t>(floatExponent) - 127 + 15;
+		uint32_t mantissa = bits & 0x7fffff;
+
+		if (floatExponent == 0xff) { return static_cast<uint16_t>(sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0)); } //Infinity and NaN
+		if (exponent >= 0x1f) { return static_cast<uint16_t>(sign | 0x7c00); } //Too big, infinity
+
+		if (exponent <= 0) //Subnormal half
+		{
+			if (exponent < -10) { return static_cast<uint16_t>(sign); }
+
+			mantissa |= 0x800000;
+			uint32_t shift = static_cast<uint32_t>(14 - exponent);
+			uint32_t half = mantissa >> shift;
+			uint32_t rest = mantissa & ((1u << shift) - 1);
+			uint32_t halfway = 1u << (shift - 1);
+			if (rest > halfway || (rest == halfway && (half & 1))) { half++; }
+
+			return static_cast<uint16_t>(sign | half);
+		}
+
+		uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+		uint32_t rest = mantissa & 0x1fff;
+		if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) { half++; } //INFO:A carry into the exponent still gives the right result, up to infinity
+
+		return static_cast<uint16_t>(sign | half);
+	}
+
+	float halfToFloat(uint16_t half)
+	{
+		uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+		uint32_t exponent = (half >> 10) & 0x1f;
+		uint32_t mantissa = half & 0x3ff;
+
+		if (exponent == 0x1f) { return std::bit_cast<float>(sign | 0x7f800000 | (mantissa << 13)); } //Infinity and NaN
+		if (exponent == 0) //Zero and subnormals
+		{
+			float value = std::ldexp(static_cast<float>(mantissa), -24);
+			return sign ? -value : value;
+		}
+
+		return std::bit_cast<float>(sign | ((exponent + 127 - 15) << 23) | (mantissa << 13));
+	}
+
+	//12 byte vertex: 16 bit positions normalized to the mesh bounds, 8+8 bit octahedral normal and half float uvs
+	//INFO:Positions are dequantized by decodeMatrix(bounds), meant to be folded into the model matrix, so the shader only unpacks
+	//INFO:Missing normals (zero vectors) decode to +z
+	//Copyable
+	struct CompactVertex
+	{
+		uint32_t positionXY; //unorm16 x | unorm16 y << 16
+		uint32_t positionZNormal; //unorm16 z | snorm8 octahedral x << 16 | snorm8 octahedral y << 24
+		uint32_t uv; //half u | half v << 16
+
+		//Vertex layout interface, see VertexBuffer
+		static constexpr const char* layoutName = "CompactVertex";
+		static constexpr bool boundsRelative = true;
+
+		static CompactVertex encode(const Vertex& vertex, const Bounds& bounds)
+		{
+			glm::vec3 extent = bounds.max - bounds.min;
+
+			CompactVertex compact = {};
+			compact.positionXY = unorm16(vertex.position.x, bounds.min.x, extent.x) | (unorm16(vertex.position.y, bounds.min.y, extent.y) << 16);
+			compact.positionZNormal = unorm16(vertex.position.z, bounds.min.z, extent.z) | (octahedral(vertex.normal) << 16);
+			compact.uv = static_cast<uint32_t>(floatToHalf(vertex.uv.x)) | (static_cast<uint32_t>(floatToHalf(vertex.uv.y)) << 16);
+
+			return compact;
+		}
+
+		//Maps the normalized positions back to mesh space
+		static glm::mat4 decodeMatrix(const Bounds& bounds)
+		{
+			glm::vec3 extent = bounds.max - bounds.min;
+
+			//Flat axes are stored as 0, any scale works
+			extent.x = (extent.x > 0.f) ? extent.x : 1.f;
+			extent.y = (extent.y > 0.f) ? extent.y : 1.f;
+			extent.z = (extent.z > 0.f) ? extent.z : 1.f;
+
+			return glm::translate(glm::mat4(1.f), bounds.min) * glm::scale(glm::mat4(1.f), extent);
+		}
+
+		//CPU side decoding, same as the glsl one followed by decodeMatrix
+		Vertex decode(const Bounds& bounds) const
+		{
+			glm::vec4 position = decodeMatrix(bounds) * glm::vec4((positionXY & 0xffff) / 65535.f, (positionXY >> 16) / 65535.f, (positionZNormal & 0xffff) / 65535.f, 1.f);
+
+			float x = std::max(static_cast<int8_t>((positionZNormal >> 16) & 0xff) / 127.f, -1.f);
+			float y = std::max(static_cast<int8_t>(positionZNormal >> 24) / 127.f, -1.f);
+			glm::vec3 normal(x, y, 1.f - std::abs(x) - std::abs(y));
+			float t = std::max(-normal.z, 0.f);
+			normal.x += (normal.x >= 0.f) ? -t : t;
+			normal.y += (normal.y >= 0.f) ? -t : t;
+
+			Vertex vertex = {};
+			vertex.position = glm::vec3(position);
+			vertex.normal = glm::normalize(normal);
+			vertex.uv = glm::vec2(halfToFloat(static_cast<uint16_t>(uv & 0xffff)), halfToFloat(static_cast<uint16_t>(uv >> 16)));
+
+			return vertex;
+		}
+
+		static std::string glsl()
+		{
+			return R"(
+struct PackedVertex
+{
+	uint positionXY;
+	uint positionZNormal;
+	uint uv;
+};
+
+struct Vertex
+{
+	vec3 position;
+	vec3 normal;
+	vec2 uv;
+};
+
+//Position is left normalized to the mesh bounds, the model matrix holds the dequantization
+Vertex decodeVertex(PackedVertex packed)
+{
+	Vertex vertex;
+
+	vertex.position = vec3(unpackUnorm2x16(packed.positionXY), unpackUnorm2x16(packed.positionZNormal).x);
+
+	vec2 octahedral = unpackSnorm4x8(packed.positionZNormal).zw;
+	vec3 normal = vec3(octahedral, 1.f - abs(octahedral.x) - abs(octahedral.y));
+	float t = max(-normal.z, 0.f);
+	normal.x += (normal.x >= 0.f) ? -t : t;
+	normal.y += (normal.y >= 0.f) ? -t : t;
+	vertex.normal = normalize(normal);
+
+	vertex.uv = unpackHalf2x16(packed.uv);
+
+	return vertex;
+}
+)";
+		}
+
+	private:
+		static uint32_t unorm16(float value, float min, float extent)
+		{
+			if (extent <= 0.f) { return 0; }
+
+			return static_cast<uint32_t>(std::round(std::clamp((value - min) / extent, 0.f, 1.f) * 65535.f));
+		}
+
+		//Unit vector projected on the octahedron then unfolded on a square, 8 bits per axis
+		static uint32_t octahedral(glm::vec3 normal)
+		{
+			float l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+			if (l1 == 0.f) { return 0; }
+
+			float x = normal.x / l1;
+			float y = normal.y / l1;
+			if (normal.z < 0.f) //Lower half folded over the diagonals
+			{
+				float foldedX = (1.f - std::abs(y)) * ((x >= 0.f) ? 1.f : -1.f);
+				float foldedY = (1.f - std::abs(x)) * ((y >= 0.f) ? 1.f : -1.f);
+				x = foldedX;
+				y = foldedY;
+			}
+
+			auto snorm8 = [](float value) { return static_cast<uint32_t>(static_cast<uint8_t>(static_cast<int8_t>(std::round(std::clamp(value, -1.f, 1.f) * 127.f)))); };
+
+			return snorm8(x) | (snorm8(y) << 8);
+		}
+	};
+
+	//Hashes the (position, normal, uv) indices triple of an .obj face corner, two corners sharing the same triple are the same vertex
+	struct ObjIndexHash
+	{
+		size_t operator()(const tinyobj::index_t& index) const
+		{
+			uint64_t hash = static_cast<uint64_t>(static_cast<uint32_t>(index.vertex_index)) * 0x9E3779B97F4A7C15;
+			hash ^= static_cast<uint64_t>(static_cast<uint32_t>(index.normal_index)) * 0xC2B2AE3D27D4EB4F;
+			hash ^= static_cast<uint64_t>(static_cast<uint32_t>(index.texcoord_index)) * 0x165667B19E3779F9;
+
+			return static_cast<size_t>(hash ^ (hash >> 29));
+		}
+	};
+
+	struct ObjIndexEqual
+	{
+		bool operator()(const tinyobj::index_t& a, const tinyobj::index_t& b) const
+		{
+			return a.vertex_index == b.vertex_index && a.normal_index == b.normal_index && a.texcoord_index == b.texcoord_index;
+		}
+	};
+
+	//Run of consecutive triangles of a .obj sharing the same shape (o or g) and material (usemtl), see ObjParser::groups
+	//Copyable
+	struct ObjGroup
+	{
+		uint32_t shape = 0; //In ObjParser::shapes
+		int32_t material = -1; //In ObjParser::materials, -1 before any usemtl
+		size_t firstCorner = 0;
+		size_t cornerCount = 0;
+	};
+
+	//Native .obj reader, the file is memory mapped, split into line aligned chunks and every chunk is parsed by its own thread
+	//INFO:Two passes over each chunk, the first one counts elements so that every thread knows where to write in the merged arrays
+	//and how to resolve relative (negative) indices, the second one parses straight into the merged arrays
+	//INFO:Faces are fan triangulated, corners reuse tinyobj::index_t so both readers feed the same deduplication
+	//Non copyable non movable
+	class ObjParser
+	{
+	public:
+		ObjParser(std::string filename, uint32_t threadCount = std::thread::hardware_concurrency())
+			: file_(filename)
+		{
+			//Small files are not worth the threads
+			size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount, file_.size() / minChunkSize_));
+
+			parseChunks(filename, chunkCount, chunkCount, false, {});
+		}
+
+		//Streaming reader, the file is parsed block after block (about blockSize bytes each, split between threads),
+		//onBlock(parser, firstCorner, endCorner) being called with the corners of every block once it is parsed
+		//INFO:The arrays are sized for the whole file by the counting pass, before the first block, only their parsed part is meaningful then
+		//OBJ faces only reference attributes defined above them, the corners of a block never need a later block
+		//withBounds computes bounds() of every position of the file during the counting pass, known before the first block is parsed
+		ObjParser(std::string filename, size_t blockSize, std::function<void(ObjParser&, size_t, size_t)>&& onBlock, bool withBounds = false,
+			uint32_t threadCount = std::thread::hardware_concurrency())
+			: file_(filename)
+		{
+			size_t blockCount = std::max<size_t>(1, file_.size() / blockSize);
+			size_t chunksPerBlock = std::max<size_t>(1, std::min<size_t>(threadCount, blockSize / minChunkSize_));
+
+			parseChunks(filename, blockCount * chunksPerBlock, chunksPerBlock, withBounds, onBlock);
+		}
+
+		//x, y, z floats
+		std::vector<float>& positions() { return positions_; }
+		//x, y, z floats
+		std::vector<float>& normals() { return normals_; }
+		//u, v floats
+		std::vector<float>& uvs() { return uvs_; }
+		//3 corners per triangle, 0 based indices into positions/normals/uvs, -1 when absent
+		std::vector<tinyobj::index_t>& corners() { return corners_; }
+		//Only computed by the streaming reader when asked to
+		Bounds bounds() { return bounds_; }
+
+		//Runs of corners sharing a shape and a material, in file order, complete once the whole file is parsed
+		std::vector<ObjGroup>& groups() { return groups_; }
+		//Names of o and g statements, shape 0 being "" for the faces before the first one
+		std::vector<std::string>& shapes() { return shapes_; }
+		//Names of usemtl statements, defined in the material libraries
+		std::vector<std::string>& materials() { return materials_; }
+		//Paths of the mtllib statements, relative to the working directory
+		std::vector<std::string>& materialLibraries() { return materialLibraries_; }
+
+	private:
+		struct ChunkCounts
+		{
+			size_t positions = 0;
+			size_t normals = 0;
+			size_t uvs = 0;
+			size_t corners = 0;
+			Bounds bounds = {};
+		};
+
+		//o, g, usemtl or mtllib statement, seen by a chunk at a given corner
+		struct Marker
+		{
+			size_t corner = 0;
+			char type = 'o'; //'o' (o and g), 'u' (usemtl) or 'm' (mtllib)
+			std::string name;
+		};
+
+		static constexpr size_t minChunkSize_ = 1 << 20;
+
+		MappedFile file_;
+
+		std::vector<float> positions_{};
+		std::vector<float> normals_{};
+		std::vector<float> uvs_{};
+		std::vector<tinyobj::index_t> corners_{};
+		Bounds bounds_ = {};
+
+		//INFO:State carries across chunks, markers are gathered by every chunk then replayed in file order once its group is parsed
+		std::vector<std::vector<Marker>> markers_{};
+		std::vector<ObjGroup> groups_{};
+		std::vector<std::string> shapes_{ "" };
+		std::vector<std::string> materials_{};
+		std::vector<std::string> materialLibraries_{};
+		ObjGroup openGroup_ = {};
+
+		std::mutex errorsMutex_;
+		std::string errors_{};
+
+		void error(std::string message)
+		{
+			std::lock_guard<std::mutex> lock(errorsMutex_);
+			if (errors_.empty()) { errors_ = message; }
+		}
+
+		//The file is split into chunkCount line aligned chunks, counted then parsed groupSize chunks (one thread each) at a time
+		void parseChunks(std::string filename, size_t chunkCount, size_t groupSize, bool withBounds, const std::function<void(ObjParser&, size_t, size_t)>& onGroup)
+		{
+			const char* begin = file_.data();
+			const char* end = begin + file_.size();
+
+			//Line aligned chunk boundaries
+			std::vector<const char*> boundaries(chunkCount + 1, end);
+			boundaries[0] = begin;
+			for (size_t c = 1; c < chunkCount; c++)
+			{
+				const char* split = std::max(begin + (file_.size() * c) / chunkCount, boundaries[c - 1]);
+				boundaries[c] = (split == begin) ? begin : nextLine(split - 1, end);
+			}
+
+			auto groups = [&](std::function<void(size_t)> chunk, std::function<void(size_t, size_t)> groupDone)
+				{
+					for (size_t group = 0; group < chunkCount; group += groupSize)
+					{
+						size_t groupEnd = std::min(group + groupSize, chunkCount);
+						parallelChunks(groupEnd - group, [&](size_t c) { chunk(group + c); });
+
+						if (groupDone) { groupDone(group, groupEnd); }
+					}
+				};
+
+			std::vector<ChunkCounts> counts(chunkCount);
+			groups([&](size_t c) { counts[c] = count(boundaries[c], boundaries[c + 1], withBounds); }, {});
+
+			//Prefix sums, where every chunk starts writing
+			std::vector<ChunkCounts> starts(chunkCount + 1);
+			ChunkCounts total = {};
+			for (size_t c = 0; c < chunkCount; c++)
+			{
+				starts[c] = total;
+
+				total.positions += counts[c].positions;
+				total.normals += counts[c].normals;
+				total.uvs += counts[c].uvs;
+				total.corners += counts[c].corners;
+
+				if (!counts[c].bounds.empty())
+				{
+					bounds_.extend(counts[c].bounds.min);
+					bounds_.extend(counts[c].bounds.max);
+				}
+			}
+			starts[chunkCount] = total;
+
+			positions_.resize(total.positions * 3);
+			normals_.resize(total.normals * 3);
+			uvs_.resize(total.uvs * 2);
+			corners_.resize(total.corners);
+
+			markers_.resize(chunkCount);
+
+			groups([&](size_t c) { parse(boundaries[c], boundaries[c + 1], starts[c], markers_[c]); }, [&](size_t group, size_t groupEnd)
+				{
+					if (!errors_.empty())
+					{
+						KILL(std::format("Killing process, error while parsing [{}]: {}", filename, errors_));
+					}
+
+					for (size_t c = group; c < groupEnd; c++)
+					{
+						replayMarkers(filename, markers_[c]);
+					}
+
+					if (onGroup) { onGroup(*this, starts[group].corners, starts[groupEnd].corners); }
+				});
+
+			closeGroup(total.corners);
+			markers_ = {};
+		}
+
+		void closeGroup(size_t corner)
+		{
+			openGroup_.cornerCount = corner - openGroup_.firstCorner;
+			if (openGroup_.cornerCount > 0) { groups_.push_back(openGroup_); }
+
+			openGroup_.firstCorner = corner;
+		}
+
+		void replayMarkers(std::string filename, const std::vector<Marker>& markers)
+		{
+			for (const auto& marker : markers)
+			{
+				if (marker.type == 'm')
+				{
+					materialLibraries_.push_back((std::filesystem::path(filename).parent_path() / marker.name).string());
+					continue;
+				}
+
+				closeGroup(marker.corner);
+
+				std::vector<std::string>& names = (marker.type == 'o') ? shapes_ : materials_;
+				auto name = std::find(names.begin(), names.end(), marker.name);
+				if (name == names.end()) { name = names.insert(names.end(), marker.name); }
+
+				if (marker.type == 'o') { openGroup_.shape = static_cast<uint32_t>(name - names.begin()); }
+				else { openGroup_.material = static_cast<int32_t>(name - names.begin()); }
+			}
+		}
+
+		//Rest of a statement line, without its trailing spaces and comment
+		static std::string statementName(const char* p, const char* end)
+		{
+			skipSpaces(p, end);
+
+			const char* last = std::find(p, end, '#');
+			while (last > p && (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\n' || last[-1] == '\r')) { last--; }
+
+			return std::string(p, last);
+		}
+
+		//Number of vertex slots of a face line ("f 1/1/1 2/2/2 3/3/3" -> 3)
+		static size_t faceSize(const char* p, const char* end)
+		{
+			size_t size = 0;
+			while (true)
+			{
+				skipSpaces(p, end);
+				if (p == end || *p == '\n' || *p == '\r' || *p == '#') { return size; }
+
+				size++;
+				while (p < end && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') { p++; }
+			}
+		}
+
+		ChunkCounts count(const char* p, const char* end, bool withBounds)
+		{
+			ChunkCounts counts = {};
+
+			while (p < end)
+			{
+				const char* line = p;
+				p = nextLine(p, end);
+
+				skipSpaces(line, p);
+				if (p - line < 2) { continue; }
+
+				if (line[0] == 'v')
+				{
+					if (line[1] == ' ' || line[1] == '\t')
+					{
+						counts.positions++;
+
+						//Parse errors are reported by the parsing pass
+						glm::vec3 position(0.f);
+						line += 1;
+						for (int i = 0; i < 3 && withBounds; i++)
+						{
+							skipSpaces(line, p);
+							parseFloat(line, p, position[i]);
+						}
+						if (withBounds) { counts.bounds.extend(position); }
+					}
+					else if (line[1] == 'n') { counts.normals++; }
+					else if (line[1] == 't') { counts.uvs++; }
+				}
+				else if (line[0] == 'f' && (line[1] == ' ' || line[1] == '\t'))
+				{
+					size_t size = faceSize(line + 1, p);
+					if (size >= 3) { counts.corners += (size - 2) * 3; }
+				}
+			}
+
+			return counts;
+		}
+
+		//OBJ indices are 1 based, negative ones are relative to the current end of their array
+		static int resolve(int32_t index, size_t parsedCount)
+		{
+			return (index > 0) ? index - 1 : static_cast<int>(parsedCount) + index;
+		}
+
+		void parse(const char* p, const char* end, ChunkCounts cursor, std::vector<Marker>& markers)
+		{
+			std::vector<tinyobj::index_t> face;
+
+			while (p < end)
+			{
+				const char* line = p;
+				p = nextLine(p, end);
+
+				skipSpaces(line, p);
+				if (p - line < 2) { continue; }
+
+				if (line[0] == 'v')
+				{
+					size_t components = 0;
+					size_t required = 0;
+					float* out = nullptr;
+
+					if (line[1] == ' ' || line[1] == '\t') { components = 3; required = 3; out = &positions_[3 * cursor.positions++]; line += 1; }
+					else if (line[1] == 'n') { components = 3; required = 3; out = &normals_[3 * cursor.normals++]; line += 2; }
+					else if (line[1] == 't') { components = 2; required = 1; out = &uvs_[2 * cursor.uvs++]; line += 2; } //INFO:v (and w, ignored) are optional, 0 by default
+					else { continue; }
+
+					for (size_t i = 0; i < components; i++)
+					{
+						skipSpaces(line, p);
+						if (i >= required && (line == p || *line == '\n' || *line == '\r' || *line == '#'))
+						{
+							out[i] = 0.f;
+							continue;
+						}
+
+						if (!parseFloat(line, p, out[i]))
+						{
+							error(std::format("invalid number in line [{}]", std::string(line, std::find(line, p, '\n'))));
+							return;
+						}
+					}
+				}
+				else if (line[0] == 'f' && (line[1] == ' ' || line[1] == '\t'))
+				{
+					line += 1;
+					face.clear();
+
+					while (true)
+					{
+						skipSpaces(line, p);
+						if (line == p || *line == '\n' || *line == '\r' || *line == '#') { break; }
+
+						//v, v/vt, v//vn or v/vt/vn
+						tinyobj::index_t index = { -1, -1, -1 };
+						int32_t value = 0;
+
+						if (!parseInt(line, p, value)) { error("invalid face index"); return; }
+						index.vertex_index = resolve(value, cursor.positions);
+
+						if (line < p && *line == '/')
+						{
+							line++;
+							if (line < p && *line != '/')
+							{
+								if (!parseInt(line, p, value)) { error("invalid face uv index"); return; }
+								index.texcoord_index = resolve(value, cursor.uvs);
+							}
+
+							if (line < p && *line == '/')
+							{
+								line++;
+								if (!parseInt(line, p, value)) { error("invalid face normal index"); return; }
+								index.normal_index = resolve(value, cursor.normals);
+							}
+						}
+
+						face.push_back(index);
+					}
+
+					//Fan triangulation
+					for (size_t v = 2; v < face.size(); v++)
+					{
+						corners_[cursor.corners++] = face[0];
+						corners_[cursor.corners++] = face[v - 1];
+						corners_[cursor.corners++] = face[v];
+					}
+				}
+				else if ((line[0] == 'o' || line[0] == 'g') && (line[1] == ' ' || line[1] == '\t'))
+				{
+					markers.push_back({ cursor.corners, 'o', statementName(line + 2, p) });
+				}
+				else if (p - line > 7 && (memcmp(line, "usemtl", 6) == 0 || memcmp(line, "mtllib", 6) == 0) && (line[6] == ' ' || line[6] == '\t'))
+				{
+					markers.push_back({ cursor.corners, (line[0] == 'u') ? 'u' : 'm', statementName(line + 7, p) });
+				}
+			}
+		}
+	};
+
+	//Material of a .mtl library, only what a forward renderer needs
+	//Copyable
+	struct ObjMaterial
+	{
+		std::string name;
+		glm::vec3 ambient = glm::vec3(0.f); //Ka
+		glm::vec3 diffuse = glm::vec3(1.f); //Kd
+		glm::vec3 specular = glm::vec3(0.f); //Ks
+		glm::vec3 emissive = glm::vec3(0.f); //Ke
+		float shininess = 0.f; //Ns
+		float opacity = 1.f; //d, or 1 - Tr
+		std::string diffuseTexture; //map_Kd, relative to the working directory like the textures below
+		std::string normalTexture; //norm, map_Bump or bump
+		std::string alphaTexture; //map_d
+	};
+
+	//Reads every material of a .mtl file, texture options (-bm, -s, ...) are skipped and only the texture path is kept
+	std::vector<ObjMaterial> parseMtl(std::string filename)
+	{
+		std::vector<ObjMaterial> materials;
+
+		MappedFile file(filename);
+		const char* p = file.data();
+		const char* end = p + file.size();
+
+		std::filesystem::path directory = std::filesystem::path(filename).parent_path();
+
+		auto vec3 = [](const char* line, const char* end)
+			{
+				glm::vec3 value(0.f);
+				for (int i = 0; i < 3; i++)
+				{
+					skipSpaces(line, end);
+					if (!parseFloat(line, end, value[i])) { value[i] = (i > 0) ? value[0] : 0.f; } //INFO:"Kd 0.5" is a grey
+				}
+				return value;
+			};
+
+		auto number = [](const char* line, const char* end)
+			{
+				float value = 0.f;
+				skipSpaces(line, end);
+				parseFloat(line, end, value);
+				return value;
+			};
+
+		auto texture = [&](const char* line, const char* end)
+			{
+				//Last word of the line, options come before the path
+				const char* last = std::find(line, end, '#');
+				while (last > line && (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\n' || last[-1] == '\r')) { last--; }
+				const char* first = last;
+				while (first > line && first[-1] != ' ' && first[-1] != '\t') { first--; }
+
+				return (directory / std::string(first, last)).string();
+			};
+
+		while (p < end)
+		{
+			const char* line = p;
+			p = nextLine(p, end);
+
+			skipSpaces(line, p);
+			const char* keyEnd = line;
+			while (keyEnd < p && *keyEnd != ' ' && *keyEnd != '\t' && *keyEnd != '\n' && *keyEnd != '\r') { keyEnd++; }
+			std::string_view key(line, keyEnd - line);
+
+			if (key == "newmtl")
+			{
+				ObjMaterial material = {};
+				const char* name = keyEnd;
+				skipSpaces(name, p);
+				const char* nameEnd = p;
+				while (nameEnd > name && (nameEnd[-1] == ' ' || nameEnd[-1] == '\t' || nameEnd[-1] == '\n' || nameEnd[-1] == '\r')) { nameEnd--; }
+				material.name = std::string(name, nameEnd);
+
+				materials.push_back(material);
+				continue;
+			}
+
+			if (materials.empty()) { continue; } //Statements before the first newmtl
+			ObjMaterial& material = materials.back();
+
+			if (key == "Ka") { material.ambient = vec3(keyEnd, p); }
+			else if (key == "Kd") { material.diffuse = vec3(keyEnd, p); }
+			else if (key == "Ks") { material.specular = vec3(keyEnd, p); }
+			else if (key == "Ke") { material.emissive = vec3(keyEnd, p); }
+			else if (key == "Ns") { material.shininess = number(keyEnd, p); }
+			else if (key == "d") { material.opacity = number(keyEnd, p); }
+			else if (key == "Tr") { material.opacity = 1.f - number(keyEnd, p); }
+			else if (key == "map_Kd") { material.diffuseTexture = texture(keyEnd, p); }
+			else if (key == "norm" || key == "map_Bump" || key == "bump" || key == "map_bump") { material.normalTexture = texture(keyEnd, p); }
+			else if (key == "map_d") { material.alphaTexture = texture(keyEnd, p); }
+		}
+
+		return materials;
+	}
+
+	//Typed view of a glTF accessor inside the binary chunk of a .glb, element i being at data + i * stride
+	//Copyable
+	struct GlbAccessor
+	{
+		const char* data = nullptr;
+		size_t count = 0;
+		size_t stride = 0;
+		uint32_t componentType = 0; //GL enum, 5126 float, 5125 unsigned int, 5123 unsigned short, 5122 short, 5121 unsigned byte, 5120 byte
+		uint32_t componentCount = 0; //1 SCALAR, 2 VEC2, 3 VEC3, 4 VEC4
+		bool normalized = false;
+		size_t bufferView = 0;
+		size_t viewOffset = 0; //Offset of the accessor in its buffer view
+
+		static constexpr uint32_t FLOAT = 5126;
+		static constexpr uint32_t UNSIGNED_INT = 5125;
+		static constexpr uint32_t UNSIGNED_SHORT = 5123;
+		static constexpr uint32_t SHORT = 5122;
+		static constexpr uint32_t UNSIGNED_BYTE = 5121;
+		static constexpr uint32_t BYTE = 5120;
+
+		static size_t componentSize(uint32_t componentType)
+		{
+			switch (componentType)
+			{
+			case FLOAT: case UNSIGNED_INT: return 4;
+			case UNSIGNED_SHORT: case SHORT: return 2;
+			case UNSIGNED_BYTE: case BYTE: return 1;
+			default: return 0;
+			}
+		}
+
+		bool tightFloats() const
+		{
+			return componentType == FLOAT && stride == componentCount * sizeof(float);
+		}
+
+		//Reads N components of element i as floats, normalized integers being converted as the glTF specification says
+		template<size_t N>
+		void read(size_t i, float* out) const
+		{
+			const char* element = data + i * stride;
+
+			for (size_t c = 0; c < N; c++)
+			{
+				switch (componentType)
+				{
+				case FLOAT: memcpy(&out[c], element + c * 4, 4); break;
+				case UNSIGNED_SHORT: { uint16_t v; memcpy(&v, element + c * 2, 2); out[c] = normalized ? v / 65535.f : v; break; }
+				case SHORT: { int16_t v; memcpy(&v, element + c * 2, 2); out[c] = normalized ? std::max(v / 32767.f, -1.f) : v; break; }
+				case UNSIGNED_BYTE: { uint8_t v = static_cast<uint8_t>(element[c]); out[c] = normalized ? v / 255.f : v; break; }
+				case BYTE: { int8_t v = static_cast<int8_t>(element[c]); out[c] = normalized ? std::max(v / 127.f, -1.f) : v; break; }
+				default: out[c] = 0.f;
+				}
+			}
+		}
+
+		uint32_t index(size_t i) const
+		{
+			const char* element = data + i * stride;
+
+			switch (componentType)
+			{
+			case UNSIGNED_INT: { uint32_t v; memcpy(&v, element, 4); return v; }
+			case UNSIGNED_SHORT: { uint16_t v; memcpy(&v, element, 2); return v; }
+			default: return static_cast<uint8_t>(*element);
+			}
+		}
+	};
+
+	//Triangle primitive of a glTF mesh, attributes being accessor indices, -1 when absent
+	//Copyable
+	struct GlbPrimitive
+	{
+		size_t mesh = 0;
+		size_t primitive = 0; //Index in the mesh
+		int64_t position = -1;
+		int64_t normal = -1;
+		int64_t uv = -1; //TEXCOORD_0
+		int64_t indices = -1;
+		int64_t material = -1;
+	};
+
+	//Node of the scene graph referencing a mesh, world being the product of the transforms from the root
+	//Copyable
+	struct GlbNode
+	{
+		std::string name;
+		size_t node = 0;
+		size_t mesh = 0;
+		glm::mat4 world;
+	};
+
+	//Binary glTF 2.0 reader, the file is memory mapped and accessors point straight into its binary chunk
+	//INFO:Only the embedded buffer (buffer 0 without uri) of .glb files is supported, data uris and external .bin files are not
+	//Non triangle primitives are skipped, sparse accessors are refused
+	//Non copyable non movable
+	class GlbParser
+	{
+	public:
+		GlbParser(std::string filename) : file_(filename)
+		{
+			const char* data = file_.data();
+			size_t size = file_.size();
+
+			//12 bytes header (magic, version, length) then 8 bytes chunk headers (length, type)
+			uint32_t header[3] = {};
+			if (size < 20) { KILL(std::format("[{}] is too small to be a .glb file", filename)); }
+			memcpy(header, data, sizeof(header));
+
+			if (header[0] != 0x46546C67 || header[1] != 2 || header[2] > size) //"glTF"
+			{
+				KILL(std::format("[{}] is not a glTF 2.0 binary file", filename));
+			}
+
+			size_t offset = 12;
+			while (offset + 8 <= header[2])
+			{
+				uint32_t chunk[2] = {};
+				memcpy(chunk, data + offset, sizeof(chunk));
+				offset += 8;
+
+				if (offset + chunk[0] > header[2]) { KILL(std::format("Truncated chunk in [{}]", filename)); }
+
+				if (chunk[1] == 0x4E4F534A) //"JSON"
+				{
+					json_ = JsonValue::parse(data + offset, chunk[0]);
+				}
+				else if (chunk[1] == 0x004E4942 && binary_.empty()) //"BIN\0"
+				{
+					binary_ = std::span<const char>(data + offset, chunk[0]);
+				}
+
+				offset += (chunk[0] + 3) & ~size_t(3);
+			}
+
+			if (json_.isNull()) { KILL(std::format("[{}] has no JSON chunk", filename)); }
+
+			collectPrimitives();
+			collectNodes();
+		}
+
+		//No copy constructors
+		GlbParser(const GlbParser&) = delete;
+		GlbParser& operator=(const GlbParser&) = delete;
+
+		const JsonValue& json() { return json_; }
+		std::span<const char> binary() { return binary_; }
+
+		std::vector<GlbPrimitive>& primitives() { return primitives_; }
+		//Nodes with a mesh, every scene root being traversed (the default scene only when the file has one)
+		std::vector<GlbNode>& nodes() { return nodes_; }
+
+		GlbAccessor accessor(int64_t index)
+		{
+			const JsonValue& accessor = json_["accessors"][static_cast<size_t>(index)];
+			if (accessor.isNull()) { KILL(std::format("Accessor {} does not exist in [{}]", index, file_.filename())); }
+			if (accessor.contains("sparse")) { KILL(std::format("Sparse accessors are not supported, [{}]", file_.filename())); }
+
+			static const std::map<std::string, uint32_t> componentCounts{ {"SCALAR", 1}, {"VEC2", 2}, {"VEC3", 3}, {"VEC4", 4}, {"MAT4", 16} };
+
+			GlbAccessor view = {};
+			view.count = accessor["count"].integer();
+			view.componentType = static_cast<uint32_t>(accessor["componentType"].integer());
+			view.normalized = accessor["normalized"].boolean();
+			view.viewOffset = accessor["byteOffset"].integer();
+
+			auto componentCount = componentCounts.find(accessor["type"].string());
+			view.componentCount = (componentCount != componentCounts.end()) ? componentCount->second : 0;
+
+			size_t elementSize = GlbAccessor::componentSize(view.componentType) * view.componentCount;
+			if (elementSize == 0) { KILL(std::format("Accessor {} of [{}] has an unknown type", index, file_.filename())); }
+
+			//INFO:glTF accessors without a buffer view are all zeros, every element then reads the same zeroed one (stride 0)
+			if (!accessor.contains("bufferView"))
+			{
+				static constexpr std::array<char, 16 * sizeof(float)> zeros{};
+				view.data = zeros.data();
+				view.stride = 0;
+
+				return view;
+			}
+
+			view.bufferView = accessor["bufferView"].integer();
+			const JsonValue& bufferView = json_["bufferViews"][view.bufferView];
+			if (bufferView.isNull() || bufferView["buffer"].integer() != 0 || json_["buffers"][size_t(0)].contains("uri"))
+			{
+				KILL(std::format("Accessor {} of [{}] is not in the binary chunk", index, file_.filename()));
+			}
+
+			size_t viewStart = bufferView["byteOffset"].integer();
+			size_t viewLength = bufferView["byteLength"].integer();
+			view.stride = bufferView["byteStride"].integer(elementSize);
+
+			if (view.count > 0 && (viewStart + viewLength > binary_.size() || view.viewOffset + (view.count - 1) * view.stride + elementSize > viewLength))
+			{
+				KILL(std::format("Accessor {} of [{}] is out of its buffer", index, file_.filename()));
+			}
+
+			view.data = binary_.data() + viewStart + view.viewOffset;
+
+			return view;
+		}
+	private:
+		MappedFile file_;
+		JsonValue json_;
+		std::span<const char> binary_{};
+
+		std::vector<GlbPrimitive> primitives_{};
+		std::vector<GlbNode> nodes_{};
+
+		void collectPrimitives()
+		{
+			const JsonValue& meshes = json_["meshes"];
+			for (size_t m = 0; m < meshes.size(); m++)
+			{
+				const JsonValue& primitives = meshes[m]["primitives"];
+				for (size_t p = 0; p < primitives.size(); p++)
+				{
+					const JsonValue& primitive = primitives[p];
+					if (primitive["mode"].integer(4) != 4) //TRIANGLES
+					{
+						std::cout << std::format("Skipping non triangle primitive {} of mesh {} in [{}]", p, m, file_.filename()) << std::endl;
+						continue;
+					}
+
+					const JsonValue& attributes = primitive["attributes"];
+					if (!attributes.contains("POSITION")) { continue; }
+
+					GlbPrimitive info = {};
+					info.mesh = m;
+					info.primitive = p;
+					info.position = attributes["POSITION"].integer();
+					info.normal = attributes["NORMAL"].integer(-1);
+					info.uv = attributes["TEXCOORD_0"].integer(-1);
+					info.indices = primitive["indices"].integer(-1);
+					info.material = primitive["material"].integer(-1);
+
+					primitives_.push_back(info);
+				}
+			}
+		}
+
+		//Local transform of a node, either its matrix or translation * rotation * scale
+		glm::mat4 localMatrix(const JsonValue& node)
+		{
+			glm::mat4 matrix(1.f);
+
+			const JsonValue& values = node["matrix"];
+			if (values.size() == 16)
+			{
+				for (size_t i = 0; i < 16; i++)
+				{
+					matrix[i / 4][i % 4] = static_cast<float>(values[i].number()); //Column major, like glm
+				}
+				return matrix;
+			}
+
+			const JsonValue& t = node["translation"];
+			const JsonValue& r = node["rotation"];
+			const JsonValue& s = node["scale"];
+
+			//Unit quaternion (x, y, z, w) to rotation matrix
+			float x = static_cast<float>(r[size_t(0)].number(0.0)), y = static_cast<float>(r[1].number(0.0));
+			float z = static_cast<float>(r[2].number(0.0)), w = static_cast<float>(r[3].number(1.0));
+
+			matrix[0] = glm::vec4(1.f - 2.f * (y * y + z * z), 2.f * (x * y + z * w), 2.f * (x * z - y * w), 0.f);
+			matrix[1] = glm::vec4(2.f * (x * y - z * w), 1.f - 2.f * (x * x + z * z), 2.f * (y * z + x * w), 0.f);
+			matrix[2] = glm::vec4(2.f * (x * z + y * w), 2.f * (y * z - x * w), 1.f - 2.f * (x * x + y * y), 0.f);
+
+			for (size_t axis = 0; axis < 3; axis++)
+			{
+				matrix[axis] = matrix[axis] * static_cast<float>(s[axis].number(1.0));
+			}
+			matrix[3] = glm::vec4(static_cast<float>(t[size_t(0)].number(0.0)), static_cast<float>(t[1].number(0.0)), static_cast<float>(t[2].number(0.0)), 1.f);
+
+			return matrix;
+		}
+
+		void collectNodes()
+		{
+			const JsonValue& nodes = json_["nodes"];
+
+			std::vector<size_t> roots;
+			const JsonValue& scenes = json_["scenes"];
+			if (scenes.size() > 0)
+			{
+				const JsonValue& scene = scenes[static_cast<size_t>(json_["scene"].integer(0))];
+				for (const auto& root : scene["nodes"].elements()) { roots.push_back(root.integer()); }
+			}
+			else
+			{
+				//INFO:Without scenes, every node that is nobody's child is a root
+				std::vector<bool> child(nodes.size(), false);
+				for (const auto& node : nodes.elements())
+				{
+					for (const auto& c : node["children"].elements()) { if (static_cast<size_t>(c.integer()) < child.size()) { child[c.integer()] = true; } }
+				}
+				for (size_t n = 0; n < nodes.size(); n++) { if (!child[n]) { roots.push_back(n); } }
+			}
+
+			//Depth first, explicit stack of (node, parent world matrix)
+			std::vector<std::pair<size_t, glm::mat4>> stack;
+			for (auto it = roots.rbegin(); it != roots.rend(); it++) { stack.push_back(std::make_pair(*it, glm::mat4(1.f))); }
+
+			size_t visited = 0;
+			while (!stack.empty())
+			{
+				auto [n, parent] = stack.back();
+				stack.pop_back();
+
+				//INFO:glTF node hierarchies are trees, the bound only stops malformed cyclic files
+				if (n >= nodes.size() || ++visited > 16 * nodes.size()) { KILL(std::format("Invalid node hierarchy in [{}]", file_.filename())); }
+
+				const JsonValue& node = nodes[n];
+				glm::mat4 world = parent * localMatrix(node);
+
+				if (node.contains("mesh"))
+				{
+					nodes_.push_back({ node["name"].string(std::format("node{}", n)), n, static_cast<size_t>(node["mesh"].integer()), world });
+				}
+
+				const auto& children = node["children"].elements();
+				for (auto it = children.rbegin(); it != children.rend(); it++) { stack.push_back(std::make_pair(static_cast<size_t>(it->integer()), world)); }
+			}
+		}
+	};
+
+	//Cluster of at most maxVertices vertices and maxTriangles triangles of a mesh, see buildMeshlets
+	//Culling: the meshlet can be skipped if its sphere is out of the frustum, or if dot(normalize(coneApex - cameraPosition), coneAxis) > coneCutoff (every triangle backfacing)
+	//INFO:Triangle normals are cross(b - a, c - a), counter clockwise triangles facing the camera
+	//INFO:std430 compatible so that it can be read as is from shaders
+	//Copyable
+	struct Meshlet
+	{
+		//Bounding sphere
+		glm::vec3 center;
+		float radius;
+
+		//Normal cone, coneCutoff is 1 when triangles face too many directions to ever be culled that way
+		glm::vec3 coneApex;
+		float coneCutoff;
+		glm::vec3 coneAxis;
+
+		uint32_t vertexOffset; //First vertex in MeshletData::vertices
+		uint32_t triangleOffset; //First byte in MeshletData::triangles
+		uint32_t vertexCount;
+		uint32_t triangleCount;
+		uint32_t padding; //Keeps the struct 16 byte aligned
+	};
+
+	//Meshlets of a mesh
+	//vertices are indices of the mesh vertices, triangles are 3 local indices (into the meshlet vertices) per triangle, each meshlet being padded to 4 bytes
+	//Copyable
+	struct MeshletData
+	{
+		std::vector<Meshlet> meshlets;
+		std::vector<uint32_t> vertices;
+		std::vector<uint8_t> triangles;
+	};
+
+	//Bounding sphere and normal cone of a meshlet whose vertices and triangles are in data
+	void meshletBounds(Meshlet& meshlet, std::span<const glm::vec3> positions, const MeshletData& data)
+	{
+		//Sphere around the center of the bounding box
+		Bounds bounds = {};
+		for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+		{
+			bounds.extend(positions[data.vertices[meshlet.vertexOffset + v]]);
+		}
+
+		meshlet.center = (bounds.min + bounds.max) * 0.5f;
+		meshlet.radius = 0.f;
+		for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+		{
+			meshlet.radius = std::max(meshlet.radius, glm::length(positions[data.vertices[meshlet.vertexOffset + v]] - meshlet.center));
+		}
+
+		//Normal cone, axis being the average of the triangle normals
+		std::vector<std::pair<glm::vec3, glm::vec3>> triangles; //(first corner, unit normal) of every non degenerate triangle
+		triangles.reserve(meshlet.triangleCount);
+
+		glm::vec3 axis(0.f);
+		for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+		{
+			const uint8_t* triangle = &data.triangles[meshlet.triangleOffset + 3 * t];
+			glm::vec3 a = positions[data.vertices[meshlet.vertexOffset + triangle[0]]];
+			glm::vec3 b = positions[data.vertices[meshlet.vertexOffset + triangle[1]]];
+			glm::vec3 c = positions[data.vertices[meshlet.vertexOffset + triangle[2]]];
+
+			glm::vec3 normal = glm::cross(b - a, c - a);
+			float area = glm::length(normal);
+			if (area == 0.f) { continue; }
+
+			triangles.push_back(std::make_pair(a, normal / area));
+			axis += normal / area;
+		}
+
+		meshlet.coneApex = meshlet.center;
+		meshlet.coneAxis = glm::vec3(0.f, 0.f, 1.f);
+		meshlet.coneCutoff = 1.f;
+
+		float axisLength = glm::length(axis);
+		if (triangles.empty() || axisLength == 0.f) { return; }
+		axis /= axisLength;
+
+		float minDot = 1.f;
+		for (const auto& [corner, normal] : triangles)
+		{
+			minDot = std::min(minDot, glm::dot(normal, axis));
+		}
+
+		//INFO:Wider than a half space, no camera position sees every triangle from behind
+		if (minDot <= 0.1f) { return; }
+
+		//Apex moved back along the axis until every triangle plane is in front of it
+		float maxDistance = 0.f;
+		for (const auto& [corner, normal] : triangles)
+		{
+			maxDistance = std::max(maxDistance, glm::dot(meshlet.center - corner, normal) / glm::dot(axis, normal));
+		}
+
+		meshlet.coneApex = meshlet.center - axis * maxDistance;
+		meshlet.coneAxis = axis;
+		meshlet.coneCutoff = std::sqrt(1.f - minDot * minDot);
+	}
+
+	//Greedy meshlet building, triangles are added in index order to the current meshlet until it is full
+	//INFO:Triangles are split into contiguous ranges built by their own thread then merged, meshlets never cross a range boundary
+	MeshletData buildMeshlets(std::span<const glm::vec3> positions, std::span<const uint32_t> indices, uint32_t maxVertices = 64, uint32_t maxTriangles = 124,
+		uint32_t threadCount = std::thread::hardware_concurrency())
+	{
+		if (maxVertices < 3 || maxVertices > 256 || maxTriangles < 1)
+		{
+			KILL(std::format("Invalid meshlet limits: {} vertices (3 to 256, local indices are 8 bit), {} triangles", maxVertices, maxTriangles));
+		}
+
+		size_t triangleCount = indices.size() / 3;
+
+		//Small meshes are not worth the threads
+		constexpr size_t minChunkTriangles = 65'536;
+		size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount, triangleCount / minChunkTriangles));
+		size_t chunkTriangles = (triangleCount + chunkCount - 1) / std::max<size_t>(chunkCount, 1);
+
+		std::vector<MeshletData> chunks(chunkCount);
+
+		parallelChunks(chunkCount, [&](size_t c)
+			{
+				MeshletData& chunk = chunks[c];
+
+				size_t first = std::min(triangleCount, c * chunkTriangles);
+				size_t last = std::min(triangleCount, first + chunkTriangles);
+
+				//Vertex v is in the current meshlet if stamps[v] == meshlet, at local index locals[v]
+				std::vector<uint32_t> stamps(positions.size(), std::numeric_limits<uint32_t>::max());
+				std::vector<uint8_t> locals(positions.size());
+				uint32_t meshletIndex = 0;
+
+				Meshlet meshlet = {};
+
+				auto flush = [&]()
+					{
+						while (chunk.triangles.size() % 4 != 0) { chunk.triangles.push_back(0); }
+
+						meshletBounds(meshlet, positions, chunk);
+						chunk.meshlets.push_back(meshlet);
+						meshletIndex++;
+
+						meshlet = {};
+						meshlet.vertexOffset = static_cast<uint32_t>(chunk.vertices.size());
+						meshlet.triangleOffset = static_cast<uint32_t>(chunk.triangles.size());
+					};
+
+				for (size_t t = first; t < last; t++)
+				{
+					const uint32_t* triangle = &indices[3 * t];
+
+					uint32_t newVertices = (stamps[triangle[0]] != meshletIndex) + (stamps[triangle[1]] != meshletIndex) + (stamps[triangle[2]] != meshletIndex);
+					if (meshlet.vertexCount + newVertices > maxVertices || meshlet.triangleCount + 1 > maxTriangles)
+					{
+						flush();
+					}
+
+					for (uint32_t corner = 0; corner < 3; corner++)
+					{
+						uint32_t vertex = triangle[corner];
+						if (stamps[vertex] != meshletIndex)
+						{
+							stamps[vertex] = meshletIndex;
+							locals[vertex] = static_cast<uint8_t>(meshlet.vertexCount++);
+							chunk.vertices.push_back(vertex);
+						}
+
+						chunk.triangles.push_back(locals[vertex]);
+					}
+
+					meshlet.triangleCount++;
+				}
+
+				if (meshlet.triangleCount > 0) { flush(); }
+			});
+
+		//Merging, offsets of every chunk are shifted by the size of the previous ones
+		MeshletData merged = {};
+		for (auto& chunk : chunks)
+		{
+			for (auto& meshlet : chunk.meshlets)
+			{
+				meshlet.vertexOffset += static_cast<uint32_t>(merged.vertices.size());
+				meshlet.triangleOffset += static_cast<uint32_t>(merged.triangles.size());
+			}
+
+			merged.meshlets.insert(merged.meshlets.end(), chunk.meshlets.begin(), chunk.meshlets.end());
+			merged.vertices.insert(merged.vertices.end(), chunk.vertices.begin(), chunk.vertices.end());
+			merged.triangles.insert(merged.triangles.end(), chunk.triangles.begin(), chunk.triangles.end());
+		}
+
+		return merged;
+	}
+
+	//Post transform vertex cache efficiency of an index list, simulated with a FIFO cache of cacheSize vertices
+	//Copyable
+	struct VertexCacheStats
+	{
+		float acmr = 0.f; //Average cache miss ratio, vertex shader invocations per triangle, from 0.5 to 3
+		float atvr = 0.f; //Average transform to vertex ratio, vertex shader invocations per referenced vertex, 1 being optimal
+	};
+
+	VertexCacheStats vertexCacheStats(std::span<const uint32_t> indices, size_t vertexCount, uint32_t cacheSize = 16)
+	{
+		std::vector<uint32_t> cacheTime(vertexCount, 0);
+		std::vector<bool> referenced(vertexCount, false);
+		uint32_t time = cacheSize + 1;
+		size_t misses = 0;
+		size_t referencedCount = 0;
+
+		for (uint32_t index : indices)
+		{
+			if (!referenced[index]) { referenced[index] = true; referencedCount++; }
+
+			//INFO:In a FIFO cache, a vertex stays cached for cacheSize misses after its own
+			if (time - cacheTime[index] > cacheSize)
+			{
+				cacheTime[index] = time++;
+				misses++;
+			}
+		}
+
+		VertexCacheStats stats = {};
+		if (!indices.empty())
+		{
+			stats.acmr = static_cast<float>(misses) / (indices.size() / 3);
+			stats.atvr = static_cast<float>(misses) / referencedCount;
+		}
+
+		return stats;
+	}
+
+	//Triangle reordering for the post transform vertex cache (Tipsify, Sander, Nehab and Barczak 2007)
+	//Triangles are emitted around a fanning vertex, the next one being the most recent cached vertex that still has triangles and will not be evicted by them
+	//clusters receives the first triangle of every run broken by a jump to an unrelated vertex (see optimizeOverdraw)
+	std::vector<uint32_t> optimizeVertexCache(std::span<const uint32_t> indices, size_t vertexCount, uint32_t cacheSize = 16, std::vector<uint32_t>* clusters = nullptr)
+	{
+		size_t triangleCount = indices.size() / 3;
+
+		//Triangles around every vertex
+		std::vector<uint32_t> triangleOffsets(vertexCount + 1, 0);
+		for (uint32_t index : indices) { triangleOffsets[index + 1]++; }
+		std::partial_sum(triangleOffsets.begin(), triangleOffsets.end(), triangleOffsets.begin());
+
+		std::vector<uint32_t> vertexTriangles(indices.size());
+		std::vector<uint32_t> cursor(triangleOffsets.begin(), triangleOffsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++) { vertexTriangles[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3); }
+
+		std::vector<uint32_t> liveTriangles(vertexCount);
+		for (size_t v = 0; v < vertexCount; v++) { liveTriangles[v] = triangleOffsets[v + 1] - triangleOffsets[v]; }
+
+		std::vector<uint32_t> cacheTime(vertexCount, 0);
+		std::vector<bool> emitted(triangleCount, false);
+		std::vector<uint32_t> deadEnds;
+		std::vector<uint32_t> candidates;
+		uint32_t time = cacheSize + 1;
+		size_t nextVertex = 0;
+
+		std::vector<uint32_t> result;
+		result.reserve(indices.size());
+
+		if (clusters) { clusters->clear(); }
+
+		auto unvisited = [&]() -> int64_t
+			{
+				while (nextVertex < vertexCount && liveTriangles[nextVertex] == 0) { nextVertex++; }
+				return (nextVertex < vertexCount) ? static_cast<int64_t>(nextVertex) : -1;
+			};
+
+		int64_t fanning = unvisited();
+		bool jumped = true;
+
+		while (fanning >= 0)
+		{
+			if (jumped && clusters) { clusters->push_back(static_cast<uint32_t>(result.size() / 3)); }
+
+			candidates.clear();
+			for (uint32_t t = triangleOffsets[fanning]; t < triangleOffsets[fanning + 1]; t++)
+			{
+				uint32_t triangle = vertexTriangles[t];
+				if (emitted[triangle]) { continue; }
+				emitted[triangle] = true;
+
+				for (size_t c = 0; c < 3; c++)
+				{
+					uint32_t vertex = indices[3 * triangle + c];
+					result.push_back(vertex);
+					deadEnds.push_back(vertex);
+					candidates.push_back(vertex);
+					liveTriangles[vertex]--;
+
+					if (time - cacheTime[vertex] > cacheSize) { cacheTime[vertex] = time++; }
+				}
+			}
+
+			//Oldest cached candidate whose remaining triangles fit in the cache, fresh vertices rank last
+			int64_t best = -1;
+			int64_t bestPriority = -1;
+			for (uint32_t vertex : candidates)
+			{
+				if (liveTriangles[vertex] == 0) { continue; }
+
+				int64_t priority = 0;
+				if (time - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize) { priority = time - cacheTime[vertex]; }
+
+				if (priority > bestPriority)
+				{
+					best = vertex;
+					bestPriority = priority;
+				}
+			}
+
+			jumped = false;
+			if (best < 0)
+			{
+				//Dead end, going back to recently used vertices before jumping anywhere
+				while (!deadEnds.empty() && best < 0)
+				{
+					uint32_t vertex = deadEnds.back();
+					deadEnds.pop_back();
+					if (liveTriangles[vertex] > 0) { best = vertex; }
+				}
+
+				if (best < 0)
+				{
+					best = unvisited();
+					jumped = true;
+				}
+			}
+
+			fanning = best;
+		}
+
+		return result;
+	}
+
+	//Triangle cluster reordering to reduce overdraw (Sander, Nehab and Barczak 2007), indices being optimized for the vertex cache first
+	//Clusters facing away from the mesh center are drawn first as they tend to occlude the others, keeping vertex cache efficiency within clusters
+	//INFO:Clusters given by optimizeVertexCache are split further where their ACMR is already within threshold of the whole mesh
+	std::vector<uint32_t> optimizeOverdraw(std::span<const glm::vec3> positions, std::span<const uint32_t> indices, std::span<const uint32_t> hardClusters,
+		uint32_t cacheSize = 16, float threshold = 1.05f)
+	{
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0) { return {}; }
+
+		float acmr = vertexCacheStats(indices, positions.size(), cacheSize).acmr;
+
+		//Soft boundaries, the cache being simulated from scratch for every cluster
+		std::vector<uint32_t> clusters;
+		std::vector<uint32_t> cacheTime(positions.size(), 0);
+		uint32_t time = cacheSize + 1;
+
+		size_t hardCluster = 0;
+		size_t clusterStart = 0;
+		size_t clusterMisses = 0;
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			bool hardBoundary = hardCluster < hardClusters.size() && hardClusters[hardCluster] == t;
+			if (hardBoundary) { hardCluster++; }
+
+			bool softBoundary = t > clusterStart && static_cast<float>(clusterMisses) / (t - clusterStart) <= acmr * threshold;
+			if (t == 0 || hardBoundary || softBoundary)
+			{
+				clusters.push_back(static_cast<uint32_t>(t));
+				clusterStart = t;
+				clusterMisses = 0;
+				time += cacheSize + 1;
+			}
+
+			for (size_t c = 0; c < 3; c++)
+			{
+				uint32_t vertex = indices[3 * t + c];
+				if (time - cacheTime[vertex] > cacheSize)
+				{
+					cacheTime[vertex] = time++;
+					clusterMisses++;
+				}
+			}
+		}
+		clusters.push_back(static_cast<uint32_t>(triangleCount));
+
+		//Area weighted centroids and normals
+		glm::vec3 meshCentroid(0.f);
+		float meshArea = 0.f;
+		std::vector<std::pair<glm::vec3, glm::vec3>> clusterShapes(clusters.size() - 1, std::make_pair(glm::vec3(0.f), glm::vec3(0.f)));
+		for (size_t cluster = 0; cluster + 1 < clusters.size(); cluster++)
+		{
+			auto& [centroid, normal] = clusterShapes[cluster];
+			float area = 0.f;
+
+			for (size_t t = clusters[cluster]; t < clusters[cluster + 1]; t++)
+			{
+				glm::vec3 a = positions[indices[3 * t + 0]];
+				glm::vec3 b = positions[indices[3 * t + 1]];
+				glm::vec3 c = positions[indices[3 * t + 2]];
+
+				glm::vec3 triangleNormal = glm::cross(b - a, c - a);
+				float triangleArea = glm::length(triangleNormal);
+
+				centroid += (a + b + c) * (triangleArea / 3.f);
+				normal += triangleNormal;
+				area += triangleArea;
+			}
+
+			meshCentroid += centroid;
+			meshArea += area;
+			if (area > 0.f) { centroid /= area; }
+		}
+		if (meshArea > 0.f) { meshCentroid /= meshArea; }
+
+		std::vector<float> sortKeys(clusterShapes.size());
+		for (size_t cluster = 0; cluster < clusterShapes.size(); cluster++)
+		{
+			const auto& [centroid, normal] = clusterShapes[cluster];
+			float normalLength = glm::length(normal);
+			sortKeys[cluster] = (normalLength > 0.f) ? glm::dot(centroid - meshCentroid, normal / normalLength) : 0.f;
+		}
+
+		std::vector<uint32_t> order(clusterShapes.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+		std::vector<uint32_t> result;
+		result.reserve(indices.size());
+		for (uint32_t cluster : order)
+		{
+			result.insert(result.end(), indices.begin() + 3 * clusters[cluster], indices.begin() + 3 * clusters[cluster + 1]);
+		}
+
+		return result;
+	}
+
+	//Vertex reordering in first use order so that vertex fetches follow the index list, indices are rewritten
+	//Returns the new position of every vertex, ~0 for vertices no index references (they are dropped)
+	std::vector<uint32_t> optimizeVertexFetch(std::span<uint32_t> indices, size_t vertexCount, size_t& newVertexCount)
+	{
+		std::vector<uint32_t> remap(vertexCount, ~0u);
+		uint32_t next = 0;
+
+		for (uint32_t& index : indices)
+		{
+			if (remap[index] == ~0u) { remap[index] = next++; }
+			index = remap[index];
+		}
+
+		newVertexCount = next;
+		return remap;
+	}
+
+	//Result of optimizeMesh
+	//Copyable
+	struct MeshOptimization
+	{
+		std::vector<uint32_t> remap; //See optimizeVertexFetch
+		size_t vertexCount = 0;
+		VertexCacheStats before = {};
+		VertexCacheStats after = {};
+	};
+
+	//Vertex cache, overdraw then vertex fetch optimization of an indexed mesh, indices are rewritten and vertices must be moved following remap
+	//ranges, (first index, index count) pairs, are optimized on their own so that triangles never move from one range to another (see Submesh)
+	MeshOptimization optimizeMesh(std::span<const glm::vec3> positions, std::vector<uint32_t>& indices, uint32_t cacheSize = 16,
+		std::span<const std::pair<size_t, size_t>> ranges = {})
+	{
+		MeshOptimization optimization = {};
+		optimization.before = vertexCacheStats(indices, positions.size(), cacheSize);
+
+		if (ranges.empty())
+		{
+			std::vector<uint32_t> clusters;
+			indices = optimizeVertexCache(indices, positions.size(), cacheSize, &clusters);
+			indices = optimizeOverdraw(positions, indices, clusters, cacheSize);
+		}
+
+		//INFO:Ranges use local vertex indices, the per vertex arrays of the optimizers then scale with the range and not with the mesh
+		std::vector<uint32_t> local(ranges.empty() ? 0 : positions.size(), ~0u);
+		std::vector<uint32_t> global;
+		std::vector<glm::vec3> rangePositions;
+
+		for (auto [first, count] : ranges)
+		{
+			std::span<uint32_t> range = std::span(indices).subspan(first, count);
+
+			global.clear();
+			rangePositions.clear();
+			std::vector<uint32_t> rangeIndices(count);
+			for (size_t i = 0; i < count; i++)
+			{
+				if (local[range[i]] == ~0u)
+				{
+					local[range[i]] = static_cast<uint32_t>(global.size());
+					global.push_back(range[i]);
+					rangePositions.push_back(positions[range[i]]);
+				}
+				rangeIndices[i] = local[range[i]];
+			}
+
+			std::vector<uint32_t> clusters;
+			rangeIndices = optimizeVertexCache(rangeIndices, global.size(), cacheSize, &clusters);
+			rangeIndices = optimizeOverdraw(rangePositions, rangeIndices, clusters, cacheSize);
+
+			for (size_t i = 0; i < count; i++) { range[i] = global[rangeIndices[i]]; }
+			for (uint32_t vertex : global) { local[vertex] = ~0u; }
+		}
+
+		optimization.remap = optimizeVertexFetch(indices, positions.size(), optimization.vertexCount);
+		optimization.after = vertexCacheStats(indices, optimization.vertexCount, cacheSize);
+
+		return optimization;
+	}
+
+	//Symmetric 4x4 matrix measuring the squared distance of a point to a set of planes, weighted by triangle area (Garland and Heckbert)
+	//Copyable
+	struct Quadric
+	{
+		double a2 = 0, ab = 0, ac = 0, ad = 0;
+		double b2 = 0, bc = 0, bd = 0;
+		double c2 = 0, cd = 0;
+		double d2 = 0;
+		double weight = 0;
+
+		//Plane of normal (a, b, c), unit length, and offset d
+		static Quadric plane(glm::vec3 normal, float d, float weight)
+		{
+			Quadric q = {};
+			double a = normal.x, b = normal.y, c = normal.z;
+
+			q.a2 = a * a * weight; q.ab = a * b * weight; q.ac = a * c * weight; q.ad = a * d * weight;
+			q.b2 = b * b * weight; q.bc = b * c * weight; q.bd = b * d * weight;
+			q.c2 = c * c * weight; q.cd = c * d * weight;
+			q.d2 = static_cast<double>(d) * d * weight;
+			q.weight = weight;
+
+			return q;
+		}
+
+		void add(const Quadric& other)
+		{
+			a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+			b2 += other.b2; bc += other.bc; bd += other.bd;
+			c2 += other.c2; cd += other.cd;
+			d2 += other.d2;
+			weight += other.weight;
+		}
+
+		//Mean squared distance of point to the planes
+		double error(glm::vec3 point) const
+		{
+			double x = point.x, y = point.y, z = point.z;
+			double e = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+				+ b2 * y * y + 2 * bc * y * z + 2 * bd * y
+				+ c2 * z * z + 2 * cd * z
+				+ d2;
+
+			return (weight > 0) ? std::max(e, 0.0) / weight : 0.0;
+		}
+	};
+
+	//Edge collapse simplification driven by quadric errors, vertices are kept and only a coarser index list is returned, along with its error
+	//(largest distance a vertex was moved away from its original surface, in mesh space)
+	//Collapses are done in passes, each one collapsing the cheapest edges whose neighbourhoods do not overlap, until targetIndexCount or maxError is reached
+	//INFO:Vertices sharing their position with others (normal or uv seams) and vertices on open borders are never moved, seams stay closed and silhouettes intact
+	std::pair<std::vector<uint32_t>, float> simplify(std::span<const glm::vec3> positions, std::span<const uint32_t> indices, size_t targetIndexCount,
+		float maxError = std::numeric_limits<float>::max())
+	{
+		size_t vertexCount = positions.size();
+
+		//Position classes, vertices with the exact same position
+		std::vector<uint32_t> sorted(vertexCount);
+		std::iota(sorted.begin(), sorted.end(), 0);
+		auto positionLess = [&](uint32_t a, uint32_t b)
+			{
+				return std::tie(positions[a].x, positions[a].y, positions[a].z) < std::tie(positions[b].x, positions[b].y, positions[b].z);
+			};
+		std::sort(sorted.begin(), sorted.end(), positionLess);
+
+		std::vector<uint32_t> classes(vertexCount);
+		std::vector<uint32_t> classSizes;
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			if (i == 0 || positionLess(sorted[i - 1], sorted[i])) { classSizes.push_back(0); }
+
+			classes[sorted[i]] = static_cast<uint32_t>(classSizes.size() - 1);
+			classSizes.back()++;
+		}
+
+		//Edges of the position classes, an edge used by a single triangle is an open border, one used by more than two is non manifold
+		std::vector<uint64_t> edges;
+		edges.reserve(indices.size());
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			for (size_t e = 0; e < 3; e++)
+			{
+				uint64_t a = classes[indices[i + e]];
+				uint64_t b = classes[indices[i + (e + 1) % 3]];
+				if (a != b) { edges.push_back((std::min(a, b) << 32) | std::max(a, b)); }
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+
+		std::vector<bool> lockedClasses(classSizes.size(), false);
+		for (size_t e = 0; e < edges.size();)
+		{
+			size_t next = e;
+			while (next < edges.size() && edges[next] == edges[e]) { next++; }
+
+			if (next - e != 2)
+			{
+				lockedClasses[edges[e] >> 32] = true;
+				lockedClasses[edges[e] & 0xffffffff] = true;
+			}
+
+			e = next;
+		}
+
+		std::vector<bool> collapsible(vertexCount);
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			collapsible[v] = classSizes[classes[v]] == 1 && !lockedClasses[classes[v]];
+		}
+
+		//Plane quadrics of every triangle, summed on its vertices
+		std::vector<Quadric> quadrics(vertexCount);
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			glm::vec3 a = positions[indices[i + 0]];
+			glm::vec3 normal = glm::cross(positions[indices[i + 1]] - a, positions[indices[i + 2]] - a);
+			float area = glm::length(normal);
+			if (area == 0.f) { continue; }
+
+			normal /= area;
+			Quadric quadric = Quadric::plane(normal, -glm::dot(normal, a), area);
+			for (size_t c = 0; c < 3; c++) { quadrics[indices[i + c]].add(quadric); }
+		}
+
+		std::vector<uint32_t> current(indices.begin(), indices.end());
+		double maxCost = static_cast<double>(maxError) * maxError;
+		double error = 0;
+
+		struct Collapse
+		{
+			uint32_t from;
+			uint32_t to;
+			double cost;
+		};
+
+		std::vector<uint32_t> remap(vertexCount);
+		std::vector<bool> touched(vertexCount);
+		std::vector<uint32_t> triangleOffsets(vertexCount + 1);
+		std::vector<uint32_t> vertexTriangles;
+		std::vector<Collapse> collapses;
+
+		while (current.size() > targetIndexCount)
+		{
+			//Triangles around every vertex
+			std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+			for (uint32_t index : current) { triangleOffsets[index + 1]++; }
+			std::partial_sum(triangleOffsets.begin(), triangleOffsets.end(), triangleOffsets.begin());
+
+			vertexTriangles.resize(current.size());
+			std::vector<uint32_t> cursor(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (size_t i = 0; i < current.size(); i++) { vertexTriangles[cursor[current[i]]++] = static_cast<uint32_t>(i / 3); }
+
+			//Every directed edge starting from a collapsible vertex is a candidate
+			collapses.clear();
+			for (size_t i = 0; i < current.size(); i += 3)
+			{
+				for (size_t e = 0; e < 3; e++)
+				{
+					uint32_t from = current[i + e];
+					uint32_t to = current[i + (e + 1) % 3];
+					if (!collapsible[from]) { continue; }
+
+					collapses.push_back({ from, to, quadrics[from].error(positions[to]) });
+				}
+			}
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+			//INFO:A collapse removes two triangles, six indices
+			size_t collapseBudget = (current.size() - targetIndexCount) / 6 + 1;
+			size_t collapseCount = 0;
+
+			std::iota(remap.begin(), remap.end(), 0);
+			std::fill(touched.begin(), touched.end(), false);
+
+			for (const auto& collapse : collapses)
+			{
+				if (collapse.cost > maxCost || collapseCount >= collapseBudget) { break; }
+				if (touched[collapse.from] || touched[collapse.to]) { continue; }
+
+				//Rejecting collapses flipping a triangle around from
+				bool flips = false;
+				for (uint32_t t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1] && !flips; t++)
+				{
+					const uint32_t* triangle = &current[3 * vertexTriangles[t]];
+					if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) { continue; } //Removed by the collapse
+
+					glm::vec3 before[3];
+					glm::vec3 after[3];
+					for (size_t c = 0; c < 3; c++)
+					{
+						before[c] = positions[triangle[c]];
+						after[c] = (triangle[c] == collapse.from) ? positions[collapse.to] : before[c];
+					}
+
+					glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+					glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+					flips = glm::dot(normalBefore, normalAfter) <= 0.f;
+				}
+				if (flips) { continue; }
+
+				remap[collapse.from] = collapse.to;
+				quadrics[collapse.to].add(quadrics[collapse.from]);
+				error = std::max(error, collapse.cost);
+				collapseCount++;
+
+				//The whole neighbourhood of from is left alone until the next pass
+				touched[collapse.to] = true;
+				for (uint32_t t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1]; t++)
+				{
+					const uint32_t* triangle = &current[3 * vertexTriangles[t]];
+					touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+				}
+			}
+
+			if (collapseCount == 0) { break; }
+
+			//Applying collapses, dropping the triangles that became degenerate
+			size_t kept = 0;
+			for (size_t i = 0; i < current.size(); i += 3)
+			{
+				uint32_t a = remap[current[i + 0]];
+				uint32_t b = remap[current[i + 1]];
+				uint32_t c = remap[current[i + 2]];
+				if (a == b || b == c || a == c) { continue; }
+
+				current[kept++] = a;
+				current[kept++] = b;
+				current[kept++] = c;
+			}
+			current.resize(kept);
+		}
+
+		return std::make_pair(current, static_cast<float>(std::sqrt(error)));
+	}
+
+	//Simplified level of a mesh, error being the largest distance a vertex was moved by (mesh space), see simplify
+	//Copyable
+	struct MeshLod
+	{
+		std::vector<uint32_t> indices;
+		float error = 0.f;
+	};
+
+	//Chain of lodCount levels, each one simplified from the previous one down to ratio of its indices
+	//Levels are reordered for the vertex cache when vertexCacheSize is not 0, see optimizeVertexCache
+	//INFO:Stops early when a level can not be simplified by at least 10%, errors are cumulative
+	std::vector<MeshLod> buildLods(std::span<const glm::vec3> positions, std::span<const uint32_t> indices, uint32_t lodCount, float ratio = 0.5f,
+		uint32_t vertexCacheSize = 0)
+	{
+		std::vector<MeshLod> lods;
+		lods.reserve(lodCount);
+
+		std::span<const uint32_t> previous = indices;
+		float previousError = 0.f;
+
+		for (uint32_t lod = 0; lod < lodCount; lod++)
+		{
+			size_t target = static_cast<size_t>(previous.size() / 3 * ratio) * 3;
+			auto [simplified, error] = simplify(positions, previous, target);
+
+			if (simplified.size() > previous.size() * 0.9) { break; }
+
+			MeshLod level = {};
+			level.indices = (vertexCacheSize > 0) ? optimizeVertexCache(simplified, positions.size(), vertexCacheSize) : std::move(simplified);
+			level.error = previousError + error;
+			lods.push_back(std::move(level));
+
+			previous = lods.back().indices;
+			previousError = lods.back().error;
+		}
+
+		return lods;
+	}
+
+	//Optional processing done by the mesh loaders, its results are part of the .skmesh cache
+	//INFO:Meshes are optimized first, then LODs are built, meshlets are built for the full mesh only
+	//Copyable
+	struct MeshOptions
+	{
+		bool meshlets = false;
+		uint32_t maxMeshletVertices = 64;
+		uint32_t maxMeshletTriangles = 124;
+
+		uint32_t lods = 0; //Simplified levels, see buildLods
+		float lodRatio = 0.5f;
+
+		bool optimize = false; //Vertex cache, overdraw and vertex fetch ordering, see optimizeMesh
+		uint32_t vertexCacheSize = 16;
+	};
+
+	//Contiguous range of the indices of a mesh sharing a shape and a material, drawn and culled on its own (see MeshInstance::draws)
+	//INFO:Only 4 byte members, stored as is in the .skmesh cache
+	//Copyable
+	struct Submesh
+	{
+		uint32_t firstIndex = 0; //Relative to the first index of the mesh
+		uint32_t indexCount = 0;
+		int32_t material = -1; //In Mesh::materials, -1 without material
+		uint32_t shape = 0; //In Mesh::shapes
+		Bounds bounds = {};
+		BoundingSphere sphere = {};
+	};
+
+	//Level of detail description in the .skmesh cache
+	struct MeshLodInfo
+	{
+		uint64_t indexCount = 0;
+		float error = 0.f;
+		uint32_t padding = 0;
+	};
+
+	//Header of the .skmesh binary cache, followed by the raw vertices, the 32 bit indices, the LOD infos and indices, the submeshes,
+	//the meshlets, meshlet vertices and meshlet triangles then the names of the shapes, materials and material libraries
+	//INFO:Any change to the layout of Vertex, Meshlet or of this header must bump version, outdated caches are then rebuilt
+	struct MeshFileHeader
+	{
+		char magic[4] = { 'S', 'K', 'M', 'H' };
+		uint32_t version = 6;
+		uint32_t vertexSize = sizeof(Vertex);
+		uint32_t indexSize = sizeof(uint32_t);
+		uint64_t vertexCount = 0;
+		uint64_t indexCount = 0;
+		Bounds bounds = {};
+
+		uint32_t meshletSize = sizeof(Meshlet);
+		uint32_t maxMeshletVertices = 0; //0 when the mesh has no meshlets
+		uint32_t maxMeshletTriangles = 0;
+		uint32_t padding = 0;
+		uint64_t meshletCount = 0;
+		uint64_t meshletVertexCount = 0;
+		uint64_t meshletTriangleSize = 0; //In bytes
+
+		uint32_t lodCount = 0; //Simplified levels, 0 when the mesh has no LOD
+		uint32_t requestedLodCount = 0; //Can be more than lodCount, see buildLods
+		float lodRatio = 0.f;
+		uint32_t lodPadding = 0;
+		uint64_t lodIndexCount = 0; //Of every simplified level
+
+		uint32_t vertexCacheSize = 0; //Cache size the mesh was optimized for, 0 when not optimized
+		uint32_t optimizationPadding = 0;
+
+		BoundingSphere sphere;
+
+		uint32_t submeshSize = sizeof(Submesh);
+		uint32_t submeshCount = 0;
+		uint32_t shapeCount = 0; //Null terminated names, shapes then materials then material libraries
+		uint32_t materialCount = 0;
+		uint32_t materialLibraryCount = 0;
+		uint32_t namesPadding = 0;
+		uint64_t namesSize = 0; //In bytes
+	};
+
+	//Progress of a mesh streamed by Mesh::streamObjMesh, written by the loading thread and read by the renderer
+	//INFO:Indices only reference vertices streamed before them, a block of indices is drawable once the vertices it references are uploaded as well
+	//Non copyable non movable
+	class MeshStream
+	{
+	public:
+		MeshStream() = default;
+
+		//No copy constructors
+		MeshStream(const MeshStream&) = delete;
+		MeshStream& operator=(const MeshStream&) = delete;
+
+		//The buffer elements of the mesh are allocated and its bounds are known (quantized layouts are relative to them)
+		bool started()
+		{
+			return started_;
+		}
+
+		//Every block has been committed, the last ones may still be uploading
+		bool done()
+		{
+			return done_;
+		}
+
+		Bounds bounds()
+		{
+			std::scoped_lock lock(mutex_);
+			return bounds_;
+		}
+
+		//Indices committed so far
+		size_t indexCount()
+		{
+			std::scoped_lock lock(mutex_);
+			return blocks_.empty() ? 0 : blocks_.back().second;
+		}
+
+		//Prefix of the indices that can be drawn, given the vertices and indices the buffers have finished uploading (see LocalBuffer::streamedSize)
+		size_t drawableIndexCount(size_t uploadedVertices, size_t uploadedIndices)
+		{
+			std::scoped_lock lock(mutex_);
+
+			while (drawableBlocks_ < blocks_.size() && blocks_[drawableBlocks_].first <= uploadedVertices && blocks_[drawableBlocks_].second <= uploadedIndices)
+			{
+				drawableBlocks_++;
+			}
+
+			return (drawableBlocks_ == 0) ? 0 : blocks_[drawableBlocks_ - 1].second;
+		}
+
+		//Loader side
+		void start(Bounds bounds)
+		{
+			std::scoped_lock lock(mutex_);
+			bounds_ = bounds;
+			started_ = true;
+		}
+
+		void commitChunk(size_t vertexCount, size_t indexCount)
+		{
+			std::scoped_lock lock(mutex_);
+			blocks_.push_back(std::make_pair(vertexCount, indexCount));
+		}
+
+		void finish()
+		{
+			done_ = true;
+		}
+	private:
+		std::mutex mutex_;
+		Bounds bounds_ = {};
+		std::vector<std::pair<size_t, size_t>> blocks_{}; //(vertex count, index count) once every block is committed
+		size_t drawableBlocks_ = 0;
+
+		std::atomic<bool> started_ = false;
+		std::atomic<bool> done_ = false;
+	};
+
+	template<typename Layout = Vertex>
+	class VertexBuffer; //For Mesh::objMesh
+	class IndexBuffer; //For Mesh::objMesh
+	class MatrixBuffer; //For Mesh::glbScene
+	struct GlbScene;
+
+	//Indexed mesh, vertices are unique and triangles are described by indices_
+	//Non copyable movable
+	class Mesh
+	{
+	public:
+		Mesh()
+			: name_("Unknown")
+		{}
+		Mesh(std::string name, std::vector<Vertex> vertices, std::vector<uint32_t> indices)
+			: name_(name), vertices_(std::move(vertices)), indices_(std::move(indices)), vertexCount_(vertices_.size()), indexCount_(indices_.size())
+		{
+			computeBounds();
+		}
+
+		//Non indexed vertices, every vertex is referenced once in order
+		Mesh(std::string name, std::vector<Vertex> vertices)
+			: name_(name), vertices_(std::move(vertices)), vertexCount_(vertices_.size()), indexCount_(vertices_.size())
+		{
+			indices_.resize(vertices_.size());
+			std::iota(indices_.begin(), indices_.end(), 0);
+
+			computeBounds();
+		}
+
+		//Native parallel reader, see ObjParser
+		//INFO:The result is cached in filename.skmesh, later loads map that file instead of parsing as long as it is newer than the .obj (like .spv shaders)
+		//and was built with the same options
+		static Mesh objMesh(std::string filename, MeshOptions options = {}, bool useCache = true)
+		{
+			std::string cacheFilename = filename + ".skmesh";
+
+			if (useCache && cacheUpToDate(filename, cacheFilename))
+			{
+				Mesh mesh;
+				if (mesh.loadCache(filename, cacheFilename, options))
+				{
+					return mesh;
+				}
+
+				std::cout << std::format("Outdated or corrupted mesh cache [{}], parsing [{}] again", cacheFilename, filename) << std::endl;
+			}
+
+			Mesh mesh;
+			{
+				ObjParser parser(filename);
+				mesh = indexedMesh(filename, parser.positions(), parser.normals(), parser.uvs(), parser.corners());
+				mesh.buildSubmeshes(parser);
+			}
+
+			if (options.optimize)
+			{
+				mesh.optimize(options.vertexCacheSize);
+			}
+
+			if (options.lods > 0)
+			{
+				mesh.buildLods(options.lods, options.lodRatio);
+			}
+
+			if (options.meshlets)
+			{
+				mesh.buildMeshlets(options.maxMeshletVertices, options.maxMeshletTriangles);
+			}
+
+			if (useCache)
+			{
+				mesh.save(cacheFilename);
+			}
+
+			return mesh;
+		}
+
+		//Same as objMesh but vertices and indices are written straight into the mapped staging memory of vertexBuffer and indexBuffer, under filename
+		//The returned mesh only keeps its name, counts and bounds, its data is held by the buffers until their next upload()
+		//INFO:Saves the two copies of the owning path (vector of vertices then staging), peak memory being the parser attributes and the indices
+		//Vertices are encoded to the layout of vertexBuffer on the way
+		//Meshlets, if requested, are added to vertexBuffer as well (see VertexBuffer::addMeshlets)
+		template<typename Layout>
+		static Mesh objMesh(std::string filename, VertexBuffer<Layout>& vertexBuffer, IndexBuffer& indexBuffer, MeshOptions options = {}, bool useCache = true); //Defined after IndexBuffer definition
+
+		//Streams the mesh into both buffers block after block while it is parsed, the renderer drawing stream.drawableIndexCount indices meanwhile
+		//INFO:Elements are allocated for the worst case (one vertex per face corner) then shrunk, indices are always 32 bit and no MeshOptions processing is done
+		//Up to date .skmesh caches are streamed as well, parsed meshes are cached like objMesh does
+		template<typename Layout>
+		static Mesh streamObjMesh(std::string filename, VertexBuffer<Layout>& vertexBuffer, IndexBuffer& indexBuffer, MeshStream& stream,
+			size_t blockSize = 32'000'000, bool useCache = true); //Defined after IndexBuffer definition
+
+		//Loads every triangle primitive of a .glb file into both buffers in one pass, and the world matrix of every node with a mesh into matrixBuffer
+		//INFO:Primitives are named with glbMeshName, matrices with glbNodeName, no MeshOptions processing is done and nothing is cached (the file already is binary)
+		template<typename Layout>
+		static GlbScene glbScene(std::string filename, VertexBuffer<Layout>& vertexBuffer, IndexBuffer& indexBuffer, MatrixBuffer& matrixBuffer); //Defined after MatrixBuffer definition
+
+		static std::string glbMeshName(std::string filename, size_t mesh, size_t primitive)
+		{
+			return std::format("{}/mesh{}/primitive{}", filename, mesh, primitive);
+		}
+
+		static std::string glbNodeName(std::string filename, size_t node)
+		{
+			return std::format("{}/node{}", filename, node);
+		}
+
+		//Splits the mesh into meshlets, see buildMeshlets
+		void buildMeshlets(uint32_t maxVertices = 64, uint32_t maxTriangles = 124, uint32_t threadCount = std::thread::hardware_concurrency())
+		{
+			MeshletData meshlets = SOULKAN_NAMESPACE::buildMeshlets(positions(), indices(), maxVertices, maxTriangles, threadCount);
+
+			//INFO:Data read from the cache stays mapped, only the meshlets become owned
+			meshlets_ = std::move(meshlets);
+			meshletLimits_ = std::make_pair(maxVertices, maxTriangles);
+			ownedMeshlets_ = true;
+		}
+
+		//Reorders triangles and vertices for the vertex cache, overdraw and vertex fetches, see optimizeMesh
+		//INFO:Meshes loaded from the cache are copied first, their LODs and meshlets are dropped as they reference the previous order
+		void optimize(uint32_t vertexCacheSize = 16)
+		{
+			if (cache_)
+			{
+				vertices_.assign(vertices().begin(), vertices().end());
+				indices_.assign(indices().begin(), indices().end());
+				cache_.reset();
+			}
+
+			lods_.clear();
+			requestedLodCount_ = 0;
+			ownedLods_ = false;
+			meshlets_ = {};
+			meshletLimits_ = { 0, 0 };
+			ownedMeshlets_ = false;
+
+			MeshOptimization optimization = optimizeMesh(positions(), indices_, vertexCacheSize, submeshRanges(submeshes_));
+			vertices_ = remapVertices<Vertex>(vertices_, optimization);
+			vertexCount_ = vertices_.size();
+			vertexCacheSize_ = vertexCacheSize;
+
+			logOptimization(name_, optimization);
+		}
+
+		//Adds lodCount simplified levels sharing the vertices of the mesh, see buildLods
+		void buildLods(uint32_t lodCount, float ratio = 0.5f)
+		{
+			lods_ = SOULKAN_NAMESPACE::buildLods(positions(), indices(), lodCount, ratio, vertexCacheSize_);
+			requestedLodCount_ = lodCount;
+			lodRatio_ = ratio;
+			ownedLods_ = true;
+		}
+
+		//Name of a level of detail in the index buffer, level 0 being the full mesh
+		static std::string lodName(std::string name, size_t lod)
+		{
+			return (lod == 0) ? name : std::format("{}.lod{}", name, lod);
+		}
+
+		//Writes the mesh as a .skmesh file, readable by objMesh
+		void save(std::string filename)
+		{
+			MeshFileHeader header = {};
+			header.vertexCount = vertexCount();
+			header.indexCount = indexCount();
+			header.bounds = bounds_;
+			header.sphere = sphere_;
+			header.maxMeshletVertices = meshletLimits_.first;
+			header.maxMeshletTriangles = meshletLimits_.second;
+			header.meshletCount = meshlets().size();
+			header.meshletVertexCount = meshletVertices().size();
+			header.meshletTriangleSize = meshletTriangles().size();
+			header.lodCount = static_cast<uint32_t>(lodCount() - 1);
+			header.requestedLodCount = requestedLodCount_;
+			header.lodRatio = lodRatio_;
+			header.vertexCacheSize = vertexCacheSize_;
+
+			std::string names = packNames();
+			fillSubmeshHeader(header, names.size());
+
+			std::vector<MeshLodInfo> lodInfos(lodCount() - 1);
+			for (size_t lod = 1; lod < lodCount(); lod++)
+			{
+				lodInfos[lod - 1].indexCount = lodIndices(lod).size();
+				lodInfos[lod - 1].error = lodError(lod);
+				header.lodIndexCount += lodIndices(lod).size();
+			}
+
+			//INFO:Written next to the final file then renamed, so that a crash or a concurrent load never sees a partial cache
+			std::string tmpFilename = filename + ".tmp";
+			{
+				std::ofstream file(tmpFilename, std::ios::binary);
+				if (!file.good())
+				{
+					std::cout << std::format("Could not write mesh cache [{}]", filename) << std::endl;
+					return;
+				}
+
+				file.write((char*)&header, sizeof(MeshFileHeader));
+				file.write((char*)vertices().data(), vertexCount() * sizeof(Vertex));
+				file.write((char*)indices().data(), indexCount() * sizeof(uint32_t));
+				file.write((char*)lodInfos.data(), lodInfos.size() * sizeof(MeshLodInfo));
+				for (size_t lod = 1; lod < lodCount(); lod++)
+				{
+					file.write((char*)lodIndices(lod).data(), lodIndices(lod).size_bytes());
+				}
+				file.write((char*)submeshes_.data(), submeshes_.size() * sizeof(Submesh));
+				file.write((char*)meshlets().data(), meshlets().size_bytes());
+				file.write((char*)meshletVertices().data(), meshletVertices().size_bytes());
+				file.write((char*)meshletTriangles().data(), meshletTriangles().size_bytes());
+				file.write(names.data(), names.size());
+			}
+
+			publishCache(tmpFilename, filename);
+		}
+
+		//Reference single threaded reader, kept for comparison (see skt::obj_loading_bench)
+		static Mesh tinyObjMesh(std::string filename)
+		{
+			tinyobj::ObjReaderConfig readerConfig;
+
+			tinyobj::ObjReader reader;
+
+			if (!reader.ParseFromFile(filename, readerConfig))
+			{
+				if (!reader.Error().empty())//An error occured
+				{
+					std::string errorMessage = std::format("Killing process, error while parsing [{}]: {}", filename, reader.Error());
+					KILL(errorMessage);
+				}
+
+				std::string errorMessage = std::format("Killing process, could not parse [{}]", filename);
+				KILL(errorMessage);
+			}
+
+			if (!reader.Warning().empty())
+			{
+				std::string warningMessage = std::format("Warning while parsing [{}]: {}", filename, reader.Warning());
+				std::cout << warningMessage << std::endl;
+			}
+
+			auto& attrib = reader.GetAttrib();
+			auto& shapes = reader.GetShapes();
+
+			//Faces are already triangulated by tinyobj
+			std::vector<tinyobj::index_t> corners;
+			for (const auto& shape : shapes)
+			{
+				corners.insert(corners.end(), shape.mesh.indices.begin(), shape.mesh.indices.end());
+			}
+
+			return indexedMesh(filename, attrib.vertices, attrib.normals, attrib.texcoords, corners);
+		}
+
+		//Builds unique vertices and indices out of .obj attributes and triangulated face corners
+		static Mesh indexedMesh(std::string name, std::span<const float> positions, std::span<const float> normals, std::span<const float> uvs,
+			std::span<const tinyobj::index_t> corners)
+		{
+			std::vector<uint32_t> indices;
+			std::vector<tinyobj::index_t> uniqueCorners;
+			uniqueVertices(name, positions, corners, indices, uniqueCorners);
+
+			std::vector<Vertex> vertices(uniqueCorners.size());
+			writeVertices(positions, normals, uvs, uniqueCorners, vertices.data());
+
+			return Mesh(name, std::move(vertices), std::move(indices));
+		}
+
+		//Fills indices with one index per corner, the corner of every unique vertex being stored in uniqueCorners
+		static void uniqueVertices(std::string name, std::span<const float> positions, std::span<const tinyobj::index_t> corners,
+			std::vector<uint32_t>& indices, std::vector<tinyobj::index_t>& uniqueCorners)
+		{
+			indices.clear();
+			indices.reserve(corners.size());
+			uniqueCorners.clear();
+
+			std::vector<uint32_t> table;
+			appendUniqueVertices(name, positions, corners, indices, uniqueCorners, table);
+		}
+
+		//Appends the indices of more corners, table being kept between calls (streaming) so that new corners reuse the vertices created before
+		static void appendUniqueVertices(std::string name, std::span<const float> positions, std::span<const tinyobj::index_t> corners,
+			std::vector<uint32_t>& indices, std::vector<tinyobj::index_t>& uniqueCorners, std::vector<uint32_t>& table)
+		{
+			//INFO:A face corner already seen (same position, normal and uv indices) reuses the vertex created the first time
+			//Open addressing table of vertex indices, the key of vertex k being uniqueCorners[k], no allocation per vertex unlike std::unordered_map
+			if (table.empty())
+			{
+				table.assign(std::bit_ceil(std::max<size_t>(corners.size() / 2, 16)), std::numeric_limits<uint32_t>::max()); //INFO:Vertices are usually shared by 4 to 6 corners
+			}
+			ObjIndexHash hash;
+			ObjIndexEqual equal;
+
+			for (const auto& index : corners)
+			{
+				if (2 * uniqueCorners.size() >= table.size()) //Keeping the load factor under 0.5
+				{
+					table.assign(table.size() * 2, std::numeric_limits<uint32_t>::max());
+					for (uint32_t k = 0; k < uniqueCorners.size(); k++)
+					{
+						size_t slot = hash(uniqueCorners[k]) & (table.size() - 1);
+						while (table[slot] != std::numeric_limits<uint32_t>::max()) { slot = (slot + 1) & (table.size() - 1); }
+						table[slot] = k;
+					}
+				}
+
+				size_t slot = hash(index) & (table.size() - 1);
+				while (table[slot] != std::numeric_limits<uint32_t>::max() && !equal(uniqueCorners[table[slot]], index))
+				{
+					slot = (slot + 1) & (table.size() - 1); //Linear probing
+				}
+
+				if (table[slot] != std::numeric_limits<uint32_t>::max()) //Vertex already created by a previous corner
+				{
+					indices.push_back(table[slot]);
+					continue;
+				}
+
+				if (index.vertex_index < 0 || 3 * static_cast<size_t>(index.vertex_index) >= positions.size())
+				{
+					KILL(std::format("Killing process, position index {} out of range in [{}]", index.vertex_index, name));
+				}
+
+				table[slot] = static_cast<uint32_t>(uniqueCorners.size());
+				indices.push_back(table[slot]);
+				uniqueCorners.push_back(index);
+			}
+		}
+
+		//Bounds of the positions referenced by corners, corners must have been checked by uniqueVertices
+		static Bounds positionBounds(std::span<const float> positions, std::span<const tinyobj::index_t> corners)
+		{
+			return pointBounds(positions.data(), positions.size(), corners.size(), [&](size_t c) { return 3 * static_cast<size_t>(corners[c].vertex_index); });
+		}
+
+		static BoundingSphere positionSphere(std::span<const float> positions, std::span<const tinyobj::index_t> corners, const Bounds& bounds)
+		{
+			return pointSphere(positions.data(), positions.size(), corners.size(), [&](size_t c) { return 3 * static_cast<size_t>(corners[c].vertex_index); }, bounds);
+		}
+
+		//Writes the vertex of every corner to dst, corners must have been checked by uniqueVertices
+		static void writeVertices(std::span<const float> positions, std::span<const float> normals, std::span<const float> uvs,
+			std::span<const tinyobj::index_t> corners, Vertex* dst)
+		{
+			for (const auto& index : corners)
+			{
+				Vertex vertex{};
+
+				vertex.position.x = positions[3 * index.vertex_index + 0];
+				vertex.position.y = positions[3 * index.vertex_index + 1];
+				vertex.position.z = positions[3 * index.vertex_index + 2];
+
+				if (index.normal_index >= 0 && 3 * static_cast<size_t>(index.normal_index) < normals.size()) //Is there normal data
+				{
+					vertex.normal.x = normals[3 * index.normal_index + 0];
+					vertex.normal.y = normals[3 * index.normal_index + 1];
+					vertex.normal.z = normals[3 * index.normal_index + 2];
+				}
+
+				if (index.texcoord_index >= 0 && 2 * static_cast<size_t>(index.texcoord_index) < uvs.size())
+				{
+					vertex.uv.x = uvs[2 * index.texcoord_index + 0];
+					vertex.uv.y = uvs[2 * index.texcoord_index + 1];
+				}
+
+				*dst++ = vertex;
+			}
+		}
+
+		//Gathers vertices [first, first + count) of glTF accessors, normals and uvs being optional (null data)
+		//INFO:glTF uvs have a top left origin, they are flipped to the bottom left origin of .obj files so that both formats share the shaders
+		static void writeGlbVertices(const GlbAccessor& positions, const GlbAccessor& normals, const GlbAccessor& uvs, size_t first, size_t count, Vertex* dst)
+		{
+			for (size_t i = first; i < first + count; i++)
+			{
+				Vertex vertex{};
+
+				memcpy(&vertex.position, positions.data + i * positions.stride, sizeof(glm::vec3));
+
+				if (normals.data != nullptr)
+				{
+					if (normals.componentType == GlbAccessor::FLOAT) { memcpy(&vertex.normal, normals.data + i * normals.stride, sizeof(glm::vec3)); }
+					else { normals.read<3>(i, &vertex.normal.x); }
+				}
+
+				if (uvs.data != nullptr)
+				{
+					if (uvs.componentType == GlbAccessor::FLOAT) { memcpy(&vertex.uv, uvs.data + i * uvs.stride, sizeof(glm::vec2)); }
+					else { uvs.read<2>(i, &vertex.uv.x); }
+					vertex.uv.y = 1.f - vertex.uv.y;
+				}
+
+				*dst++ = vertex;
+			}
+		}
+
+		static void flipGlbUvs(Vertex* vertices, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				vertices[i].uv.y = 1.f - vertices[i].uv.y;
+			}
+		}
+
+		std::string name()
+		{
+			return name_;
+		}
+
+		size_t vertexCount()
+		{
+			return vertexCount_;
+		}
+
+		size_t indexCount()
+		{
+			return indexCount_;
+		}
+
+		//Size of the vertices in bytes
+		vk::DeviceSize size()
+		{
+			return vertexCount() * sizeof(Vertex);
+		}
+
+		const void* data()
+		{
+			return vertices().data();
+		}
+
+		//16 bit indices are enough to address every vertex of small meshes, halving index memory
+		vk::IndexType indexType()
+		{
+			return (vertexCount() <= std::numeric_limits<uint16_t>::max()) ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+		}
+
+		Bounds bounds()
+		{
+			return bounds_;
+		}
+
+		BoundingSphere sphere()
+		{
+			return sphere_;
+		}
+
+		//Either owned or pointing into the mapped .skmesh cache, empty for meshes loaded straight into staging
+		std::span<const Vertex> vertices()
+		{
+			if (cache_)
+			{
+				return cacheSection<Vertex>(CacheSection::VERTICES);
+			}
+
+			return vertices_;
+		}
+
+		std::span<const uint32_t> indices()
+		{
+			if (cache_)
+			{
+				return cacheSection<uint32_t>(CacheSection::INDICES);
+			}
+
+			return indices_;
+		}
+
+		//Empty until buildMeshlets is called (or the mesh is loaded with MeshOptions::meshlets)
+		std::span<const Meshlet> meshlets()
+		{
+			if (cache_ && !ownedMeshlets_)
+			{
+				return cacheSection<Meshlet>(CacheSection::MESHLETS);
+			}
+
+			return meshlets_.meshlets;
+		}
+
+		std::span<const uint32_t> meshletVertices()
+		{
+			if (cache_ && !ownedMeshlets_)
+			{
+				return cacheSection<uint32_t>(CacheSection::MESHLET_VERTICES);
+			}
+
+			return meshlets_.vertices;
+		}
+
+		std::span<const uint8_t> meshletTriangles()
+		{
+			if (cache_ && !ownedMeshlets_)
+			{
+				return cacheSection<uint8_t>(CacheSection::MESHLET_TRIANGLES);
+			}
+
+			return meshlets_.triangles;
+		}
+
+		//(max vertices, max triangles) the meshlets were built with, (0, 0) without meshlets
+		std::pair<uint32_t, uint32_t> meshletLimits()
+		{
+			return meshletLimits_;
+		}
+
+		//Ranges of the full level sharing a shape and a material, in order of first appearance in the .obj
+		//INFO:Triangles of a submesh are made contiguous, except for streamed meshes whose indices can not move (a shape split in the file is then several submeshes)
+		//Empty for meshes that do not come from a .obj file
+		std::span<const Submesh> submeshes()
+		{
+			return submeshes_;
+		}
+
+		const std::vector<std::string>& shapes()
+		{
+			return shapes_;
+		}
+
+		const std::vector<std::string>& materials()
+		{
+			return materials_;
+		}
+
+		const std::vector<std::string>& materialLibraries()
+		{
+			return materialLibraries_;
+		}
+
+		//Materials of materials(), in the same order, read from the material libraries, a missing one keeping the defaults of ObjMaterial
+		std::vector<ObjMaterial> loadMaterials()
+		{
+			std::vector<ObjMaterial> materials(materials_.size());
+			for (size_t m = 0; m < materials_.size(); m++) { materials[m].name = materials_[m]; }
+
+			for (const auto& library : materialLibraries_)
+			{
+				if (!std::filesystem::exists(library))
+				{
+					std::cout << std::format("Material library [{}] of [{}] does not exist", library, name_) << std::endl;
+					continue;
+				}
+
+				for (const auto& material : parseMtl(library))
+				{
+					auto name = std::find(materials_.begin(), materials_.end(), material.name);
+					if (name != materials_.end()) { materials[name - materials_.begin()] = material; }
+				}
+			}
+
+			return materials;
+		}
+
+		//Levels of detail, level 0 being the full mesh
+		size_t lodCount()
+		{
+			if (cache_ && !ownedLods_)
+			{
+				return 1 + cacheSection<MeshLodInfo>(CacheSection::LOD_INFOS).size();
+			}
+
+			return 1 + lods_.size();
+		}
+
+		//Indices of a level, referencing the vertices of the mesh, empty for meshes loaded straight into staging
+		std::span<const uint32_t> lodIndices(size_t lod)
+		{
+			if (lod == 0) { return indices(); }
+
+			if (cache_ && !ownedLods_)
+			{
+				std::span<const MeshLodInfo> infos = cacheSection<MeshLodInfo>(CacheSection::LOD_INFOS);
+
+				size_t offset = 0;
+				for (size_t l = 1; l < lod; l++) { offset += infos[l - 1].indexCount; }
+
+				return cacheSection<uint32_t>(CacheSection::LOD_INDICES).subspan(offset, infos[lod - 1].indexCount);
+			}
+
+			return lods_[lod - 1].indices;
+		}
+
+		//Simplification error of a level, in mesh space
+		float lodError(size_t lod)
+		{
+			if (lod == 0) { return 0.f; }
+
+			if (cache_ && !ownedLods_)
+			{
+				return cacheSection<MeshLodInfo>(CacheSection::LOD_INFOS)[lod - 1].error;
+			}
+
+			return lods_[lod - 1].error;
+		}
+	private:
+		enum class CacheSection
+		{
+			VERTICES,
+			INDICES,
+			LOD_INFOS,
+			LOD_INDICES,
+			SUBMESHES,
+			MESHLETS,
+			MESHLET_VERTICES,
+			MESHLET_TRIANGLES,
+			NAMES,
+			END
+		};
+
+		//Offset of a section in a .skmesh file, sections being stored one after the other
+		static size_t cacheOffset(const MeshFileHeader& header, CacheSection section)
+		{
+			std::array<size_t, 9> sizes = { header.vertexCount * sizeof(Vertex), header.indexCount * sizeof(uint32_t),
+				header.lodCount * sizeof(MeshLodInfo), header.lodIndexCount * sizeof(uint32_t), header.submeshCount * sizeof(Submesh),
+				header.meshletCount * sizeof(Meshlet), header.meshletVertexCount * sizeof(uint32_t), header.meshletTriangleSize, header.namesSize };
+
+			size_t offset = sizeof(MeshFileHeader);
+			for (size_t s = 0; s < static_cast<size_t>(section); s++)
+			{
+				offset += sizes[s];
+			}
+
+			return offset;
+		}
+
+		template<typename T>
+		std::span<const T> cacheSection(CacheSection section)
+		{
+			const MeshFileHeader& header = *reinterpret_cast<const MeshFileHeader*>(cache_->data());
+
+			size_t begin = cacheOffset(header, section);
+			size_t end = cacheOffset(header, static_cast<CacheSection>(static_cast<size_t>(section) + 1));
+
+			return std::span<const T>(reinterpret_cast<const T*>(cache_->data() + begin), (end - begin) / sizeof(T));
+		}
+
+		std::vector<glm::vec3> positions()
+		{
+			std::vector<glm::vec3> positions(vertexCount());
+			std::transform(vertices().begin(), vertices().end(), positions.begin(), [](const Vertex& vertex) { return vertex.position; });
+
+			return positions;
+		}
+
+		//Submeshes out of the (shape, material) runs of the parser, in order of first appearance
+		//reorder = true moves the triangles of every submesh together (stable), otherwise only adjacent runs are merged
+		//vertexOffset(v) is the offset in base of the position of vertex v, see pointBounds
+		template<typename VertexOffset>
+		static std::vector<Submesh> groupSubmeshes(std::span<const ObjGroup> groups, std::vector<uint32_t>& indices, bool reorder,
+			const float* base, size_t floatCount, VertexOffset&& vertexOffset)
+		{
+			std::vector<Submesh> submeshes;
+			std::vector<size_t> groupSubmeshes(groups.size());
+
+			for (size_t g = 0; g < groups.size(); g++)
+			{
+				auto sameKey = [&](const Submesh& submesh) { return submesh.shape == groups[g].shape && submesh.material == groups[g].material; };
+
+				auto submesh = reorder ? std::find_if(submeshes.begin(), submeshes.end(), sameKey) :
+					((!submeshes.empty() && sameKey(submeshes.back())) ? submeshes.end() - 1 : submeshes.end());
+
+				if (submesh == submeshes.end())
+				{
+					Submesh created = {};
+					created.shape = groups[g].shape;
+					created.material = groups[g].material;
+					submesh = submeshes.insert(submeshes.end(), created);
+				}
+
+				submesh->indexCount += static_cast<uint32_t>(groups[g].cornerCount);
+				groupSubmeshes[g] = submesh - submeshes.begin();
+			}
+
+			for (size_t s = 1; s < submeshes.size(); s++)
+			{
+				submeshes[s].firstIndex = submeshes[s - 1].firstIndex + submeshes[s - 1].indexCount;
+			}
+
+			//Counting sort of the runs, only needed when a submesh is split in the file
+			if (reorder && submeshes.size() < groups.size())
+			{
+				std::vector<uint32_t> reordered(indices.size());
+				std::vector<size_t> cursors(submeshes.size());
+				for (size_t s = 0; s < submeshes.size(); s++) { cursors[s] = submeshes[s].firstIndex; }
+
+				for (size_t g = 0; g < groups.size(); g++)
+				{
+					size_t& cursor = cursors[groupSubmeshes[g]];
+					std::copy_n(indices.begin() + groups[g].firstCorner, groups[g].cornerCount, reordered.begin() + cursor);
+					cursor += groups[g].cornerCount;
+				}
+
+				indices.swap(reordered);
+			}
+
+			for (auto& submesh : submeshes)
+			{
+				auto offset = [&](size_t i) { return vertexOffset(indices[submesh.firstIndex + i]); };
+				submesh.bounds = pointBounds(base, floatCount, submesh.indexCount, offset);
+				submesh.sphere = pointSphere(base, floatCount, submesh.indexCount, offset, submesh.bounds);
+			}
+
+			return submeshes;
+		}
+
+		void buildSubmeshes(ObjParser& parser)
+		{
+			const float* base = reinterpret_cast<const float*>(vertices_.data());
+			submeshes_ = groupSubmeshes(parser.groups(), indices_, true, base, vertices_.size() * sizeof(Vertex) / sizeof(float),
+				[](uint32_t v) { return v * (sizeof(Vertex) / sizeof(float)); });
+
+			setNames(parser.shapes(), parser.materials(), parser.materialLibraries());
+		}
+
+		void setNames(std::vector<std::string> shapes, std::vector<std::string> materials, std::vector<std::string> materialLibraries)
+		{
+			shapes_ = std::move(shapes);
+			materials_ = std::move(materials);
+			materialLibraries_ = std::move(materialLibraries);
+		}
+
+		static std::vector<std::pair<size_t, size_t>> submeshRanges(std::span<const Submesh> submeshes)
+		{
+			std::vector<std::pair<size_t, size_t>> ranges;
+			for (const auto& submesh : submeshes) { ranges.push_back(std::make_pair(submesh.firstIndex, submesh.indexCount)); }
+
+			return ranges;
+		}
+
+		//Names section of the cache, every name being null terminated, see MeshFileHeader::shapeCount
+		std::string packNames()
+		{
+			std::string names;
+			for (const auto* list : { &shapes_, &materials_, &materialLibraries_ })
+			{
+				for (const auto& name : *list) { names.append(name.c_str(), name.size() + 1); }
+			}
+
+			return names;
+		}
+
+		void fillSubmeshHeader(MeshFileHeader& header, size_t namesSize)
+		{
+			header.submeshCount = static_cast<uint32_t>(submeshes_.size());
+			header.shapeCount = static_cast<uint32_t>(shapes_.size());
+			header.materialCount = static_cast<uint32_t>(materials_.size());
+			header.materialLibraryCount = static_cast<uint32_t>(materialLibraries_.size());
+			header.namesSize = namesSize;
+		}
+
+		//Moves per vertex data following MeshOptimization::remap
+		template<typename T>
+		static std::vector<T> remapVertices(std::span<const T> vertices, const MeshOptimization& optimization)
+		{
+			std::vector<T> remapped(optimization.vertexCount);
+			for (size_t v = 0; v < vertices.size(); v++)
+			{
+				if (optimization.remap[v] != ~0u) { remapped[optimization.remap[v]] = vertices[v]; }
+			}
+
+			return remapped;
+		}
+
+		static void logOptimization(std::string name, const MeshOptimization& optimization)
+		{
+			std::cout << std::format("Optimized [{}]: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}", name,
+				optimization.before.acmr, optimization.after.acmr, optimization.before.atvr, optimization.after.atvr) << std::endl;
+		}
+
+		//Mesh whose data was written straight into staging
+		Mesh(std::string name, size_t vertexCount, size_t indexCount, Bounds bounds, BoundingSphere sphere)
+			: name_(name), vertexCount_(vertexCount), indexCount_(indexCount), bounds_(bounds), sphere_(sphere)
+		{}
+
+		//Vectorized over the vertex positions, see pointBounds
+		void computeBounds()
+		{
+			static_assert(offsetof(Vertex, position) == 0 && sizeof(Vertex) % sizeof(float) == 0);
+
+			const float* base = reinterpret_cast<const float*>(vertices_.data());
+			size_t floatCount = vertices_.size() * sizeof(Vertex) / sizeof(float);
+			auto offset = [](size_t v) { return v * (sizeof(Vertex) / sizeof(float)); };
+
+			bounds_ = pointBounds(base, floatCount, vertices_.size(), offset);
+			sphere_ = pointSphere(base, floatCount, vertices_.size(), offset, bounds_);
+		}
+
+		//Maps a .skmesh file, vertices, indices and meshlets are then read from the mapping without any copy
+		//Returns false if the file does not match the current format or was not built with options
+		bool loadCache(std::string name, std::string cacheFilename, MeshOptions options)
+		{
+			auto cache = std::make_unique<MappedFile>(cacheFilename);
+			if (cache->size() < sizeof(MeshFileHeader)) { return false; }
+
+			MeshFileHeader expected = {};
+			const MeshFileHeader* header = reinterpret_cast<const MeshFileHeader*>(cache->data());
+
+			if (memcmp(header->magic, expected.magic, sizeof(expected.magic)) != 0 || header->version != expected.version ||
+				header->vertexSize != expected.vertexSize || header->indexSize != expected.indexSize)
+			{
+				return false;
+			}
+
+			if (header->meshletSize != expected.meshletSize || header->submeshSize != expected.submeshSize ||
+				cache->size() != cacheOffset(*header, CacheSection::END))
+			{
+				return false;
+			}
+
+			bool meshlets = header->maxMeshletVertices != 0;
+			if (meshlets != options.meshlets ||
+				(meshlets && (header->maxMeshletVertices != options.maxMeshletVertices || header->maxMeshletTriangles != options.maxMeshletTriangles)))
+			{
+				return false;
+			}
+
+			if (header->requestedLodCount != options.lods || (options.lods > 0 && header->lodRatio != options.lodRatio))
+			{
+				return false;
+			}
+
+			if (header->vertexCacheSize != (options.optimize ? options.vertexCacheSize : 0))
+			{
+				return false;
+			}
+
+			name_ = name;
+			vertexCount_ = header->vertexCount;
+			indexCount_ = header->indexCount;
+			bounds_ = header->bounds;
+			sphere_ = header->sphere;
+			meshletLimits_ = std::make_pair(header->maxMeshletVertices, header->maxMeshletTriangles);
+			requestedLodCount_ = header->requestedLodCount;
+			lodRatio_ = header->lodRatio;
+			vertexCacheSize_ = header->vertexCacheSize;
+			cache_ = std::move(cache);
+
+			//INFO:Small, copied out of the mapping so that staged meshes can keep them
+			std::span<const Submesh> submeshes = cacheSection<Submesh>(CacheSection::SUBMESHES);
+			submeshes_.assign(submeshes.begin(), submeshes.end());
+
+			std::span<const char> names = cacheSection<char>(CacheSection::NAMES);
+			const char* cursor = names.data();
+			for (auto [list, count] : { std::make_pair(&shapes_, header->shapeCount), std::make_pair(&materials_, header->materialCount),
+				std::make_pair(&materialLibraries_, header->materialLibraryCount) })
+			{
+				list->clear();
+				for (uint32_t n = 0; n < count; n++)
+				{
+					const char* nameEnd = std::find(cursor, names.data() + names.size(), '\0');
+					if (nameEnd == names.data() + names.size()) { cache_.reset(); return false; }
+
+					list->push_back(std::string(cursor, nameEnd));
+					cursor = nameEnd + 1;
+				}
+			}
+
+			return true;
+		}
+
+		static bool cacheUpToDate(std::string filename, std::string cacheFilename)
+		{
+			return std::filesystem::exists(cacheFilename) &&
+				std::filesystem::last_write_time(std::filesystem::path(filename)) < std::filesystem::last_write_time(std::filesystem::path(cacheFilename));
+		}
+
+		//Renames a fully written cache to its final name
+		static void publishCache(std::string tmpFilename, std::string filename)
+		{
+			std::error_code error;
+			std::filesystem::rename(tmpFilename, filename, error);
+			if (error)
+			{
+				std::cout << std::format("Could not write mesh cache [{}]: {}", filename, error.message()) << std::endl;
+				std::filesystem::remove(tmpFilename, error);
+			}
+		}
+
+		std::string name_;
+		std::vector<Vertex> vertices_;
+		std::vector<uint32_t> indices_;
+		size_t vertexCount_ = 0;
+		size_t indexCount_ = 0;
+		Bounds bounds_ = {};
+		BoundingSphere sphere_ = {};
+
+		MeshletData meshlets_ = {};
+		std::pair<uint32_t, uint32_t> meshletLimits_ = { 0, 0 };
+		bool ownedMeshlets_ = false; //Meshlets built after being loaded from the cache
+
+		std::vector<MeshLod> lods_{}; //Indices are empty for meshes loaded straight into staging, errors are kept
+		uint32_t requestedLodCount_ = 0;
+		float lodRatio_ = 0.f;
+		bool ownedLods_ = false; //LODs built after being loaded from the cache
+
+		uint32_t vertexCacheSize_ = 0; //0 when not optimized
+
+		std::vector<Submesh> submeshes_{};
+		std::vector<std::string> shapes_{};
+		std::vector<std::string> materials_{};
+		std::vector<std::string> materialLibraries_{};
+
+		//Set when the mesh comes from a .skmesh cache
+		std::unique_ptr<MappedFile> cache_;
+	};
+	
+	//Generational handle of an element of a LocalBuffer, returned by add, create and allocate
+	//INFO:index is the slot of the element and generation counts the reuses of the slot, so that the handle of a removed element never resolves to the next one
+	//Copyable
+	struct ElementHandle
+	{
+		uint32_t index = std::numeric_limits<uint32_t>::max();
+		uint32_t generation = 0;
+
+		bool valid() const
+		{
+			return index != std::numeric_limits<uint32_t>::max();
+		}
+
+		bool operator==(const ElementHandle& other) const = default;
+	};
+
+	//Instance of a primitive of a .glb scene, see Mesh::glbScene
+	//Copyable
+	struct GlbInstance
+	{
+		std::string name; //Of the node
+		size_t mesh = 0; //In GlbScene::meshes
+		ElementHandle matrix; //MatrixBuffer element holding the world matrix of the node
+		glm::mat4 world;
+	};
+
+	//Non copyable movable
+	struct GlbScene
+	{
+		std::vector<Mesh> meshes; //Every triangle primitive, named with Mesh::glbMeshName
+		std::vector<int64_t> materials; //glTF material of every mesh, -1 if none
+		std::vector<GlbInstance> instances;
+	};
+
+	//Small mappable buffer
+	//Non copyable movable
+	//TODO:Use prefer cpu ram to make sure staging is on system memory
+	class StagingBuffer : public Buffer
+	{
+	public:
+		StagingBuffer(ref<Device> device, ref<Allocator> allocator, vk::DeviceSize size, bool systemMemory = false, MemoryPool pool = MemoryPool::STAGING)
+			: Buffer(device, allocator, (vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc), size, true, systemMemory, false, MemoryTag::STAGING, pool), //Staging buffer should not be bigger than 200MB if on DEVICE_LOCAL memory
+			  size_(size)
+		{}
+
+		vk::DeviceSize size()
+		{
+			return size_;
+		}
+	private:
+		vk::DeviceSize size_;
+	};
+
+	//Two level segregated fit (TLSF) allocator of offsets inside a range of size bytes, allocate and free being O(1)
+	//INFO:The first level splits sizes by powers of two and the second one every power of two in SL_COUNT lists of free blocks,
+	//a bitmap per level finding a large enough list with two bit scans. Freed blocks are merged with both their neighbors
+	//Offsets and sizes are multiples of alignment, which does not need to be a power of two (vertex sizes)
+	//Copyable
+	class TlsfAllocator
+	{
+	public:
+		TlsfAllocator(vk::DeviceSize size, vk::DeviceSize alignment = 16) : size_(size), alignment_(std::max<vk::DeviceSize>(1, alignment))
+		{
+			heads_.fill(NONE);
+
+			Block whole = {};
+			whole.size = size;
+			blocks_.push_back(whole);
+			if (size > 0) { insertFree(0); }
+		}
+
+		//Offset of a new block of at least size bytes, max when no free block is large enough
+		vk::DeviceSize allocate(vk::DeviceSize size)
+		{
+			size = alignedSize(std::max<vk::DeviceSize>(size, 1));
+			if (size > size_) { return std::numeric_limits<uint64_t>::max(); }
+
+			//INFO:Rounded up to the next list so that any block of the list found fits, at the cost of some internal fragmentation
+			vk::DeviceSize searched = size;
+			if (searched >= SL_COUNT) { searched += (vk::DeviceSize(1) << (std::bit_width(searched) - 1 - SL_LOG2)) - 1; }
+
+			uint32_t block = findFree(searched);
+			if (block == NONE) { return std::numeric_limits<uint64_t>::max(); }
+
+			removeFree(block);
+			split(block, size);
+
+			blocks_[block].free = false;
+			usedBlocks_[blocks_[block].offset] = block;
+			usedSize_ += blocks_[block].size;
+
+			return blocks_[block].offset;
+		}
+
+		//Frees the block allocated at offset
+		void free(vk::DeviceSize offset)
+		{
+			auto used = usedBlocks_.find(offset);
+			if (used == usedBlocks_.end())
+			{
+				KILL(std::format("Freeing offset {} which was not allocated", offset));
+			}
+
+			uint32_t block = used->second;
+			usedBlocks_.erase(used);
+			usedSize_ -= blocks_[block].size;
+
+			blocks_[block].free = true;
+			insertFree(merge(block));
+		}
+
+		//Gives the end of the block allocated at offset back, keeping at least one alignment unit
+		void shrink(vk::DeviceSize offset, vk::DeviceSize size)
+		{
+			auto used = usedBlocks_.find(offset);
+			if (used == usedBlocks_.end())
+			{
+				KILL(std::format("Shrinking offset {} which was not allocated", offset));
+			}
+
+			uint32_t block = used->second;
+			size = alignedSize(std::max<vk::DeviceSize>(size, 1));
+			if (size >= blocks_[block].size) { return; }
+
+			usedSize_ -= blocks_[block].size - size;
+			uint32_t tail = split(block, size, false);
+			insertFree(merge(tail));
+		}
+
+		//Extends the range to size bytes, the added space joining the free block at the end of the range when there is one
+		void grow(vk::DeviceSize size)
+		{
+			if (size <= size_) { return; }
+
+			uint32_t last = 0; //INFO:Block 0 always starts the range, merges only absorbing next blocks
+			while (blocks_[last].next != NONE) { last = blocks_[last].next; }
+
+			vk::DeviceSize added = size - size_;
+			size_ = size;
+
+			if (blocks_[last].free)
+			{
+				if (blocks_[last].size > 0) { removeFree(last); } //Empty ranges have an empty block not in the free lists
+				blocks_[last].size += added;
+				insertFree(last);
+				return;
+			}
+
+			Block tailBlock = {};
+			tailBlock.offset = blocks_[last].offset + blocks_[last].size;
+			tailBlock.size = added;
+			tailBlock.previous = last;
+
+			uint32_t tail = addBlock(tailBlock);
+			blocks_[last].next = tail;
+			insertFree(tail);
+		}
+
+		vk::DeviceSize size()
+		{
+			return size_;
+		}
+
+		vk::DeviceSize alignment()
+		{
+			return alignment_;
+		}
+
+		//Bytes of every free block
+		vk::DeviceSize freeSize()
+		{
+			return size_ - usedSize_;
+		}
+
+		//Largest block that can be allocated
+		//INFO:Only scans the largest non empty list, its blocks sharing the same size class
+		vk::DeviceSize largestFreeBlock()
+		{
+			if (flBitmap_ == 0) { return 0; }
+
+			uint32_t fl = std::bit_width(flBitmap_) - 1;
+			uint32_t sl = std::bit_width(slBitmaps_[fl]) - 1;
+
+			vk::DeviceSize largest = 0;
+			for (uint32_t block = heads_[fl * SL_COUNT + sl]; block != NONE; block = blocks_[block].nextFree)
+			{
+				largest = std::max(largest, blocks_[block].size);
+			}
+
+			return largest;
+		}
+
+		//0 when the free space is a single block, close to 1 when it is scattered in small blocks
+		float fragmentation()
+		{
+			vk::DeviceSize free = freeSize();
+			return (free == 0) ? 0.f : 1.f - static_cast<float>(largestFreeBlock()) / static_cast<float>(free);
+		}
+
+		size_t allocationCount()
+		{
+			return usedBlocks_.size();
+		}
+	private:
+		static constexpr uint32_t SL_LOG2 = 5;
+		static constexpr uint32_t SL_COUNT = 1 << SL_LOG2;
+		static constexpr uint32_t FL_COUNT = 64 - SL_LOG2 + 1; //Row 0 holding the sizes under SL_COUNT linearly
+		static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+		struct Block
+		{
+			vk::DeviceSize offset = 0;
+			vk::DeviceSize size = 0;
+			uint32_t previous = NONE; //Neighbors in the range
+			uint32_t next = NONE;
+			uint32_t previousFree = NONE; //Neighbors in the list of its size class
+			uint32_t nextFree = NONE;
+			bool free = true;
+		};
+
+		vk::DeviceSize size_;
+		vk::DeviceSize alignment_;
+		vk::DeviceSize usedSize_ = 0;
+
+		std::vector<Block> blocks_{};
+		std::vector<uint32_t> unusedBlocks_{}; //Indices in blocks_ of merged blocks, reused by split
+		std::unordered_map<vk::DeviceSize, uint32_t> usedBlocks_{}; //Offset -> block
+
+		std::array<uint32_t, FL_COUNT * SL_COUNT> heads_{};
+		uint64_t flBitmap_ = 0;
+		std::array<uint32_t, FL_COUNT> slBitmaps_{};
+
+		vk::DeviceSize alignedSize(vk::DeviceSize size)
+		{
+			return ((size + alignment_ - 1) / alignment_) * alignment_;
+		}
+
+		static std::pair<uint32_t, uint32_t> mapping(vk::DeviceSize size)
+		{
+			if (size < SL_COUNT) { return std::make_pair(0u, static_cast<uint32_t>(size)); }
+
+			uint32_t log = std::bit_width(size) - 1;
+			return std::make_pair(log - SL_LOG2 + 1, static_cast<uint32_t>(size >> (log - SL_LOG2)) - SL_COUNT);
+		}
+
+		uint32_t findFree(vk::DeviceSize size)
+		{
+			auto [fl, sl] = mapping(size);
+
+			uint32_t slMap = slBitmaps_[fl] & (~0u << sl);
+			if (slMap == 0)
+			{
+				uint64_t flMap = (fl + 1 < FL_COUNT) ? flBitmap_ & (~uint64_t(0) << (fl + 1)) : 0;
+				if (flMap == 0) { return NONE; }
+
+				fl = std::countr_zero(flMap);
+				slMap = slBitmaps_[fl];
+			}
+
+			return heads_[fl * SL_COUNT + std::countr_zero(slMap)];
+		}
+
+		void insertFree(uint32_t block)
+		{
+			auto [fl, sl] = mapping(blocks_[block].size);
+			uint32_t& head = heads_[fl * SL_COUNT + sl];
+
+			blocks_[block].free = true;
+			blocks_[block].previousFree = NONE;
+			blocks_[block].nextFree = head;
+			if (head != NONE) { blocks_[head].previousFree = block; }
+			head = block;
+
+			flBitmap_ |= uint64_t(1) << fl;
+			slBitmaps_[fl] |= 1u << sl;
+		}
+
+		void removeFree(uint32_t block)
+		{
+			auto [fl, sl] = mapping(blocks_[block].size);
+			Block& removed = blocks_[block];
+
+			if (removed.previousFree != NONE) { blocks_[removed.previousFree].nextFree = removed.nextFree; }
+			else { heads_[fl * SL_COUNT + sl] = removed.nextFree; }
+			if (removed.nextFree != NONE) { blocks_[removed.nextFree].previousFree = removed.previousFree; }
+
+			if (heads_[fl * SL_COUNT + sl] == NONE)
+			{
+				slBitmaps_[fl] &= ~(1u << sl);
+				if (slBitmaps_[fl] == 0) { flBitmap_ &= ~(uint64_t(1) << fl); }
+			}
+		}
+
+		//Cuts block at size, the tail becoming a new block, inserted in the free lists when insertTail is set
+		uint32_t split(uint32_t block, vk::DeviceSize size, bool insertTail = true)
+		{
+			if (blocks_[block].size == size) { return NONE; }
+
+			Block tailBlock = {};
+			tailBlock.offset = blocks_[block].offset + size;
+			tailBlock.size = blocks_[block].size - size;
+			tailBlock.previous = block;
+			tailBlock.next = blocks_[block].next;
+
+			uint32_t tail = addBlock(tailBlock);
+
+			if (blocks_[tail].next != NONE) { blocks_[blocks_[tail].next].previous = tail; }
+			blocks_[block].next = tail;
+			blocks_[block].size = size;
+
+			if (insertTail) { insertFree(tail); }
+
+			return tail;
+		}
+
+		//Merges a free block, not in the free lists, with its free neighbors and returns the resulting block
+		uint32_t merge(uint32_t block)
+		{
+			uint32_t next = blocks_[block].next;
+			if (next != NONE && blocks_[next].free)
+			{
+				removeFree(next);
+				absorbNext(block);
+			}
+
+			uint32_t previous = blocks_[block].previous;
+			if (previous != NONE && blocks_[previous].free)
+			{
+				removeFree(previous);
+				absorbNext(previous);
+				block = previous;
+			}
+
+			return block;
+		}
+
+		//Index of a new block, reusing merged ones first
+		uint32_t addBlock(const Block& block)
+		{
+			if (unusedBlocks_.empty())
+			{
+				blocks_.push_back(block);
+				return static_cast<uint32_t>(blocks_.size() - 1);
+			}
+
+			uint32_t index = unusedBlocks_.back();
+			unusedBlocks_.pop_back();
+			blocks_[index] = block;
+
+			return index;
+		}
+
+		void absorbNext(uint32_t block)
+		{
+			uint32_t next = blocks_[block].next;
+
+			blocks_[block].size += blocks_[next].size;
+			blocks_[block].next = blocks_[next].next;
+			if (blocks_[block].next != NONE) { blocks_[blocks_[block].next].previous = block; }
+
+			unusedBlocks_.push_back(next);
+		}
+	};
+
+	//INFO:Staging is a ring, every upload hands its copies to the upload scheduler of the device without waiting, the staging they read
+	//being reused once the value of their batch is reached (see uploadSignal for the submits reading the buffer)
+	//Non copyable non movable, loading threads and buffer views refer to it (see stagingMutex_)
+	class LocalBuffer : public Buffer //TODO:Protected upload so end user cannot directly call VertexBuffer.upload() and mess things up
+	{
+	public:
+		//Elements are placed at multiples of alignment, see TlsfAllocator
+		//INFO:The buffer is also a transfer source, defragment copying elements inside it (and growth copying it to the buffer replacing it)
+		LocalBuffer(ref<Device> device, ref<Allocator> allocator, vk::DeviceSize localSize, vk::DeviceSize stagingSize = 10'000'000,
+			vk::Flags<vk::BufferUsageFlagBits> usage = {}, vk::DeviceSize alignment = 16, MemoryTag tag = MemoryTag::OTHER, MemoryPool pool = MemoryPool::GEOMETRY) :
+			Buffer(device, allocator, (usage | vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst), localSize,
+				false, false, false, tag, pool),
+			allocator_(localSize, alignment),
+			stagingBuffer_(device, allocator, stagingSize, false, MemoryPool::DEFAULT), //INFO:Lives as long as the buffer, kept out of the linear STAGING pool
+			uploads_(device.get().uploads()),
+			usage_(usage | vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst),
+			pool_(pool)
+		{}
+
+		//Opt in, an element that does not fit makes the buffer grow by factor (at least enough for it) up to maxSize instead of failing
+		//INFO:The larger buffer is created right away and the old content copied to it by the upload scheduler before any later copy,
+		//address and vk returning the new buffer from then on (submits reading it wait for uploadSignal like for any other upload)
+		//The old buffer is destroyed by the first defragment call made once that copy is finished, which must be made once no command reads it
+		//(call defragment(0) every frame when not defragmenting)
+		//INFO:The copy reads ranges owned by the graphics family, its batch is submitted by the thread calling UploadScheduler::acquire
+		//Thread safe
+		void growth(float factor, vk::DeviceSize maxSize = std::numeric_limits<uint64_t>::max())
+		{
+			std::scoped_lock lock(stagingMutex_);
+			growthFactor_ = factor;
+			maxSize_ = maxSize;
+		}
+
+		//Adds and uploads mesh to staging, name being kept to find the element again (see handle)
+		//INFO:Adding an element that exists only overwrites it with upload(true)
+		ElementHandle add(std::string name, const void* data, size_t size)
+		{
+			ElementHandle handle = namedHandle(name);
+			add(handle, data, size);
+
+			return handle;
+		}
+
+		//Adds an anonymous element, only reachable through the returned handle
+		ElementHandle add(const void* data, size_t size)
+		{
+			ElementHandle handle = create();
+			add(handle, data, size);
+
+			return handle;
+		}
+
+		//Writes data to handle, a new element being placed by the next upload, an existing one being overwritten by upload(true)
+		//INFO:With hashContents, data identical to what was last added to handle is skipped without touching staging
+		void add(ElementHandle handle, const void* data, size_t size)
+		{
+			uint64_t hash = 0;
+			if (contentHashing_)
+			{
+				hash = contentHash(data, size);
+
+				std::scoped_lock lock(stagingMutex_);
+				Element* element = resolve(handle);
+				if (element != nullptr && element->contentHash == hash && element->contentSize == size && !element->reserved) { return; }
+			}
+
+			void* stagingMemory = reserve(handle, size);
+			memcpy(stagingMemory, data, size);
+			commit(handle, hash);
+		}
+
+		//Hashes the data passed to add, so that elements rewritten with the same content (static matrices, unchanged meshes) are not uploaded again
+		//Thread safe
+		void hashContents(bool enabled)
+		{
+			std::scoped_lock lock(stagingMutex_);
+			contentHashing_ = enabled;
+		}
+
+		//Empty element to be written with reserve or allocate, name being optional debug metadata (the element can then be found with handle)
+		//Thread safe
+		ElementHandle create(std::string name = "")
+		{
+			std::scoped_lock lock(stagingMutex_);
+			return createElement(std::move(name));
+		}
+
+		//Handle of the element added under name, invalid if there is none
+		//Thread safe
+		ElementHandle handle(std::string name)
+		{
+			std::scoped_lock lock(stagingMutex_);
+
+			auto named = names_.find(name);
+			return (named != names_.end()) ? named->second : ElementHandle{};
+		}
+
+		//Debug name of an element, empty for anonymous or removed ones
+		//Thread safe
+		std::string name(ElementHandle handle)
+		{
+			std::scoped_lock lock(stagingMutex_);
+
+			Element* element = resolve(handle);
+			return (element != nullptr) ? element->name : std::string();
+		}
+
+		//Reserves size bytes of mapped staging memory for name, to be written directly by the caller (loaders, decoders) then passed to commit
+		//INFO:The memory may be write combined, write it sequentially and never read it back
+		//Reservations larger than half of staging are host memory instead, commit streams them through staging chunk by chunk (see streamOverflow)
+		//Thread safe, several loaders can fill their own reservation at the same time
+		void* reserve(std::string name, size_t size)
+		{
+			return reserve(namedHandle(name), size);
+		}
+
+		void* reserve(ElementHandle handle, size_t size)
+		{
+			std::unique_lock lock(stagingMutex_);
+
+			if (size > stagingBuffer_.size() / 2)
+			{
+				Element* element = resolve(handle);
+				if (element == nullptr)
+				{
+					KILL(std::format("Reserving staging memory for a removed element: {}", handle.index));
+				}
+				if (element->reserved)
+				{
+					KILL(std::format("Staging memory already reserved for following object: {}", elementName(handle)));
+				}
+
+				StagedRange staged = {};
+				staged.element = handle;
+				staged.size = size;
+				staged.elementSize = size;
+
+				element->reservation = staged;
+				element->reserved = true;
+				element->overflow.reset(new char[size]); //INFO:Not value initialized, the caller writes all of it
+
+				return element->overflow.get();
+			}
+
+			return reserveStaging(lock, handle, size, 0, false, false);
+		}
+
+		//Reserves staging memory for the size bytes at elementOffset of name, an element of elementSize bytes streamed chunk by chunk (see allocate and commit)
+		//INFO:Also waits for an upload of the committed staging instead of failing when staging is full, another thread is expected to keep uploading
+		//Thread safe, one chunk per element can be reserved at a time
+		void* reserveChunk(std::string name, vk::DeviceSize elementOffset, size_t size)
+		{
+			return reserveChunk(handle(name), elementOffset, size);
+		}
+
+		void* reserveChunk(ElementHandle handle, vk::DeviceSize elementOffset, size_t size)
+		{
+			std::unique_lock lock(stagingMutex_);
+
+			if (size > stagingBuffer_.size())
+			{
+				KILL(std::format("Chunk of {} bytes of following object does not fit in the staging buffer (size = {} bytes): {}", size, stagingBuffer_.size(), elementName(handle)));
+			}
+
+			Element* element = resolve(handle);
+			if (element == nullptr || !element->placed() || elementOffset + size > element->size)
+			{
+				KILL(std::format("Streaming a chunk out of the allocated element: {} (offset {}, size {})", elementName(handle), elementOffset, size));
+			}
+
+			return reserveStaging(lock, handle, size, elementOffset, true, true);
+		}
+
+		//Wakes the threads waiting for an upload of the committed staging (see reserveChunk), their reservations throw std::runtime_error
+		//until resumeStagingWaits, so that their owner can stop them when nobody uploads anymore
+		//Thread safe
+		void cancelStagingWaits()
+		{
+			{
+				std::scoped_lock lock(stagingMutex_);
+				stagingWaitsCancelled_ = true;
+			}
+			stagingFreed_.notify_all();
+		}
+
+		void resumeStagingWaits()
+		{
+			std::scoped_lock lock(stagingMutex_);
+			stagingWaitsCancelled_ = false;
+		}
+
+		//Allocates size bytes of the local buffer for name right away, its content being streamed later with reserveChunk
+		//Thread safe
+		ElementHandle allocate(std::string name, vk::DeviceSize size)
+		{
+			std::scoped_lock lock(stagingMutex_);
+
+			if (names_.contains(name))
+			{
+				KILL(std::format("Following object is already in the local buffer: {}", name));
 			}
 
-			lastSrc.close();
-			lastSpirv.close();
-			
-			compiled = true;
+			ElementHandle handle = createElement(name);
+			if (placeElement(handle, size) == std::numeric_limits<uint64_t>::max())
+			{
+				KILL(std::format("Not enough space in local buffer for following mesh : {} of size {}", name, size));
+			}
 
-			return module_;
+			return handle;
 		}
 
-		vk::ShaderStageFlagBits stage() const
+		//Gives the end of an allocated element back to the free space, once its final size is known (streamed meshes are allocated for their worst case)
+		//Thread safe
+		void shrink(std::string name, vk::DeviceSize size)
 		{
-			return stage_;
+			shrink(handle(name), size);
 		}
-	private:
-		ref<Device> device_;
-		std::string filename_{};
-		std::string source_{};
-		vk::ShaderModule module_;
-		vk::ShaderStageFlagBits stage_;
 
-		bool compiled = false; //Compilation state after latest changes
+		void shrink(ElementHandle handle, vk::DeviceSize size)
+		{
+			std::scoped_lock lock(stagingMutex_);
 
-		shaderc_shader_kind kind()
+			Element* element = resolve(handle);
+			if (element == nullptr || !element->placed() || size > element->size)
+			{
+				return;
+			}
+
+			element->size = size;
+			allocator_.shrink(element->offset, size);
+
+			for (auto& pending : pendingMoves_)
+			{
+				if (pending.move.element == handle) { allocator_.shrink(pending.move.to, size); }
+			}
+		}
+
+		//Bytes of a streamed element whose transfer is known to be finished, polled without waiting
+		//Thread safe
+		vk::DeviceSize streamedSize(std::string name)
 		{
-			if (stage_ == vk::ShaderStageFlagBits::eVertex) { return shaderc_shader_kind::shaderc_vertex_shader; }
-			if (stage_ == vk::ShaderStageFlagBits::eFragment) { return shaderc_shader_kind::shaderc_fragment_shader; }
+			return streamedSize(handle(name));
+		}
 
-			return shaderc_shader_kind::shaderc_vertex_shader;
+		vk::DeviceSize streamedSize(ElementHandle handle)
+		{
+			std::scoped_lock lock(stagingMutex_);
+
+			retireTransfers();
+
+			Element* element = resolve(handle);
+			return (element != nullptr) ? element->streamedSize : 0;
 		}
-	};
 
-	class GraphicsPipeline : Destroyable
-	{
-	public:
-		//Acts as default constructor
-		GraphicsPipeline(ref<Device> device) : device_(device) {}
-		//INFO:Very expensive, might compile shader if not already compiled, lots of structs, ...
-		GraphicsPipeline(ref<Device> device, vec_ref<Shader> shaders, vk::PrimitiveTopology topology, vk::PolygonMode polygonMode, vk::Extent2D extent, vk::Format imageFormat) :
-			device_(device), shaders_(shaders), topology_(topology), polygonMode_(polygonMode), extent_(extent), imageFormat_(imageFormat)
+		//The reserved memory of name has been written, it will be transferred by the next upload
+		void commit(std::string name)
 		{
-			//Shader stages
-			std::vector<vk::PipelineShaderStageCreateInfo> shaderStages;
-			for (auto s : shaders_)
+			commit(handle(name));
+		}
+
+		void commit(ElementHandle handle)
+		{
+			commit(handle, 0);
+		}
+
+		//Submits the copies of everything committed, without waiting for them (see uploadSignal)
+		//INFO:An element committed several times is only copied once, with its last data, and contiguous copies are merged (see coalesceCopies)
+		void upload(bool overwriting = false)
+		{
+			std::unique_lock lock(stagingMutex_);
+
+			//Publishing what previous transfers finished, the ones still running are left alone
+			retireTransfers();
+			std::vector<ElementMove> moves = publishMoves();
+
+			size_t firstChunk = chunksInFlight_.size(); //Chunks of this upload get their value once the copies are handed over
+
+			std::vector<vk::BufferCopy2> copyRegions = {};
+			//Whole element ranges committed again later are superseded, only the last one is copied
+			std::vector<bool> superseded(toBeUploaded_.size(), false);
+			std::vector<bool> latest(elements_.size(), false);
+			for (size_t r = toBeUploaded_.size(); r-- > 0;)
 			{
-				vk::PipelineShaderStageCreateInfo createInfo = {};
-				createInfo.stage = s.get().stage();
-				createInfo.module = s.get().shader();//INFO:Expensive, might read file and compile
-				createInfo.pName = "main";
+				const StagedRange& staged = toBeUploaded_[r];
+				if (staged.chunk) { continue; }
 
-				shaderStages.push_back(createInfo);
+				superseded[r] = latest[staged.element.index];
+				latest[staged.element.index] = true;
 			}
 
-			//Vertex input
-			vk::PipelineVertexInputStateCreateInfo vertexInput = {};
+			//Looping over every to be uploaded mesh
+			for (size_t r = 0; r < toBeUploaded_.size(); r++)
+			{
+				const StagedRange& staged = toBeUploaded_[r];
+				if (superseded[r]) { continue; }
 
-			//Input assembly
-			vk::PipelineInputAssemblyStateCreateInfo inputAssembly = {};
-			inputAssembly.topology = topology_;
+				Element* element = resolve(staged.element);
 
-			//Rasterizer
-			vk::PipelineRasterizationStateCreateInfo rasterization = {};
-			rasterization.polygonMode = polygonMode_;
-			rasterization.lineWidth = 1.0f;
+				//Adding copy region from staging to buffer
+				vk::BufferCopy2 copyRegion = {};
+				copyRegion.srcOffset = staged.stagingOffset;
+				copyRegion.size = staged.size;
 
-			rasterization.cullMode = vk::CullModeFlagBits::eNone;
-			rasterization.frontFace = vk::FrontFace::eClockwise;
+				//Chunks go to their place in an element allocated beforehand
+				if (staged.chunk)
+				{
+					copyRegion.dstOffset = element->offset + staged.elementOffset;
+					copyRegions.push_back(copyRegion);
+					copyToMoves(staged.element, copyRegion, staged.elementOffset, copyRegions);
 
-			//Multisampling
-			vk::PipelineMultisampleStateCreateInfo multisample = {};
-			multisample.rasterizationSamples = vk::SampleCountFlagBits::e1;
+					chunksInFlight_.push_back(InFlightChunk{ staged.element, staged.size, 0 });
+					continue;
+				}
 
-			multisample.minSampleShading = 1.0f;
+				//Find space in buffer
+				bool elementPresent = element->placed();
+				if (elementPresent && !overwriting) //Element already present + we don't overwrite
+				{
+					element->contentHash = 0; //Its content is not the one last added anymore
+					continue;
+				}
 
-			//Color blend
-			vk::PipelineColorBlendAttachmentState colorBlendAttachment = {};
-			colorBlendAttachment.colorWriteMask = vk::ColorComponentFlagBits::eR |
-												  vk::ColorComponentFlagBits::eG |
-												  vk::ColorComponentFlagBits::eB |
-												  vk::ColorComponentFlagBits::eA;
+				if (elementPresent && staged.size > element->size)
+				{
+					KILL(std::format("Overwriting following object with more data than it holds: {} ({} bytes for {})", elementName(staged.element), staged.size,
+						element->size));
+				}
 
-			vk::PipelineColorBlendStateCreateInfo colorBlend = {};
-			colorBlend.logicOp = vk::LogicOp::eCopy;
+				uint64_t selectedOffset = elementPresent ? element->offset : placeElement(staged.element, staged.size);
+				if (selectedOffset == std::numeric_limits<uint64_t>::max())
+				{
+					KILL(std::format("Not enough space in local buffer for following mesh : {} of size {}", elementName(staged.element), staged.size));
+				}
 
-			colorBlend.attachmentCount = 1;
-			colorBlend.pAttachments = &colorBlendAttachment;
+				copyRegion.dstOffset = selectedOffset;
+				copyRegions.push_back(copyRegion);
+				if (elementPresent) { copyToMoves(staged.element, copyRegion, 0, copyRegions); }
+			}
 
-			//Depth
+			toBeUploaded_.clear();
 
-			vk::PipelineDepthStencilStateCreateInfo depth = {};
-			depth.depthTestEnable = true; //Depth test
-			depth.depthWriteEnable = true; //Depth write
-			depth.depthCompareOp = vk::CompareOp::eLessOrEqual; //Draw if Z less or equal
+			//Upload to buffer
+			if (!copyRegions.empty())
+			{
+				uint64_t value = submitCopies(stagingBuffer_.vk(), copyRegions);
+				for (size_t c = firstChunk; c < chunksInFlight_.size(); c++) { chunksInFlight_[c].value = value; }
+			}
 
-			depth.minDepthBounds = 0.f;
-			depth.maxDepthBounds = 1.f;
+			releaseStaging();
 
-			//Scissor
-			vk::Rect2D scissor = {};
-			scissor.offset = vk::Offset2D{ 0, 0 };
-			scissor.extent = extent_;
+			lock.unlock();
+			notifyRelocations(moves);
+		}
 
-			//Viewport
-			vk::Viewport viewport = {};
-			viewport.width = static_cast<float>(extent_.width);
-			viewport.height = static_cast<float>(extent_.height);
-			
-			viewport.minDepth = 0.0f;
-			viewport.maxDepth = 1.0f;
+		//Element moved by defragment, offsets in bytes
+		struct ElementMove
+		{
+			const Buffer* buffer = nullptr;
+			ElementHandle element;
+			vk::DeviceSize from = 0;
+			vk::DeviceSize to = 0;
+			vk::DeviceSize size = 0;
+		};
 
-			vk::PipelineViewportStateCreateInfo viewportState = {};
-			viewportState.viewportCount = 1;
-			viewportState.pViewports = &viewport;
+		//Timeline semaphore of the upload scheduler and the value it reaches once every copy of this buffer handed over so far is finished
+		//INFO:The batch of that value may not be submitted yet, see UploadScheduler::submit
+		//Thread safe
+		std::pair<vk::Semaphore, uint64_t> uploadSignal()
+		{
+			std::scoped_lock lock(stagingMutex_);
+			return std::make_pair(uploads_.get().signal().first, transferValue_);
+		}
+
+		//Blocks until every copy handed over so far is finished
+		//Thread safe
+		void waitUploads()
+		{
+			uploads_.get().wait(uploadSignal().second);
+		}
+
+		//Called with the moves of a finished defragmentation step, from the thread calling upload or defragment (see BufferView::relocate)
+		void onRelocation(std::function<void(const std::vector<ElementMove>&)> callback)
+		{
+			std::scoped_lock lock(stagingMutex_);
+			relocationCallbacks_.push_back(std::move(callback));
+		}
+
+		//Moves elements from the end of the buffer to free space before them, at most byteBudget bytes per call (to be called every frame)
+		//Returns the bytes being moved, 0 once the buffer is compact enough or when nothing can move
+		//INFO:Copies run on the transfer queue, the new offsets are published (elements and onRelocation) by the first upload or defragment call
+		//made once they are finished. The old space is only freed by the defragment call after that, which must be made once no command reads the old offsets
+		//(after waiting for the frame that was recorded before publication)
+		//Elements with staging memory waiting to be uploaded are not moved
+		//INFO:The moved ranges are owned by the family reading the buffer, the upload scheduler returns them to the transfer one (see UploadScheduler::acquire)
+		vk::DeviceSize defragment(vk::DeviceSize byteBudget, float maxFragmentation = 0.05f)
+		{
+			std::unique_lock lock(stagingMutex_);
+
+			for (auto offset : retiredOffsets_)
+			{
+				allocator_.free(offset);
+			}
+			retiredOffsets_.clear();
+
+			retireTransfers();
+			std::vector<ElementMove> moves = publishMoves();
+
+			std::erase_if(removedOffsets_, [&](const RemovedOffset& removed)
+				{
+					if (removed.value > completedValue_) { return false; }
+
+					allocator_.free(removed.offset);
+					return true;
+				});
+
+			std::erase_if(retiredBuffers_, [&](RetiredBuffer& retired)
+				{
+					if (retired.value > completedValue_) { return false; }
+
+					uploads_.get().discard(retired.buffer->vk());
+					return true;
+				});
+
+			size_t firstMove = pendingMoves_.size(); //Moves of this call get their value once the copies are handed over
+
+			std::vector<vk::BufferCopy2> copyRegions = {};
+			vk::DeviceSize movedSize = 0;
+			if (allocator_.fragmentation() > maxFragmentation)
+			{
+				//Elements still moving keep their old offset until published
+				std::vector<bool> staged(elements_.size(), false);
+				for (const auto& range : toBeUploaded_) { staged[range.element.index] = true; }
+				for (const auto& pending : pendingMoves_) { staged[pending.move.element.index] = true; }
+
+				//Last elements first, their space joining the free space at the end of the buffer
+				std::vector<std::pair<vk::DeviceSize, uint32_t>> candidates;
+				for (uint32_t e = 0; e < elements_.size(); e++)
+				{
+					const Element& element = elements_[e];
+					if (!element.alive || !element.placed() || element.size == 0 || element.reserved || staged[e]) { continue; }
+
+					candidates.push_back(std::make_pair(element.offset, e));
+				}
+				std::sort(candidates.begin(), candidates.end(), std::greater<>());
+
+				for (const auto& [offset, e] : candidates)
+				{
+					vk::DeviceSize size = elements_[e].size;
+					if (movedSize + size > byteBudget) { continue; }
+
+					vk::DeviceSize to = allocator_.allocate(size);
+					if (to == std::numeric_limits<uint64_t>::max()) { continue; }
+					if (to > offset) //INFO:Only moves toward the start, so that elements can not move back and forth
+					{
+						allocator_.free(to);
+						continue;
+					}
+
+					vk::BufferCopy2 copyRegion = {};
+					copyRegion.srcOffset = offset;
+					copyRegion.dstOffset = to;
+					copyRegion.size = size;
+					copyRegions.push_back(copyRegion);
+
+					pendingMoves_.push_back(PendingMove{ ElementMove{ this, ElementHandle{ e, elements_[e].generation }, offset, to, size }, 0 });
+					movedSize += size;
+				}
+			}
+
+			if (!copyRegions.empty())
+			{
+				uint64_t value = submitCopies(buffer_, copyRegions);
+				for (size_t m = firstMove; m < pendingMoves_.size(); m++) { pendingMoves_[m].value = value; }
+			}
+
+			lock.unlock();
+			notifyRelocations(moves);
+
+			return movedSize;
+		}
+
+		//Frees the space of name, transfers of name not uploaded yet being dropped
+		//INFO:The space is freed by the first defragment call made once the transfers handed over so far are finished, like the old offsets of moves
+		//(defragment must be made once no command reads the element anymore)
+		//Removing an element whose staging memory is reserved and not committed yet is an error, another thread may still be writing it
+		//Handles of the element stop resolving, its slot being reused with a new generation
+		void remove(std::string name)
+		{
+			remove(handle(name));
+		}
+
+		void remove(ElementHandle handle)
+		{
+			std::scoped_lock lock(stagingMutex_);
+
+			Element* element = resolve(handle);
+			if (element == nullptr) { return; }
+
+			if (element->reserved)
+			{
+				KILL(std::format("Removing following object while its staging memory is reserved: {}", elementName(handle)));
+			}
+
+			if (element->placed()) { removedOffsets_.push_back(RemovedOffset{ element->offset, transferValue_ }); }
+
+			std::erase_if(pendingMoves_, [&](const PendingMove& pending)
+				{
+					if (pending.move.element == handle) { removedOffsets_.push_back(RemovedOffset{ pending.move.to, transferValue_ }); }
+					return pending.move.element == handle;
+				});
+
+			std::erase_if(toBeUploaded_, [&](const StagedRange& staged) { return staged.element == handle; });
+			std::erase_if(chunksInFlight_, [&](const InFlightChunk& chunk) { return chunk.element == handle; });
+
+			if (!element->name.empty()) { names_.erase(element->name); }
+
+			uint32_t generation = element->generation + 1;
+			*element = Element{};
+			element->generation = generation;
+			freeElements_.push_back(handle.index);
+		}
+
+		//Thread safe, changes when the buffer grows (see growth)
+		vk::DeviceAddress address()
+		{
+			std::scoped_lock lock(stagingMutex_);
+			return Buffer::address();
+		}
+
+		//Thread safe, changes when the buffer grows (see growth)
+		vk::Buffer vk()
+		{
+			std::scoped_lock lock(stagingMutex_);
+			return Buffer::vk();
+		}
+
+		//Thread safe, changes when the buffer grows (see growth)
+		vk::DeviceSize size()
+		{
+			std::scoped_lock lock(stagingMutex_);
+			return Buffer::size();
+		}
+
+
+		//Size of total freeSpace
+		vk::DeviceSize voidSize()
+		{
+			std::scoped_lock lock(stagingMutex_);
+			return allocator_.freeSize();
+		}
+
+		//Largest element that can still be added
+		vk::DeviceSize largestVoidSize()
+		{
+			std::scoped_lock lock(stagingMutex_);
+			return allocator_.largestFreeBlock();
+		}
+
+		//See TlsfAllocator::fragmentation
+		float fragmentation()
+		{
+			std::scoped_lock lock(stagingMutex_);
+			return allocator_.fragmentation();
+		}
+
+		//Staging bytes not held by reservations, committed ranges or running transfers (as of the last retirement)
+		vk::DeviceSize stagingVoidSize()
+		{
+			std::scoped_lock lock(stagingMutex_);
+			return stagingBuffer_.size() - (stagingHead_ - stagingTail_);
+		}
+
+		//Copyable
+		struct Stats
+		{
+			vk::DeviceSize size = 0;
+			vk::DeviceSize voidSize = 0;
+			vk::DeviceSize largestVoidSize = 0;
+			float fragmentation = 0.0f; //See TlsfAllocator::fragmentation
+			size_t elementCount = 0; //Placed elements
+
+			vk::DeviceSize stagingSize = 0;
+			vk::DeviceSize stagingVoidSize = 0;
+		};
+
+		//Occupancy and fragmentation of the buffer and its staging, taken under a single lock
+		//Thread safe
+		Stats stats()
+		{
+			std::scoped_lock lock(stagingMutex_);
+
+			Stats stats = {};
+			stats.size = allocator_.size();
+			stats.voidSize = allocator_.freeSize();
+			stats.largestVoidSize = allocator_.largestFreeBlock();
+			stats.fragmentation = allocator_.fragmentation();
+			stats.elementCount = allocator_.allocationCount();
+
+			stats.stagingSize = stagingBuffer_.size();
+			stats.stagingVoidSize = stagingBuffer_.size() - (stagingHead_ - stagingTail_);
+
+			return stats;
+		}
+
+	protected:
+		//Staging memory written for an element, either the whole element or a chunk of an element allocated beforehand
+		struct StagedRange
+		{
+			ElementHandle element;
+			uint64_t ringPosition = 0; //See stagingHead_
+			vk::DeviceSize stagingOffset = 0;
+			vk::DeviceSize size = 0;
+			vk::DeviceSize elementOffset = 0; //Where the range goes in the element
+			vk::DeviceSize elementSize = 0;
+			bool chunk = false;
+		};
+
+		//Slot of an element, located inside the device local buffer once uploaded (or allocated)
+		struct Element
+		{
+			vk::DeviceSize offset = std::numeric_limits<uint64_t>::max(); //max until the element has its space in the buffer
+			vk::DeviceSize size = 0;
+			vk::DeviceSize streamedSize = 0; //Bytes of a streamed element known to be transferred
+			uint32_t generation = 0;
+			bool alive = false;
+			bool reserved = false; //Staging memory handed out by reserve and not committed yet
+			StagedRange reservation = {};
+			std::unique_ptr<char[]> overflow; //Host memory handed out instead of staging for reservations too large for it
+			uint64_t contentHash = 0; //Of the data last committed by add with hashContents, 0 when unknown
+			vk::DeviceSize contentSize = 0;
+			std::string name; //Debug metadata, empty for anonymous elements
+
+			bool placed() const
+			{
+				return offset != std::numeric_limits<uint64_t>::max();
+			}
+		};
+
+		//Dense slots indexed by ElementHandle::index, removed slots being reused from freeElements_
+		std::vector<Element> elements_{};
+		std::vector<uint32_t> freeElements_{};
+
+		//Named elements only, ["Monkey"] -> handle of the element of the mesh called monkey
+		std::unordered_map<std::string, ElementHandle> names_{};
+
+		//Free spaces of the buffer
+		TlsfAllocator allocator_;
+
+		//Moves copied by defragment, published by publishMoves once their transfer value is reached, then their old offsets freed by the next defragment call
+		struct PendingMove
+		{
+			ElementMove move;
+			uint64_t value = 0;
+		};
+		std::vector<PendingMove> pendingMoves_{};
+		std::vector<vk::DeviceSize> retiredOffsets_{};
+
+		//Spaces of removed elements, freed by the first defragment call once value is reached
+		struct RemovedOffset
+		{
+			vk::DeviceSize offset = 0;
+			uint64_t value = 0;
+		};
+		std::vector<RemovedOffset> removedOffsets_{};
+		std::vector<std::function<void(const std::vector<ElementMove>&)>> relocationCallbacks_{};
+
+		//Staging ring, positions only grow, the byte at position p being at p % stagingBuffer_.size()
+		//[stagingTail_, stagingHead_) is in use: read by running transfers, committed and waiting for upload or reserved
+		uint64_t stagingHead_ = 0;
+		uint64_t stagingTail_ = 0;
+
+		//Staging before end is reused once the transfer timeline reaches value, pushed by every upload
+		struct StagingRegion
+		{
+			uint64_t end = 0;
+			uint64_t value = 0;
+		};
+		std::deque<StagingRegion> stagingRegions_{};
+
+		//Meshes to be uploaded, awaiting transfer from staging to local
+		std::vector<StagedRange> toBeUploaded_{};
+
+		//Ring positions of the reservations not committed yet, the staging after the oldest one can not be reused
+		std::multiset<uint64_t> reservedPositions_{};
+
+		//Streamed chunks counted in streamedSize once their transfer value is reached
+		struct InFlightChunk
+		{
+			ElementHandle element;
+			vk::DeviceSize size = 0;
+			uint64_t value = 0;
+		};
+		std::vector<InFlightChunk> chunksInFlight_{};
 
-			viewportState.scissorCount = 1;
-			viewportState.pScissors = &scissor;
+		//Guards the staging bookkeeping and the elements, reservations and allocations can be made from loading threads
+		std::mutex stagingMutex_;
+		std::condition_variable stagingFreed_;
+		bool stagingWaitsCancelled_ = false; //See cancelStagingWaits
 
+		StagingBuffer stagingBuffer_;
 
-			//Pipeline layout
-			vk::PipelineLayoutCreateInfo pipelineLayout = {};
+		bool contentHashing_ = false;
 
-			//INFO:Vertex buffer device address + Mesh matrix buffer device address + Mesh matrix index
-			vk::PushConstantRange bdaPushConstants = {};
-			bdaPushConstants.offset = 0;
-			bdaPushConstants.size = 2*sizeof(vk::DeviceAddress)+1*sizeof(vk::DeviceSize);
-			bdaPushConstants.stageFlags = vk::ShaderStageFlagBits::eVertex;
+		//Copies are batched with the ones of the other buffers of the device, transferValue_ being the value of the last batch copies were handed to
+		//and completedValue_ the last value known to be reached
+		ref<UploadScheduler> uploads_;
+		uint64_t transferValue_ = 0;
+		uint64_t completedValue_ = 0;
 
-			pipelineLayout.pushConstantRangeCount = 1;
-			pipelineLayout.pPushConstantRanges = &bdaPushConstants;
-			VK_CHECK(device_.get().vk().createPipelineLayout(&pipelineLayout, nullptr, &pipelineLayout_));
+		//Growth policy (see growth), usage and pool being those of the buffers replacing this one
+		vk::Flags<vk::BufferUsageFlagBits> usage_;
+		MemoryPool pool_;
+		float growthFactor_ = 0.0f; //0 when the buffer does not grow
+		vk::DeviceSize maxSize_ = 0;
 
-			//Pipeline rendering
-			vk::PipelineRenderingCreateInfo rendering = {};
-			rendering.colorAttachmentCount = 1;
-			rendering.pColorAttachmentFormats = &imageFormat;
-			rendering.depthAttachmentFormat = vk::Format::eD32Sfloat;
+		//Buffers replaced by grow, destroyed by defragment once the copy of their content (value) is finished
+		struct RetiredBuffer
+		{
+			std::unique_ptr<Buffer> buffer;
+			uint64_t value = 0;
+		};
+		std::vector<RetiredBuffer> retiredBuffers_{};
 
+		//Element lookup that does not create missing elements, (0, 0) when name is not in the buffer (or not uploaded yet)
+		//Thread safe
+		std::pair<vk::DeviceSize, vk::DeviceSize> element(std::string name)
+		{
+			return element(handle(name));
+		}
 
-			//Creating pipeline
-			vk::GraphicsPipelineCreateInfo createInfo = {};
-			createInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
-			createInfo.pStages = shaderStages.data();
+		std::pair<vk::DeviceSize, vk::DeviceSize> element(ElementHandle handle)
+		{
+			std::scoped_lock lock(stagingMutex_);
 
-			createInfo.pVertexInputState = &vertexInput;
-			createInfo.pInputAssemblyState = &inputAssembly;
+			Element* element = resolve(handle);
+			return (element != nullptr && element->placed()) ? std::make_pair(element->offset, element->size) : std::make_pair<vk::DeviceSize, vk::DeviceSize>(0, 0);
+		}
 
-			createInfo.pViewportState = &viewportState;
+		//Handle of the element called name, created if there is none
+		//Thread safe
+		ElementHandle namedHandle(std::string name)
+		{
+			std::scoped_lock lock(stagingMutex_);
 
-			createInfo.pRasterizationState = &rasterization;
+			auto named = names_.find(name);
+			return (named != names_.end()) ? named->second : createElement(name);
+		}
 
-			createInfo.pMultisampleState = &multisample;
+		//nullptr for invalid handles and handles of removed elements
+		//stagingMutex_ must be held, the pointer is invalidated by createElement
+		Element* resolve(ElementHandle handle)
+		{
+			if (handle.index >= elements_.size()) { return nullptr; }
 
-			createInfo.pColorBlendState = &colorBlend;
+			Element& element = elements_[handle.index];
+			return (element.alive && element.generation == handle.generation) ? &element : nullptr;
+		}
 
-			createInfo.pDepthStencilState = &depth;
+		//stagingMutex_ must be held
+		ElementHandle createElement(std::string name)
+		{
+			uint32_t index = static_cast<uint32_t>(elements_.size());
+			if (!freeElements_.empty())
+			{
+				index = freeElements_.back();
+				freeElements_.pop_back();
+			}
+			else
+			{
+				elements_.push_back({});
+			}
 
-			createInfo.layout = pipelineLayout_;
+			Element& element = elements_[index];
+			element.alive = true;
+			element.name = std::move(name);
 
-			createInfo.pNext = &rendering;
+			ElementHandle handle = { index, element.generation };
+			if (!element.name.empty()) { names_[element.name] = handle; }
 
-			auto result = device_.get().vk().createGraphicsPipeline(nullptr, createInfo);
+			return handle;
+		}
 
-			VK_CHECK(result.result);
+		//For error messages, stagingMutex_ must be held
+		std::string elementName(ElementHandle handle)
+		{
+			Element* element = resolve(handle);
+			if (element == nullptr) { return std::format("removed element {}", handle.index); }
 
-			pipeline_ = result.value;
+			return element->name.empty() ? std::format("element {}", handle.index) : element->name;
 		}
 
-		//TODO:Implement move constructors
-		GraphicsPipeline(GraphicsPipeline&& other) = delete;
-		GraphicsPipeline& operator=(GraphicsPipeline&& other) noexcept
+		//The reserved memory of handle has been written, hash being the content hash of the data (see add) or 0
+		//stagingMutex_ must not be held
+		void commit(ElementHandle handle, uint64_t hash)
 		{
-			destroy();
+			std::unique_lock lock(stagingMutex_);
 
-			destroyed_ = other.destroyed_;
-			other.destroyed_ = true;
+			Element* element = resolve(handle);
+			if (element == nullptr || !element->reserved)
+			{
+				KILL(std::format("Committing following object without reserving staging memory first: {}", elementName(handle)));
+			}
 
-			manual_ = other.manual_;
-			other.manual_ = false;
+			element->contentHash = hash;
+			element->contentSize = element->reservation.size;
 
-			pipeline_ = other.pipeline_;
-			other.pipeline_ = nullptr;
+			if (element->overflow)
+			{
+				streamOverflow(lock, handle);
+				return;
+			}
 
-			pipelineLayout_ = other.pipelineLayout_;
-			other.pipelineLayout_ = nullptr;
+			if (element->reservation.chunk) { element->contentHash = 0; }
 
-			//TODO:Device should be the same, or implement stuff in Device
+			toBeUploaded_.push_back(element->reservation);
+			element->reserved = false;
+			reservedPositions_.erase(reservedPositions_.find(element->reservation.ringPosition));
+		}
 
-			shaders_ = other.shaders_;
-			other.shaders_ = vec_ref<Shader>();
+		//64 bit hash of size bytes, 8 bytes at a time
+		static uint64_t contentHash(const void* data, size_t size)
+		{
+			const char* bytes = static_cast<const char*>(data);
+			uint64_t hash = 0xCBF29CE484222325 ^ size;
 
-			topology_ = other.topology_;
-			polygonMode_ = other.polygonMode_;
-			extent_ = other.extent_;
-			imageFormat_ = other.imageFormat_;
+			size_t i = 0;
+			for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+			{
+				uint64_t word;
+				memcpy(&word, bytes + i, sizeof(uint64_t));
+				hash = (hash ^ word) * 0x9E3779B97F4A7C15;
+				hash ^= hash >> 29;
+			}
 
-			return *this;
-		}
+			uint64_t tail = 0;
+			memcpy(&tail, bytes + i, size - i);
+			hash = (hash ^ tail) * 0xC2B2AE3D27D4EB4F;
+			hash ^= hash >> 32;
 
-		//No copy constructors
-		GraphicsPipeline(GraphicsPipeline& other) = delete;
-		GraphicsPipeline& operator=(GraphicsPipeline& other) = delete;
+			return (hash != 0) ? hash : 1; //INFO:0 means unknown content
+		}
 
-		void destroy()
+		//Merges copies whose source and destination ranges both follow each other into single regions, sorting them by source offset
+		//INFO:Elements added one after another (matrices) are staged and placed next to each other, ending up as one region
+		static void coalesceCopies(std::vector<vk::BufferCopy2>& copyRegions)
 		{
-			if (destroyed_) { return; }
-			device_.get().vk().destroyPipelineLayout(pipelineLayout_);
-			device_.get().vk().destroyPipeline(pipeline_);
-			destroyed_ = true;
+			if (copyRegions.size() < 2) { return; }
+
+			std::sort(copyRegions.begin(), copyRegions.end(), [](const vk::BufferCopy2& a, const vk::BufferCopy2& b)
+				{
+					return (a.srcOffset != b.srcOffset) ? a.srcOffset < b.srcOffset : a.dstOffset < b.dstOffset;
+				});
+
+			size_t merged = 0;
+			for (size_t r = 1; r < copyRegions.size(); r++)
+			{
+				vk::BufferCopy2& last = copyRegions[merged];
+				const vk::BufferCopy2& region = copyRegions[r];
+				if (last.srcOffset + last.size == region.srcOffset && last.dstOffset + last.size == region.dstOffset)
+				{
+					last.size += region.size;
+					continue;
+				}
+
+				copyRegions[++merged] = region;
+			}
+			copyRegions.resize(merged + 1);
 		}
 
-		~GraphicsPipeline()
+		//Reserves size bytes at the head of the staging ring, waiting for running transfers to free some when it is full
+		//When nothing is running either, waits for another thread to upload the committed ranges with waitForUpload, fails otherwise
+		//stagingMutex_ must be held through lock, it is released while waiting
+		void* reserveStaging(std::unique_lock<std::mutex>& lock, ElementHandle handle, size_t size, vk::DeviceSize elementOffset, bool chunk, bool waitForUpload)
 		{
-			if (manual_) { return; }
-			destroy();
-		}
+			uint64_t position = stagingPosition(size);
+			while (position == std::numeric_limits<uint64_t>::max())
+			{
+				retireTransfers();
+				position = stagingPosition(size);
+				if (position != std::numeric_limits<uint64_t>::max()) { break; }
 
-		vk::Pipeline vk() const  { return pipeline_; }
-		vk::PipelineLayout layout() const  { return pipelineLayout_; }
+				if (!stagingRegions_.empty()) //Oldest running transfer
+				{
+					uint64_t value = stagingRegions_.front().value;
+					lock.unlock();
+					uploads_.get().wait(value); //INFO:Submits the batch of value first when nobody did yet
+					lock.lock();
+				}
+				else if (waitForUpload) //Staging is held by committed ranges, another thread uploads them
+				{
+					//INFO:Thrown rather than killed, the loading task unwinds and its future rethrows
+					if (stagingWaitsCancelled_)
+					{
+						throw std::runtime_error(std::format("Staging wait cancelled for following object: {}", elementName(handle)));
+					}
 
-	private:
-		vk::Pipeline pipeline_{};
-		vk::PipelineLayout pipelineLayout_{};
+					stagingFreed_.wait(lock);
+				}
+				else
+				{
+					KILL(std::format("Not enough space in staging buffer (size = {} bytes) when trying to add following object: {} of size {} bytes ({} bytes waiting for upload)",
+						stagingBuffer_.size(), elementName(handle), size, stagingHead_ - stagingTail_));
+				}
+			}
 
-		ref<Device> device_;
+			//INFO:Resolved after waiting, elements may have been added or removed meanwhile
+			Element* element = resolve(handle);
+			if (element == nullptr)
+			{
+				KILL(std::format("Reserving staging memory for a removed element: {}", handle.index));
+			}
+			if (element->reserved)
+			{
+				KILL(std::format("Staging memory already reserved for following object: {}", elementName(handle)));
+			}
 
-		vec_ref<Shader> shaders_{};
+			StagedRange staged = {};
+			staged.element = handle;
+			staged.ringPosition = position;
+			staged.stagingOffset = position % stagingBuffer_.size();
+			staged.size = size;
+			staged.elementOffset = elementOffset;
+			staged.elementSize = chunk ? element->size : size;
+			staged.chunk = chunk;
 
-		vk::PrimitiveTopology topology_{};
-		vk::PolygonMode polygonMode_{};
-		vk::Extent2D extent_{};
-		vk::Format imageFormat_{};
-	};
+			element->reservation = staged;
+			element->reserved = true;
+			reservedPositions_.insert(position);
 
-	class Allocator : Destroyable
-	{
-	public:
-		Allocator(ref<Instance> instance, ref<Device> device) : instance_(instance), device_(device)
+			stagingHead_ = position + size;
+
+			return static_cast<char*>(stagingBuffer_.mapped()) + staged.stagingOffset;
+		}
+
+		//Streams the host memory reserved for handle through staging, each chunk being submitted as soon as it is written
+		//INFO:The element is placed right away, an existing element is overwritten without waiting for upload(true). Its chunks are counted in streamedSize
+		//Like reserveChunk, waits for another thread to upload the committed ranges holding the staging rather than failing
+		//stagingMutex_ must be held through lock, it is released while waiting and copying
+		void streamOverflow(std::unique_lock<std::mutex>& lock, ElementHandle handle)
 		{
-			VmaAllocatorCreateInfo createInfo = {};
+			Element* element = resolve(handle);
+			std::unique_ptr<char[]> data = std::move(element->overflow);
+			vk::DeviceSize size = element->reservation.size;
+			element->reserved = false;
 
-			createInfo.physicalDevice = device_.get().physicalDevice();
-			createInfo.device = device_.get().vk();
-			createInfo.instance = instance_.get().vk();
-			createInfo.flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
+			if (!element->placed() && placeElement(handle, size) == std::numeric_limits<uint64_t>::max())
+			{
+				KILL(std::format("Not enough space in local buffer for following mesh : {} of size {}", elementName(handle), size));
+			}
+			if (size > resolve(handle)->size)
+			{
+				KILL(std::format("Overwriting following object with more data than it holds: {} ({} bytes for {})", elementName(handle), size, resolve(handle)->size));
+			}
 
-			VmaVulkanFunctions vulkanFunctions = {};
-			vulkanFunctions.vkGetInstanceProcAddr = vkGetInstanceProcAddress;
-			vulkanFunctions.vkGetDeviceProcAddr = vkGetDeviceProcAddress;
+			vk::DeviceSize chunkSize = stagingBuffer_.size() / 4; //INFO:Next chunks are written while the previous ones are transferred
+			for (vk::DeviceSize offset = 0; offset < size; offset += chunkSize)
+			{
+				size_t chunk = std::min(chunkSize, size - offset);
+				void* stagingMemory = reserveStaging(lock, handle, chunk, offset, true, true);
 
-			createInfo.pVulkanFunctions = &vulkanFunctions;
+				lock.unlock();
+				memcpy(stagingMemory, data.get() + offset, chunk);
+				lock.lock();
 
-			VK_CHECK(vk::Result(vmaCreateAllocator(&createInfo, &allocator_)));
+				element = resolve(handle);
+				if (element == nullptr) { return; } //INFO:Defensive, remove kills while the chunk is reserved
+
+				element->reserved = false;
+				reservedPositions_.erase(reservedPositions_.find(element->reservation.ringPosition));
+
+				vk::BufferCopy2 copyRegion = {};
+				copyRegion.srcOffset = element->reservation.stagingOffset;
+				copyRegion.dstOffset = element->offset + offset;
+				copyRegion.size = chunk;
+
+				std::vector<vk::BufferCopy2> copyRegions = { copyRegion };
+				copyToMoves(handle, copyRegion, offset, copyRegions);
+
+				uint64_t value = submitCopies(stagingBuffer_.vk(), copyRegions);
+				chunksInFlight_.push_back(InFlightChunk{ handle, chunk, value });
+
+				releaseStaging();
+				uploads_.get().submit(); //INFO:Each chunk is submitted on its own, the next ones being written while it is transferred
+			}
 		}
 
-		//TODO:Implement move constructors
-		Allocator(Allocator&& other) noexcept : allocator_(other.allocator_), instance_(other.instance_), device_(other.device_)
+		//Staging before the oldest range still reserved or waiting for upload is reused once the last submitted transfer is finished
+		//stagingMutex_ must be held
+		void releaseStaging()
 		{
-			destroyed_ = other.destroyed_;
-			other.destroyed_ = true;
-
-			manual_ = other.manual_;
-			other.manual_ = false;
+			uint64_t end = reservedPositions_.empty() ? stagingHead_ : *reservedPositions_.begin();
+			for (const auto& staged : toBeUploaded_)
+			{
+				end = std::min(end, staged.ringPosition);
+			}
 
-			other.allocator_ = VmaAllocator(nullptr);
+			uint64_t previousEnd = stagingRegions_.empty() ? stagingTail_ : stagingRegions_.back().end;
+			if (end > previousEnd)
+			{
+				stagingRegions_.push_back(StagingRegion{ end, transferValue_ });
+			}
+			stagingFreed_.notify_all(); //Chunks waiting for an upload can now wait for its transfer
 		}
-		Allocator& operator=(Allocator&& other) noexcept
+
+		//Ring position of size free contiguous bytes, max when the ring is too full
+		//INFO:Ranges never wrap around, the end of the staging buffer is skipped when too small
+		//stagingMutex_ must be held
+		uint64_t stagingPosition(size_t size)
 		{
-			destroy();
+			if (stagingHead_ == stagingTail_) //Empty ring, starting over from the start of staging
+			{
+				stagingHead_ = 0;
+				stagingTail_ = 0;
+			}
 
-			destroyed_ = other.destroyed_;
-			other.destroyed_ = true;
+			uint64_t position = stagingHead_;
+			uint64_t physical = position % stagingBuffer_.size();
+			if (physical + size > stagingBuffer_.size())
+			{
+				position += stagingBuffer_.size() - physical;
+			}
 
-			manual_ = other.manual_;
-			other.manual_ = false;
+			return (position + size - stagingTail_ <= stagingBuffer_.size()) ? position : std::numeric_limits<uint64_t>::max();
+		}
 
-			allocator_ = other.allocator_;
-			other.allocator_ = VmaAllocator(nullptr);
+		//Polls the transfer timeline and retires what finished, freeing staging regions and counting streamed chunks, never waits
+		//stagingMutex_ must be held
+		void retireTransfers()
+		{
+			if (completedValue_ < transferValue_)
+			{
+				completedValue_ = uploads_.get().completedValue();
+			}
 
-			instance_ = other.instance_;
+			bool freed = false;
+			while (!stagingRegions_.empty() && stagingRegions_.front().value <= completedValue_)
+			{
+				stagingTail_ = stagingRegions_.front().end;
+				stagingRegions_.pop_front();
+				freed = true;
+			}
+			if (freed) { stagingFreed_.notify_all(); }
 
-			device_ = other.device_;
-		}
+			std::erase_if(chunksInFlight_, [&](const InFlightChunk& chunk)
+				{
+					if (chunk.value > completedValue_) { return false; }
 
-		//No copy constructors
-		Allocator(Allocator& other) = delete;
-		Allocator& operator=(Allocator& other) = delete;
+					Element* element = resolve(chunk.element);
+					if (element != nullptr) { element->streamedSize += chunk.size; }
+					return true;
+				});
+		}
 
-		void destroy()
+		//Moves whose copies are finished get their new offsets, returned for notifyRelocations
+		//stagingMutex_ must be held, after retireTransfers
+		std::vector<ElementMove> publishMoves()
 		{
-			if (destroyed_) { return; }
-			vmaDestroyAllocator(allocator_);
-			destroyed_ = true;
+			std::vector<ElementMove> moves;
+			std::erase_if(pendingMoves_, [&](const PendingMove& pending)
+				{
+					if (pending.value > completedValue_) { return false; }
+
+					resolve(pending.move.element)->offset = pending.move.to;
+					retiredOffsets_.push_back(pending.move.from);
+					moves.push_back(pending.move);
+					return true;
+				});
+
+			return moves;
 		}
 
-		~Allocator()
+		//Writes to an element whose move is not published yet also go to its new offset, submitted after the move copy
+		//stagingMutex_ must be held
+		void copyToMoves(ElementHandle handle, vk::BufferCopy2 copyRegion, vk::DeviceSize elementOffset, std::vector<vk::BufferCopy2>& copyRegions)
 		{
-			if (manual_) { return; }
-			destroy();
+			for (const auto& pending : pendingMoves_)
+			{
+				if (pending.move.element != handle) { continue; }
+
+				copyRegion.dstOffset = pending.move.to + elementOffset;
+				copyRegions.push_back(copyRegion);
+			}
 		}
 
-		VmaAllocator vma() const { return allocator_; }
+		//stagingMutex_ must not be held, callbacks may query the buffer
+		void notifyRelocations(const std::vector<ElementMove>& moves)
+		{
+			if (moves.empty()) { return; }
 
-	private:
-		VmaAllocator allocator_{};
+			std::vector<std::function<void(const std::vector<ElementMove>&)>> callbacks;
+			{
+				std::scoped_lock lock(stagingMutex_);
+				callbacks = relocationCallbacks_;
+			}
 
-		ref<Instance> instance_;
-		ref<Device> device_;
-	};
+			for (const auto& callback : callbacks)
+			{
+				callback(moves);
+			}
+		}
 
-	class Buffer : public Destroyable
-	{
-	public:
-		Buffer(ref<Device> device, ref<Allocator> allocator, vk::Flags<vk::BufferUsageFlagBits> usage, vk::DeviceSize size, bool mappable = false, bool systemMemory = false) 
-			: device_(device), allocator_(allocator), size_(size), mappable_(mappable)
+		//Hands copies from src to this buffer over to the upload scheduler, returns the value of their batch
+		//stagingMutex_ must be held
+		uint64_t submitCopies(vk::Buffer src, std::vector<vk::BufferCopy2> copyRegions)
 		{
-			vk::BufferCreateInfo createInfo = {};
-
-			createInfo.size = size;
-			createInfo.usage = usage | vk::BufferUsageFlagBits::eShaderDeviceAddress;
-			
+			coalesceCopies(copyRegions);
 
-			VkBufferCreateInfo vkCreateInfo = static_cast<VkBufferCreateInfo>(createInfo);
+			transferValue_ = uploads_.get().copyBuffer(src, buffer_, std::move(copyRegions));
+			return transferValue_;
+		}
 
-			VmaAllocationCreateInfo allocInfo = {};
-			allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
-			if (systemMemory)
+		//Allocates size bytes for handle, growing the buffer when allowed to, max when it has no free space large enough
+		//stagingMutex_ must be held
+		vk::DeviceSize placeElement(ElementHandle handle, vk::DeviceSize size)
+		{
+			vk::DeviceSize offset = allocator_.allocate(size);
+			while (offset == std::numeric_limits<uint64_t>::max() && grow(size))
 			{
-				allocInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;//TODO:Later pick cpu memory only when device local host visible memory is not enough
-				allocInfo.preferredFlags = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT; //Prefer system memory
+				offset = allocator_.allocate(size);
 			}
 
-			if (mappable)
+			if (offset != std::numeric_limits<uint64_t>::max())
 			{
-				allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+				Element* element = resolve(handle);
+				element->offset = offset;
+				element->size = size;
 			}
 
-			VkBuffer buffer;
+			return offset;
+		}
+
+		//Replaces the buffer with one large enough for size more bytes, its content being copied by the upload scheduler
+		//INFO:Copies handed over before are recorded before that copy, pending moves and chunks landing in both buffers
+		//false when growth is disabled or the buffer reached maxSize_
+		//stagingMutex_ must be held
+		bool grow(vk::DeviceSize size)
+		{
+			if (growthFactor_ <= 0.0f) { return false; }
+
+			//INFO:Margin for the alignment of the free space and the rounding of TLSF searches
+			vk::DeviceSize required = size_ + size + size / 16 + allocator_.alignment();
+			vk::DeviceSize grownSize = std::min(std::max(static_cast<vk::DeviceSize>(size_ * growthFactor_), required), maxSize_);
+			if (grownSize <= size_) { return false; }
+
+			auto grown = std::make_unique<Buffer>(device_, Buffer::allocator_, usage_, grownSize, false, false, false, tag_, pool_);
+
+			vk::BufferCopy2 copyRegion = {};
+			copyRegion.srcOffset = 0;
+			copyRegion.dstOffset = 0;
+			copyRegion.size = size_;
+			//INFO:The old buffer is returned by the graphics family before being read (see UploadScheduler), and kept by the transfer one afterwards
+			transferValue_ = uploads_.get().copyBuffer(buffer_, grown->vk(), { copyRegion }, QueueFamilyCapability::GRAPHICS, true);
+
+			swap(*grown); //INFO:grown now holds the old buffer, address being queried again for the new one
+			retiredBuffers_.push_back(RetiredBuffer{ std::move(grown), transferValue_ });
+
+			allocator_.grow(grownSize);
+			return true;
+		}
+	};
+	
+	//Big buffer holding lots of vertices in device_local memory
+	//Layout is the vertex format stored on the gpu (Vertex, CompactVertex), meshes are encoded to it while being written to staging
+	//INFO:A layout provides layoutName, boundsRelative, encode(vertex, bounds), decodeMatrix(bounds) and glsl(), the shader side being set with Shader::vertexLayout
+	template<typename Layout>
+	class VertexBuffer : public LocalBuffer
+	{
+	public:
+		VertexBuffer(ref<Device> device, ref<Allocator> allocator, vk::DeviceSize localSize, vk::DeviceSize stagingSize = 10'000'000, MemoryPool pool = MemoryPool::GEOMETRY) :
+			LocalBuffer(device, allocator, localSize, stagingSize, {}, sizeof(Layout), MemoryTag::VERTEX, pool) {}
+
+		using LocalBuffer::add;
+
+		//Adds and uploads mesh vertices to staging, under the mesh name
+		ElementHandle add(Mesh& mesh)
+		{
+			std::span<const Vertex> vertices = mesh.vertices();
+			ElementHandle handle = namedHandle(mesh.name());
 
-			VK_CHECK(vk::Result(vmaCreateBuffer(allocator_.get().vma(), &vkCreateInfo, &allocInfo, &buffer, &allocation_, nullptr)));
+			encode(vertices, mesh.bounds(), static_cast<Layout*>(reserve(handle, vertices.size() * sizeof(Layout))));
+			commit(handle);
 
-			buffer_ = vk::Buffer(buffer);
+			return handle;
+		}
 
-			//TODO:Look into VMA Persistently mapped memory
-			if (mappable_)
+		//Streams vertices to firstVertex of name, allocated beforehand for the whole mesh (see LocalBuffer::allocate)
+		void addChunk(std::string name, std::span<const Vertex> vertices, const Bounds& bounds, size_t firstVertex)
+		{
+			encode(vertices, bounds, static_cast<Layout*>(reserveChunk(name, firstVertex * sizeof(Layout), vertices.size() * sizeof(Layout))));
+			commit(name);
+		}
+
+		//Encodes vertices to dst, sequentially as dst usually is staging memory
+		static void encode(std::span<const Vertex> vertices, const Bounds& bounds, Layout* dst)
+		{
+			for (const auto& vertex : vertices)
 			{
-				vmaMapMemory(allocator_.get().vma(), allocation_, &mappedMemory);
+				*dst++ = Layout::encode(vertex, bounds);
 			}
 		}
 
-		//TODO:Implement move constructors
-		Buffer(Buffer&& other) noexcept : device_(other.device_), allocator_(other.allocator_), buffer_(other.buffer_),
-			allocation_(other.allocation_), address_(other.address_)
+		//Adds the meshlets of mesh next to its vertices, under name.meshlets, name.meshletVertices and name.meshletTriangles
+		void addMeshlets(Mesh& mesh)
 		{
-			destroyed_ = other.destroyed_;
-			other.destroyed_ = true;
+			addMeshlets(mesh.name(), mesh.meshlets(), mesh.meshletVertices(), mesh.meshletTriangles());
+		}
 
-			manual_ = other.manual_;
-			other.manual_ = false;
+		void addMeshlets(std::string name, std::span<const Meshlet> meshlets, std::span<const uint32_t> vertices, std::span<const uint8_t> triangles)
+		{
+			addPadded(name + ".meshlets", meshlets.data(), meshlets.size_bytes());
+			addPadded(name + ".meshletVertices", vertices.data(), vertices.size_bytes());
+			addPadded(name + ".meshletTriangles", triangles.data(), triangles.size_bytes());
 
-			other.buffer_ = vk::Buffer(nullptr);
-			other.allocation_ = VmaAllocation(nullptr);
-			other.address_ = 0;
+			std::scoped_lock lock(stagingMutex_);
+			meshletCounts_[name] = meshlets.size();
 		}
-		Buffer& operator=(Buffer&& other) noexcept
+
+		//Byte offsets of the meshlet data of a mesh in the buffer, Meshlet::vertexOffset and Meshlet::triangleOffset being relative to vertexOffset and triangleOffset
+		struct MeshletRange
 		{
-			destroy();
+			vk::DeviceSize meshletOffset = 0;
+			vk::DeviceSize meshletCount = 0;
+			vk::DeviceSize vertexOffset = 0;
+			vk::DeviceSize triangleOffset = 0;
+		};
 
-			destroyed_ = other.destroyed_;
-			other.destroyed_ = true;
+		MeshletRange meshlets(std::string name)
+		{
+			MeshletRange range = {};
+			range.meshletOffset = element(name + ".meshlets").first;
+			{
+				std::scoped_lock lock(stagingMutex_);
+				range.meshletCount = meshletCounts_[name];
+			}
+			range.vertexOffset = element(name + ".meshletVertices").first;
+			range.triangleOffset = element(name + ".meshletTriangles").first;
 
-			manual_ = other.manual_;
-			other.manual_ = false;
+			return range;
+		}
 
-			device_ = other.device_;
+		//vertexMode = true -> (vertex offset, vertex count) will be returned
+		//When set to false, (real offset, real count) will be returned (in bytes)
+		std::pair<vk::DeviceSize, vk::DeviceSize> mesh(std::string name, bool vertexMode = true)
+		{
+			return mesh(handle(name), vertexMode);
+		}
 
-			allocator_ = other.allocator_;
+		std::pair<vk::DeviceSize, vk::DeviceSize> mesh(ElementHandle handle, bool vertexMode = true)
+		{
+			auto trueOffsetSize = element(handle);
+			return (vertexMode ? std::make_pair(trueOffsetSize.first / sizeof(Layout), trueOffsetSize.second / sizeof(Layout)) : trueOffsetSize);
+		}
+	private:
+		std::map<std::string, size_t> meshletCounts_{};
 
-			buffer_ = other.buffer_;
-			other.buffer_ = vk::Buffer(nullptr);
+		//INFO:Sizes are padded to a multiple of sizeof(Layout) so that every vertex element keeps an offset that is a whole number of vertices
+		void addPadded(std::string name, const void* data, size_t size)
+		{
+			size_t paddedSize = ((size + sizeof(Layout) - 1) / sizeof(Layout)) * sizeof(Layout);
 
-			allocation_ = other.allocation_;
-			other.allocation_ = VmaAllocation(nullptr);
+			char* stagingMemory = static_cast<char*>(reserve(name, paddedSize));
+			memcpy(stagingMemory, data, size);
+			memset(stagingMemory + size, 0, paddedSize - size);
 
-			address_ = other.address_;
-			other.address_ = 0;
+			commit(name);
 		}
+	};
 
-		//No copy constructors
-		Buffer(Buffer& other) = delete;
-		Buffer& operator=(Buffer& other) = delete;
-
+	//Big buffer holding the indices of every mesh in device_local memory, bound with vkCmdBindIndexBuffer
+	//INFO:Meshes with less than 65536 vertices are stored with 16 bit indices, 32 bit indices otherwise
+	class IndexBuffer : public LocalBuffer
+	{
+	public:
+		IndexBuffer(ref<Device> device, ref<Allocator> allocator, vk::DeviceSize localSize, vk::DeviceSize stagingSize = 10'000'000, MemoryPool pool = MemoryPool::GEOMETRY) :
+			LocalBuffer(device, allocator, localSize, stagingSize, vk::BufferUsageFlagBits::eIndexBuffer, sizeof(uint32_t), MemoryTag::INDEX, pool) {}
 
-		void destroy()
+		//Adds and uploads mesh indices to staging, under the mesh name, every level of detail being added under Mesh::lodName
+		void add(Mesh& mesh)
 		{
-			if (destroyed_) { return; }
-			if (mappable_) { vmaUnmapMemory(allocator_.get().vma(), allocation_); }
-			vmaDestroyBuffer(allocator_.get().vma(), buffer_, allocation_);
-			destroyed_ = true;
+			for (size_t lod = 0; lod < mesh.lodCount(); lod++)
+			{
+				add(Mesh::lodName(mesh.name(), lod), mesh.lodIndices(lod), mesh.vertexCount());
+			}
 		}
 
-		~Buffer()
+		//Indices referencing vertexCount vertices, 16 bit ones are narrowed while being written to staging
+		ElementHandle add(std::string name, std::span<const uint32_t> indices, size_t vertexCount)
 		{
-			if (manual_) { return; }
-			destroy();
+			ElementHandle handle = namedHandle(name);
+			vk::IndexType type = (vertexCount <= std::numeric_limits<uint16_t>::max()) ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+			setInfo(handle, type, indices.size());
+
+			if (type == vk::IndexType::eUint32)
+			{
+				LocalBuffer::add(handle, indices.data(), indices.size() * sizeof(uint32_t));
+				return handle;
+			}
+
+			//INFO:Padded to 4 bytes so that every element of the buffer stays aligned for 32 bit indices
+			size_t paddedCount = indices.size() + indices.size() % 2;
+			uint16_t* shortIndices = static_cast<uint16_t*>(reserve(handle, paddedCount * sizeof(uint16_t)));
+
+			for (size_t i = 0; i < indices.size(); i++)
+			{
+				shortIndices[i] = static_cast<uint16_t>(indices[i]);
+			}
+			if (paddedCount != indices.size()) { shortIndices[indices.size()] = 0; }
+
+			commit(handle);
+
+			return handle;
 		}
 
-		void upload(void *data, size_t size, uint32_t offset = 0)
+		//16 bit indices, copied as is
+		ElementHandle add(std::string name, std::span<const uint16_t> indices)
 		{
-			if (!mappable_) { KILL("Trying to map to a buffer that is not mappable"); }
-			
-			char* offsetDst = static_cast<char*>(mappedMemory) + offset;//We assume that sizeof(char) = 1
+			ElementHandle handle = namedHandle(name);
+			setInfo(handle, vk::IndexType::eUint16, indices.size());
 
-			memcpy(offsetDst, data, size);
+			//INFO:Padded to 4 bytes so that every element of the buffer stays aligned for 32 bit indices
+			size_t paddedCount = indices.size() + indices.size() % 2;
+			uint16_t* shortIndices = static_cast<uint16_t*>(reserve(handle, paddedCount * sizeof(uint16_t)));
+
+			memcpy(shortIndices, indices.data(), indices.size_bytes());
+			if (paddedCount != indices.size()) { shortIndices[indices.size()] = 0; }
+
+			commit(handle);
+
+			return handle;
 		}
 
-		vk::DeviceAddress address()
+		//Streams 32 bit indices to firstIndex of name, allocated beforehand for the whole mesh (see LocalBuffer::allocate)
+		//INFO:The vertex count of a streamed mesh is only known at the end, its indices are never narrowed
+		void addChunk(std::string name, std::span<const uint32_t> indices, size_t firstIndex)
 		{
-			if (address_ != 0) { return address_; }
-
-			vk::BufferDeviceAddressInfo addressInfo = {};
-			addressInfo.buffer = buffer_;
+			ElementHandle handle = this->handle(name);
+			setInfo(handle, vk::IndexType::eUint32, std::max<size_t>(info(handle).second, firstIndex + indices.size()));
 
-			address_ = device_.get().vk().getBufferAddress(&addressInfo);
-			return address_;
+			memcpy(reserveChunk(handle, firstIndex * sizeof(uint32_t), indices.size_bytes()), indices.data(), indices.size_bytes());
+			commit(handle);
 		}
 
-		vk::DeviceSize size()
+		//indexMode = true -> (first index, index count) will be returned, first index being in units of the mesh index type
+		//When set to false, (real offset, real count) will be returned (in bytes)
+		std::pair<vk::DeviceSize, vk::DeviceSize> mesh(std::string name, bool indexMode = true)
 		{
-			return size_;
+			return mesh(handle(name), indexMode);
 		}
 
-		vk::Buffer vk()
+		std::pair<vk::DeviceSize, vk::DeviceSize> mesh(ElementHandle handle, bool indexMode = true)
 		{
-			return buffer_;
+			auto trueOffsetSize = element(handle);
+			auto [type, count] = info(handle);
+			vk::DeviceSize indexSize = (type == vk::IndexType::eUint16) ? sizeof(uint16_t) : sizeof(uint32_t);
+
+			return (indexMode ? std::make_pair(trueOffsetSize.first / indexSize, static_cast<vk::DeviceSize>(count)) : trueOffsetSize);
 		}
 
-		VmaAllocation allocation()
+		vk::IndexType type(std::string name)
 		{
-			return allocation_;
+			return info(handle(name)).first;
 		}
 
-	protected:
-		ref<Device> device_;
-		ref<Allocator> allocator_;
+		vk::IndexType type(ElementHandle handle)
+		{
+			return info(handle).first;
+		}
+	private:
+		//Index type and index count (without padding) of every mesh, indexed like the elements
+		struct IndexInfo
+		{
+			ElementHandle element;
+			vk::IndexType type = vk::IndexType::eUint32;
+			size_t count = 0;
+		};
+		std::vector<IndexInfo> infos_{};
 
-		vk::Buffer buffer_;
-		VmaAllocation allocation_;
+		void setInfo(ElementHandle handle, vk::IndexType type, size_t count)
+		{
+			std::scoped_lock lock(stagingMutex_);
 
-		vk::DeviceSize size_ = 0;
+			if (handle.index >= infos_.size()) { infos_.resize(handle.index + 1); }
+			infos_[handle.index] = IndexInfo{ handle, type, count };
+		}
 
-		vk::DeviceAddress address_ = 0;
+		std::pair<vk::IndexType, size_t> info(ElementHandle handle)
+		{
+			std::scoped_lock lock(stagingMutex_);
 
-		bool mappable_;
-		void* mappedMemory = nullptr;
-		
+			bool known = handle.index < infos_.size() && infos_[handle.index].element == handle;
+			return known ? std::make_pair(infos_[handle.index].type, infos_[handle.index].count) : std::make_pair(vk::IndexType::eUint32, size_t(0));
+		}
 	};
 
-	class DepthImage : Destroyable
+	template<typename Layout>
+	Mesh Mesh::objMesh(std::string filename, VertexBuffer<Layout>& vertexBuffer, IndexBuffer& indexBuffer, MeshOptions options, bool useCache)//Defined after IndexBuffer definition
 	{
-	public:
-		DepthImage(ref<Device> device, ref<Allocator> allocator, vk::Extent2D extent) : device_(device), allocator_(allocator)
-		{
-			vk::Extent3D depthImageExtent = {};
-			depthImageExtent.width = extent.width;
-			depthImageExtent.height = extent.height;
-			depthImageExtent.depth = 1;
-
-			vk::Format depthFormat = vk::Format::eD32Sfloat;
-
-			vk::ImageCreateInfo createInfo = {};
-			createInfo.imageType = vk::ImageType::e2D;
+		std::string cacheFilename = filename + ".skmesh";
 
-			createInfo.format = depthFormat;
-			createInfo.extent = depthImageExtent;
-
-			createInfo.mipLevels = 1;
-			createInfo.arrayLayers = 1;
-			createInfo.samples = vk::SampleCountFlagBits::e1;
-			createInfo.tiling = vk::ImageTiling::eOptimal;
-			createInfo.usage = vk::ImageUsageFlagBits::eDepthStencilAttachment;
+		if (useCache && cacheUpToDate(filename, cacheFilename))
+		{
+			Mesh mesh;
+			if (mesh.loadCache(filename, cacheFilename, options))
+			{
+				//Single copy, from the mapped cache to staging
+				vertexBuffer.add(mesh);
+				indexBuffer.add(mesh);
+				if (options.meshlets) { vertexBuffer.addMeshlets(mesh); }
 
-			VkImageCreateInfo vkCreateInfo = static_cast<VkImageCreateInfo>(createInfo);
+				Mesh staged(filename, mesh.vertexCount(), mesh.indexCount(), mesh.bounds(), mesh.sphere());
+				for (size_t lod = 1; lod < mesh.lodCount(); lod++)
+				{
+					staged.lods_.push_back({ {}, mesh.lodError(lod) });
+				}
+				staged.submeshes_ = std::move(mesh.submeshes_);
+				staged.setNames(std::move(mesh.shapes_), std::move(mesh.materials_), std::move(mesh.materialLibraries_));
 
-			VmaAllocationCreateInfo allocationCreateInfo = {};
-			allocationCreateInfo.usage = VMA_MEMORY_USAGE_AUTO; //Use auto for depth-stencil https://gpuopen-librariesandsdks.github.io/VulkanMemoryAllocator/html/usage_patterns.html
-			allocationCreateInfo.requiredFlags = static_cast<VkMemoryPropertyFlags>(vk::MemoryPropertyFlagBits::eDeviceLocal);//TODO:Not sure about that here
+				return staged;
+			}
 
-			VkImage vkImage;
-			VK_CHECK(vk::Result(vmaCreateImage(allocator_.get().vma(), &vkCreateInfo, &allocationCreateInfo, &vkImage, &allocation_, nullptr)));
-			image_ = vk::Image(vkImage);
+			std::cout << std::format("Outdated or corrupted mesh cache [{}], parsing [{}] again", cacheFilename, filename) << std::endl;
+		}
 
-			vk::ImageViewCreateInfo viewCreateInfo = {};
-			viewCreateInfo.viewType = vk::ImageViewType::e2D;
+		ObjParser parser(filename);
 
-			viewCreateInfo.image = image_;
-			viewCreateInfo.format = depthFormat;
+		std::vector<uint32_t> indices;
+		std::vector<tinyobj::index_t> uniqueCorners;
+		uniqueVertices(filename, parser.positions(), parser.corners(), indices, uniqueCorners);
 
-			viewCreateInfo.subresourceRange.baseMipLevel = 0;
-			viewCreateInfo.subresourceRange.levelCount = 1;
+		std::vector<Submesh> submeshes = groupSubmeshes(parser.groups(), indices, true, parser.positions().data(), parser.positions().size(),
+			[&](uint32_t v) { return 3 * static_cast<size_t>(uniqueCorners[v].vertex_index); });
 
-			viewCreateInfo.subresourceRange.baseArrayLayer = 0;
-			viewCreateInfo.subresourceRange.layerCount = 1;
+		std::vector<glm::vec3> positions;
+		if (options.optimize || options.lods > 0 || options.meshlets)
+		{
+			positions.resize(uniqueCorners.size());
+			for (size_t v = 0; v < uniqueCorners.size(); v++)
+			{
+				const float* position = &parser.positions()[3 * uniqueCorners[v].vertex_index];
+				positions[v] = glm::vec3(position[0], position[1], position[2]);
+			}
+		}
 
-			viewCreateInfo.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eDepth;
+		if (options.optimize)
+		{
+			MeshOptimization optimization = optimizeMesh(positions, indices, options.vertexCacheSize, submeshRanges(submeshes));
+			uniqueCorners = remapVertices<tinyobj::index_t>(uniqueCorners, optimization);
+			positions = remapVertices<glm::vec3>(positions, optimization);
 
-			VK_CHECK(device_.get().vk().createImageView(&viewCreateInfo, nullptr, &view_));
+			logOptimization(filename, optimization);
 		}
-		//TODO:Implement move constructors
-		DepthImage(DepthImage&& other) noexcept : image_(other.image_), view_(other.view_), allocation_(other.allocation_),
-			device_(other.device_), allocator_(other.allocator_)
-		{
-			destroyed_ = other.destroyed_;
-			other.destroyed_ = true;
 
-			manual_ = other.manual_;
-			other.manual_ = false;
+		size_t vertexCount = uniqueCorners.size();
+		Layout* stagingVertices = static_cast<Layout*>(vertexBuffer.reserve(filename, vertexCount * sizeof(Layout)));
 
-			other.image_ = vk::Image(nullptr);
-			other.view_ = vk::ImageView(nullptr);
-			other.allocation_ = VmaAllocation(nullptr);
+		//INFO:Known before writing any vertex, quantized layouts are relative to them
+		Bounds bounds = positionBounds(parser.positions(), uniqueCorners);
+		BoundingSphere sphere = positionSphere(parser.positions(), uniqueCorners, bounds);
 
-		}
-		DepthImage& operator=(DepthImage&& other) noexcept
+		std::string tmpFilename = cacheFilename + ".tmp";
+		std::ofstream cacheFile;
+		if (useCache)
 		{
-			destroy();
+			cacheFile.open(tmpFilename, std::ios::binary);
 
-			destroyed_ = other.destroyed_;
-			other.destroyed_ = true;
+			MeshFileHeader header = {};
+			cacheFile.write((char*)&header, sizeof(MeshFileHeader)); //Rewritten once counts and bounds are known
+		}
 
-			manual_ = other.manual_;
-			other.manual_ = false;
+		//INFO:Vertices are built in a small cache resident chunk then encoded to staging (and written to the cache file), staging is never read back
+		constexpr size_t chunkSize = 2048;
+		std::vector<Vertex> chunk(chunkSize);
 
-			image_ = other.image_;
-			other.image_ = vk::Image(nullptr);
+		for (size_t first = 0; first < vertexCount; first += chunkSize)
+		{
+			size_t count = std::min(chunkSize, vertexCount - first);
+			writeVertices(parser.positions(), parser.normals(), parser.uvs(), std::span(uniqueCorners).subspan(first, count), chunk.data());
 
-			view_ = other.view_;
-			other.view_ = vk::ImageView(nullptr);
+			vertexBuffer.encode(std::span(chunk).first(count), bounds, stagingVertices + first);
 
-			allocation_ = other.allocation_;
-			other.allocation_ = VmaAllocation(nullptr);
+			if (cacheFile.is_open())
+			{
+				cacheFile.write((char*)chunk.data(), count * sizeof(Vertex));
+			}
+		}
 
-			device_ = other.device_;
+		vertexBuffer.commit(filename);
+		indexBuffer.add(filename, indices, vertexCount);
 
-			allocator_ = other.allocator_;
+		std::vector<MeshLod> lods;
+		if (options.lods > 0)
+		{
+			lods = SOULKAN_NAMESPACE::buildLods(positions, indices, options.lods, options.lodRatio, options.optimize ? options.vertexCacheSize : 0);
+			for (size_t lod = 1; lod <= lods.size(); lod++)
+			{
+				indexBuffer.add(lodName(filename, lod), lods[lod - 1].indices, vertexCount);
+			}
 		}
 
-		//No copy constructors
-		DepthImage(DepthImage& other) = delete;
-		DepthImage& operator=(DepthImage& other) = delete;
-
-		void destroy()
+		MeshletData meshlets = {};
+		if (options.meshlets)
 		{
-			if (destroyed_) { return; }
-			device_.get().vk().destroyImageView(view_);
-			vmaDestroyImage(allocator_.get().vma(), image_, allocation_);
-			destroyed_ = true;
+			meshlets = SOULKAN_NAMESPACE::buildMeshlets(positions, indices, options.maxMeshletVertices, options.maxMeshletTriangles);
+			vertexBuffer.addMeshlets(filename, meshlets.meshlets, meshlets.vertices, meshlets.triangles);
 		}
 
-		~DepthImage()
+		Mesh staged(filename, vertexCount, indices.size(), bounds, sphere);
+		for (const auto& lod : lods)
 		{
-			if (manual_) { return; }
-			destroy();
+			staged.lods_.push_back({ {}, lod.error });
 		}
+		staged.submeshes_ = std::move(submeshes);
+		staged.setNames(parser.shapes(), parser.materials(), parser.materialLibraries());
 
-		vk::Image image() const { return image_; }
-		vk::ImageView view() const { return view_; }
+		if (cacheFile.is_open())
+		{
+			cacheFile.write((char*)indices.data(), indices.size() * sizeof(uint32_t));
 
-	private:
-		vk::Image image_;
-		vk::ImageView view_;
-		VmaAllocation allocation_;
+			size_t lodIndexCount = 0;
+			for (const auto& lod : lods)
+			{
+				MeshLodInfo info = {};
+				info.indexCount = lod.indices.size();
+				info.error = lod.error;
+				cacheFile.write((char*)&info, sizeof(MeshLodInfo));
 
-		ref<Device> device_;
-		ref<Allocator> allocator_;
-	};
+				lodIndexCount += lod.indices.size();
+			}
+			for (const auto& lod : lods)
+			{
+				cacheFile.write((char*)lod.indices.data(), lod.indices.size() * sizeof(uint32_t));
+			}
+			cacheFile.write((char*)staged.submeshes_.data(), staged.submeshes_.size() * sizeof(Submesh));
+
+			cacheFile.write((char*)meshlets.meshlets.data(), meshlets.meshlets.size() * sizeof(Meshlet));
+			cacheFile.write((char*)meshlets.vertices.data(), meshlets.vertices.size() * sizeof(uint32_t));
+			cacheFile.write((char*)meshlets.triangles.data(), meshlets.triangles.size());
+
+			std::string names = staged.packNames();
+			cacheFile.write(names.data(), names.size());
+
+			MeshFileHeader header = {};
+			staged.fillSubmeshHeader(header, names.size());
+			header.vertexCount = vertexCount;
+			header.indexCount = indices.size();
+			header.bounds = bounds;
+			header.sphere = sphere;
+			if (options.meshlets)
+			{
+				header.maxMeshletVertices = options.maxMeshletVertices;
+				header.maxMeshletTriangles = options.maxMeshletTriangles;
+				header.meshletCount = meshlets.meshlets.size();
+				header.meshletVertexCount = meshlets.vertices.size();
+				header.meshletTriangleSize = meshlets.triangles.size();
+			}
+			if (options.lods > 0)
+			{
+				header.lodCount = static_cast<uint32_t>(lods.size());
+				header.requestedLodCount = options.lods;
+				header.lodRatio = options.lodRatio;
+				header.lodIndexCount = lodIndexCount;
+			}
+			if (options.optimize)
+			{
+				header.vertexCacheSize = options.vertexCacheSize;
+			}
 
-	//Copyable
-	//TODO:Should become vec3 position, vec3 normal, vec3 uv
-	struct Vertex
-	{
-		glm::vec3 position;
-		glm::vec3 normal;
-		glm::vec2 uv;
-	};
+			cacheFile.seekp(0);
+			cacheFile.write((char*)&header, sizeof(MeshFileHeader));
+			cacheFile.close();
 
-	//Non copyable movable
-	class Mesh
-	{
-	public:
-		Mesh()
-			: name_("Unknown")
-		{}
-		Mesh(std::string name, std::vector<Vertex> vertices)
-			: name_(name), vertices_(vertices)
-		{
-			
+			publishCache(tmpFilename, cacheFilename);
 		}
 
-		static Mesh objMesh(std::string filename)
+		return staged;
+	}
+
+	template<typename Layout>
+	Mesh Mesh::streamObjMesh(std::string filename, VertexBuffer<Layout>& vertexBuffer, IndexBuffer& indexBuffer, MeshStream& stream, size_t blockSize,
+		bool useCache)//Defined after IndexBuffer definition
+	{
+		std::string cacheFilename = filename + ".skmesh";
+
+		//INFO:Chunks stay small next to the staging buffer so that several of them are in flight while the renderer uploads
+		constexpr size_t chunkBytes = 1 << 20;
+		size_t chunkVertices = std::max<size_t>(1, chunkBytes / std::max(sizeof(Layout), sizeof(Vertex)));
+		size_t chunkIndices = chunkBytes / sizeof(uint32_t);
+
+		auto streamIndices = [&](std::span<const uint32_t> indices, size_t firstIndex)
+			{
+				for (size_t first = 0; first < indices.size(); first += chunkIndices)
+				{
+					size_t count = std::min(chunkIndices, indices.size() - first);
+					indexBuffer.addChunk(filename, indices.subspan(first, count), firstIndex + first);
+				}
+			};
+
+		if (useCache && cacheUpToDate(filename, cacheFilename))
 		{
-			tinyobj::ObjReaderConfig readerConfig;
+			Mesh mesh;
+			if (mesh.loadCache(filename, cacheFilename, {}))
+			{
+				vertexBuffer.allocate(filename, mesh.vertexCount() * sizeof(Layout));
+				indexBuffer.allocate(filename, mesh.indexCount() * sizeof(uint32_t));
+				stream.start(mesh.bounds());
 
-			tinyobj::ObjReader reader;
+				//Blocks of indices preceded by the vertices they reference
+				std::span<const Vertex> vertices = mesh.vertices();
+				std::span<const uint32_t> indices = mesh.indices();
+				size_t blockIndices = std::max<size_t>(3, blockSize / sizeof(uint32_t) / 3 * 3);
+				size_t vertexEnd = 0;
 
-			if (!reader.ParseFromFile(filename, readerConfig))
-			{
-				if (!reader.Error().empty())//An error occured
+				for (size_t firstIndex = 0; firstIndex < indices.size(); firstIndex += blockIndices)
 				{
-					std::string errorMessage = std::format("Killing process, error while parsing [{}]: {}", filename, reader.Error());
-					KILL(errorMessage);
+					std::span<const uint32_t> block = indices.subspan(firstIndex, std::min(blockIndices, indices.size() - firstIndex));
+
+					size_t blockVertexEnd = std::max<size_t>(vertexEnd, *std::max_element(block.begin(), block.end()) + 1);
+					for (size_t first = vertexEnd; first < blockVertexEnd; first += chunkVertices)
+					{
+						vertexBuffer.addChunk(filename, vertices.subspan(first, std::min(chunkVertices, blockVertexEnd - first)), mesh.bounds(), first);
+					}
+					vertexEnd = blockVertexEnd;
+
+					streamIndices(block, firstIndex);
+					stream.commitChunk(vertexEnd, firstIndex + block.size());
 				}
 
-				std::string errorMessage = std::format("Killing process, could not parse [{}]", filename);
-				KILL(errorMessage);
-			}
+				stream.finish(); //INFO:Vertices no index references are never streamed
 
-			if (!reader.Warning().empty())
-			{
-				std::string warningMessage = std::format("Warning while parsing [{}]: {}", filename, reader.Warning());
-				std::cout << warningMessage << std::endl;
+				Mesh streamed(filename, mesh.vertexCount(), mesh.indexCount(), mesh.bounds(), mesh.sphere());
+				streamed.submeshes_ = std::move(mesh.submeshes_);
+				streamed.setNames(std::move(mesh.shapes_), std::move(mesh.materials_), std::move(mesh.materialLibraries_));
+
+				return streamed;
 			}
 
-			auto& attrib = reader.GetAttrib();
-			auto& shapes = reader.GetShapes();
+			std::cout << std::format("Outdated or corrupted mesh cache [{}], parsing [{}] again", cacheFilename, filename) << std::endl;
+		}
 
-			std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		std::vector<tinyobj::index_t> uniqueCorners;
+		std::vector<uint32_t> table;
+		std::vector<Vertex> chunk(chunkVertices);
+		Bounds streamBounds = {};
 
-			for (size_t s = 0; s < shapes.size(); s++)//Looping over every shape in .obj
+		std::string tmpFilename = cacheFilename + ".tmp";
+		std::ofstream cacheFile;
+		if (useCache)
+		{
+			cacheFile.open(tmpFilename, std::ios::binary);
+
+			MeshFileHeader header = {};
+			cacheFile.write((char*)&header, sizeof(MeshFileHeader)); //Rewritten once counts and bounds are known
+		}
+
+		ObjParser parser(filename, blockSize, [&](ObjParser& parser, size_t firstCorner, size_t endCorner)
 			{
-				size_t indexOffset = 0;
-				for (size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++)//Looping over every face of current shape
+				//INFO:Every face corner may be a new vertex, elements are allocated for that worst case and shrunk once the mesh is complete
+				if (!stream.started())
+				{
+					vertexBuffer.allocate(filename, parser.corners().size() * sizeof(Layout));
+					indexBuffer.allocate(filename, parser.corners().size() * sizeof(uint32_t));
+
+					indices.reserve(parser.corners().size());
+					streamBounds = parser.bounds();
+					stream.start(streamBounds);
+				}
+
+				size_t firstVertex = uniqueCorners.size();
+				size_t firstIndex = indices.size();
+				appendUniqueVertices(filename, parser.positions(), std::span(parser.corners()).subspan(firstCorner, endCorner - firstCorner), indices, uniqueCorners, table);
+
+				for (size_t first = firstVertex; first < uniqueCorners.size(); first += chunkVertices)
 				{
-					size_t faceVertices = static_cast<size_t>(shapes[s].mesh.num_face_vertices[f]);
+					size_t count = std::min(chunkVertices, uniqueCorners.size() - first);
+					writeVertices(parser.positions(), parser.normals(), parser.uvs(), std::span(uniqueCorners).subspan(first, count), chunk.data());
+
+					vertexBuffer.addChunk(filename, std::span(chunk).first(count), streamBounds, first);
 
-					for (size_t v = 0; v < faceVertices; v++)//Looping over every vertex in the face
+					if (cacheFile.is_open())
 					{
-						Vertex vertex;
+						cacheFile.write((char*)chunk.data(), count * sizeof(Vertex));
+					}
+				}
 
-						tinyobj::index_t index = shapes[s].mesh.indices[indexOffset + v];
+				streamIndices(std::span(indices).subspan(firstIndex), firstIndex);
+				stream.commitChunk(uniqueCorners.size(), indices.size());
+			}, Layout::boundsRelative);
 
-						tinyobj::real_t vx = attrib.vertices[3 * index.vertex_index + 0];
-						tinyobj::real_t vy = attrib.vertices[3 * index.vertex_index + 1];
-						tinyobj::real_t vz = attrib.vertices[3 * index.vertex_index + 2];
+		size_t vertexCount = uniqueCorners.size();
+		vertexBuffer.shrink(filename, vertexCount * sizeof(Layout));
+		indexBuffer.shrink(filename, indices.size() * sizeof(uint32_t));
+		stream.finish();
 
-						vertex.position.x = vx;
-						vertex.position.y = vy;
-						vertex.position.z = vz;
+		Bounds bounds = positionBounds(parser.positions(), uniqueCorners);
+		BoundingSphere sphere = positionSphere(parser.positions(), uniqueCorners, bounds);
 
-						if (index.normal_index >= 0) //Is there normal data
-						{
-							tinyobj::real_t nx = attrib.normals[3 * index.normal_index + 0];
-							tinyobj::real_t ny = attrib.normals[3 * index.normal_index + 1];
-							tinyobj::real_t nz = attrib.normals[3 * index.normal_index + 2];
+		//INFO:Vertices were encoded relative to the bounds of the whole file, decodeMatrix must use the same ones
+		Mesh streamed(filename, vertexCount, indices.size(), Layout::boundsRelative ? streamBounds : bounds, sphere);
 
-							vertex.normal.x = nx;
-							vertex.normal.y = ny;
-							vertex.normal.z = nz;
-						}
+		//INFO:Indices are already uploaded, runs split in the file stay separate submeshes
+		streamed.submeshes_ = groupSubmeshes(parser.groups(), indices, false, parser.positions().data(), parser.positions().size(),
+			[&](uint32_t v) { return 3 * static_cast<size_t>(uniqueCorners[v].vertex_index); });
+		streamed.setNames(parser.shapes(), parser.materials(), parser.materialLibraries());
 
-						if (index.texcoord_index >= 0)
-						{
-							tinyobj::real_t ux = attrib.texcoords[2 * index.texcoord_index + 0];
-							tinyobj::real_t uy = attrib.texcoords[2 * index.texcoord_index + 1];
+		if (cacheFile.is_open())
+		{
+			cacheFile.write((char*)indices.data(), indices.size() * sizeof(uint32_t));
+			cacheFile.write((char*)streamed.submeshes_.data(), streamed.submeshes_.size() * sizeof(Submesh));
 
-							vertex.uv.x = ux;
-							vertex.uv.y = uy;
-						}
+			std::string names = streamed.packNames();
+			cacheFile.write(names.data(), names.size());
 
-						vertices.push_back(vertex);
-					}
+			MeshFileHeader header = {};
+			streamed.fillSubmeshHeader(header, names.size());
+			header.vertexCount = vertexCount;
+			header.indexCount = indices.size();
+			header.bounds = bounds;
+			header.sphere = sphere;
 
-					indexOffset += faceVertices;
-				}
-			}
+			cacheFile.seekp(0);
+			cacheFile.write((char*)&header, sizeof(MeshFileHeader));
+			cacheFile.close();
 
-			return Mesh(filename, vertices);
+			publishCache(tmpFilename, cacheFilename);
 		}
 
-		std::string name()
-		{
-			return name_;
-		}
+		return streamed;
+	}
 
-		size_t vertexCount()
-		{
-			return vertices_.size();
-		}
+	class MatrixBuffer : public LocalBuffer
+	{
+	public:
+		MatrixBuffer(ref<Device> device, ref<Allocator> allocator, vk::DeviceSize localSize, vk::DeviceSize stagingSize = 10'000'000, MemoryPool pool = MemoryPool::GEOMETRY) :
+			LocalBuffer(device, allocator, localSize, stagingSize, {}, sizeof(glm::mat4), MemoryTag::MATRIX, pool) {}
 
-		vk::DeviceSize size()
+		//vertexMode = true -> (vertex offset, vertex count) will be returned
+		//When set to false, (real offset, real count) will be returned (in bytes)
+		std::pair<vk::DeviceSize, vk::DeviceSize> matrix(std::string name, bool matrixMode = true)
 		{
-			return vertices_.size() * sizeof(Vertex);
+			return matrix(handle(name), matrixMode);
 		}
 
-		void* data()
+		std::pair<vk::DeviceSize, vk::DeviceSize> matrix(ElementHandle handle, bool matrixMode = true)
 		{
-			return vertices_.data();
+			auto trueOffsetSize = element(handle);
+			return (matrixMode ? std::make_pair(trueOffsetSize.first / sizeof(glm::mat4), trueOffsetSize.second / sizeof(glm::mat4)) : trueOffsetSize);
 		}
 	private:
-		std::string name_;
-		std::vector<Vertex> vertices_;
+
 	};
-	
-	//Small mappable buffer
+
+	//Matrices rewritten every frame, written in place in persistently mapped memory, without staging, transfer or fence
+	//INFO:One slice of matrixCount matrices per frame in flight, beginFrame moving to the next one. A slice must not be written while a frame
+	//reading it is still running, framesInFlight being one more than the frames the renderer lets run ahead of the device
+	//Matrix views are indices inside a slice, the shader reading them from sliceAddress
 	//Non copyable movable
-	//TODO:Use prefer cpu ram to make sure staging is on system memory
-	class StagingBuffer : public Buffer
+	class DynamicMatrixBuffer : public Buffer
 	{
 	public:
-		StagingBuffer(ref<Device> device, ref<Allocator> allocator, vk::DeviceSize size, bool systemMemory = false)
-			: Buffer(device, allocator, (vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc), size, true, systemMemory), //Staging buffer should not be bigger than 200MB if on DEVICE_LOCAL memory
-			  size_(size)
+		DynamicMatrixBuffer(ref<Device> device, ref<Allocator> allocator, size_t matrixCount, size_t framesInFlight = 2, MemoryPool pool = MemoryPool::FRAME) :
+			Buffer(device, allocator, vk::BufferUsageFlagBits::eStorageBuffer, std::max<size_t>(1, matrixCount * framesInFlight) * sizeof(glm::mat4), true, false, true, MemoryTag::MATRIX, pool),
+			matrixCount_(matrixCount), framesInFlight_(std::max<size_t>(1, framesInFlight))
 		{}
 
-		vk::DeviceSize size()
+		//Moves to the slice of the next frame, returning its index
+		size_t beginFrame()
 		{
-			return size_;
+			frame_ = (frame_ + 1) % framesInFlight_;
+			return frame_;
 		}
-	private:
-		vk::DeviceSize size_;
-	};
 
-	//ALEX:would be better to copy to staging in one go and then copying everything to the gpu in one go
-	//instead of copying and waiting and copying .
-	//Non copyable movable
-	class LocalBuffer : public Buffer //TODO:Protected upload so end user cannot directly call VertexBuffer.upload() and mess things up
-	{
-	public:
-		LocalBuffer(ref<Device> device, ref<Allocator> allocator, vk::DeviceSize localSize, vk::DeviceSize stagingSize = 10'000'000) :
-			Buffer(device, allocator, (vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst), localSize),
-			stagingBuffer_(device, allocator, stagingSize),
-			transferPool_(device, device.get().queueIndex(QueueFamilyCapability::TRANSFER)),
-			transferCommandBuffer_(transferPool_.allocate()),
-			transferFence_(device),
-			transferQueue_(device.get().queue(QueueFamilyCapability::TRANSFER, 0))
+		void write(size_t index, const glm::mat4& matrix)
 		{
-			voids_[0] = localSize;//Whole buffer is free when first created
+			if (index >= matrixCount_)
+			{
+				KILL(std::format("Writing matrix {} of a dynamic matrix buffer holding {} per frame", index, matrixCount_));
+			}
+
+			matrices()[index] = matrix;
 		}
 
-		//Adds and uploads mesh to staging
-		//TODO:Proper return, pair or return code
-		void add(std::string name, void* data, size_t size)
+		//Matrices of the current slice, to be written sequentially and never read back (the memory may be write combined)
+		glm::mat4* matrices()
 		{
-			//Find space in staging
-			if (stagingVoidStart_ + size > stagingBuffer_.size()) //Not enough space
-			{
-				KILL(std::format("Not enough space in staging buffer (size = {} bytes) when trying to add following object: {} of size {} bytes", stagingBuffer_.size(), name, size));
-			}
+			return static_cast<glm::mat4*>(mapped()) + frame_ * matrixCount_;
+		}
 
-			//Upload to staging
-			stagingBuffer_.upload(data, size, stagingVoidStart_);
-			toBeUploaded_[name] = std::make_pair(stagingVoidStart_, size);
+		//Makes the writes to the current slice visible to the device, only does something when the memory is not host coherent
+		void flush()
+		{
+			VK_CHECK(vk::Result(vmaFlushAllocation(allocator_.get().vma(), allocation_, frame_ * sliceSize(), sliceSize())));
+		}
 
-			stagingVoidStart_ += size;
+		vk::DeviceAddress sliceAddress()
+		{
+			return address() + frame_ * sliceSize();
 		}
 
-		void upload(bool overwriting = false)
+		size_t matrixCount()
 		{
-			//Wait for potential previous upload to have properly finished 
-			device_.get().waitFence(transferFence_);
-			device_.get().resetFence(transferFence_);
+			return matrixCount_;
+		}
 
-			std::vector<vk::BufferCopy2> copyRegions = {};
-			//Looping over every to be uploaded mesh
-			for (auto& [key, val] : toBeUploaded_)
-			{
-				//Find space in buffer
-				bool elementPresent = elements_.find(key) != elements_.end();
-				if (elementPresent && !overwriting) //Element already present + we don't overwrite
-				{
-					continue;
-				}
+		size_t frame()
+		{
+			return frame_;
+		}
+	private:
+		size_t matrixCount_ = 0;
+		size_t framesInFlight_ = 1;
+		size_t frame_ = 0;
 
-				uint64_t selectedOffset = overwriting ? elements_[key].first : firstBufferVoid(val.second);
-				if (selectedOffset == std::numeric_limits<uint64_t>::max())
-				{
-					KILL(std::format("Not enough space in local buffer for following mesh : {} of size {}", key, val.second));
-				}
+		vk::DeviceSize sliceSize()
+		{
+			return matrixCount_ * sizeof(glm::mat4);
+		}
+	};
 
-				//Adding copy region from staging to buffer
-				vk::BufferCopy2 copyRegion = {};
-				copyRegion.srcOffset = val.first;
-				copyRegion.dstOffset = selectedOffset;
-				copyRegion.size = val.second;
+	template<typename Layout>
+	GlbScene Mesh::glbScene(std::string filename, VertexBuffer<Layout>& vertexBuffer, IndexBuffer& indexBuffer, MatrixBuffer& matrixBuffer)//Defined after MatrixBuffer definition
+	{
+		GlbParser parser(filename);
+		GlbScene scene;
 
-				copyRegions.push_back(copyRegion);
+		std::map<size_t, std::vector<size_t>> meshPrimitives; //glTF mesh -> indices in scene.meshes
+		std::vector<Vertex> chunk;
+		std::vector<uint32_t> indices;
 
-				//Updating meshes and voids if element is new 
-				if (!elementPresent)
-				{
-					elements_[key] = std::make_pair(selectedOffset, val.second);
+		for (const auto& primitive : parser.primitives())
+		{
+			std::string name = glbMeshName(filename, primitive.mesh, primitive.primitive);
 
-					vk::DeviceSize freeSpaceAtOffset = voids_[selectedOffset];
-					voids_.erase(selectedOffset);
-					voids_[selectedOffset + val.second] = freeSpaceAtOffset - val.second;
-				}
+			GlbAccessor positions = parser.accessor(primitive.position);
+			if (positions.componentType != GlbAccessor::FLOAT || positions.componentCount != 3)
+			{
+				KILL(std::format("Positions of [{}] must be float vec3", name));
 			}
 
-			toBeUploaded_.clear();
+			GlbAccessor normals = (primitive.normal >= 0) ? parser.accessor(primitive.normal) : GlbAccessor{};
+			GlbAccessor uvs = (primitive.uv >= 0) ? parser.accessor(primitive.uv) : GlbAccessor{};
+			size_t vertexCount = positions.count;
 
-			//Upload to buffer
-			device_.get().vk().resetCommandPool(transferPool_.vk());
+			if (vertexCount == 0 || (normals.data != nullptr && normals.count != vertexCount) || (uvs.data != nullptr && uvs.count != vertexCount))
+			{
+				KILL(std::format("Attributes of [{}] are empty or do not have the same count", name));
+			}
 
-			//Actual copy command
-			transferCommandBuffer_.begin();
+			//Bounds straight from the binary chunk, before anything gets encoded
+			const float* base = reinterpret_cast<const float*>(positions.data);
+			size_t floatStride = positions.stride / sizeof(float);
+			size_t floatCount = (vertexCount - 1) * floatStride + 3;
+			Bounds bounds = pointBounds(base, floatCount, vertexCount, [=](size_t i) { return i * floatStride; });
+			BoundingSphere sphere = pointSphere(base, floatCount, vertexCount, [=](size_t i) { return i * floatStride; }, bounds);
 
-			vk::CopyBufferInfo2 bufferCopy = {};
-			bufferCopy.srcBuffer = stagingBuffer_.vk();
-			bufferCopy.dstBuffer = buffer_;
-			bufferCopy.regionCount = copyRegions.size();
+			Layout* stagingVertices = static_cast<Layout*>(vertexBuffer.reserve(name, vertexCount * sizeof(Layout)));
 
-			bufferCopy.pRegions = copyRegions.data();
+			//INFO:Attributes already interleaved as Vertex (one buffer view, stride 32, normal and uv right after the position) are copied as is
+			bool interleaved = std::is_same_v<Layout, Vertex> && normals.data != nullptr && uvs.data != nullptr &&
+				positions.stride == sizeof(Vertex) && normals.stride == sizeof(Vertex) && uvs.stride == sizeof(Vertex) &&
+				normals.componentType == GlbAccessor::FLOAT && uvs.componentType == GlbAccessor::FLOAT &&
+				normals.data == positions.data + offsetof(Vertex, normal) && uvs.data == positions.data + offsetof(Vertex, uv);
 
-			transferCommandBuffer_.vk().copyBuffer2(&bufferCopy);
+			if (interleaved)
+			{
+				memcpy(stagingVertices, positions.data, vertexCount * sizeof(Vertex));
+				flipGlbUvs(reinterpret_cast<Vertex*>(stagingVertices), vertexCount);
+			}
+			else if constexpr (std::is_same_v<Layout, Vertex>)
+			{
+				writeGlbVertices(positions, normals, uvs, 0, vertexCount, stagingVertices);
+			}
+			else
+			{
+				//Chunks stay in cache between gathering and encoding
+				constexpr size_t chunkSize = 4096;
+				chunk.resize(chunkSize);
 
-			//Barrier after write to ensure no two writes are being done concurrently + reads are executed after the whole write is done
-			vk::MemoryBarrier2 barrier = {};
-			barrier.srcStageMask = vk::PipelineStageFlagBits2::eTransfer;
-			barrier.srcAccessMask = vk::AccessFlagBits2::eTransferWrite;
+				for (size_t first = 0; first < vertexCount; first += chunkSize)
+				{
+					size_t count = std::min(chunkSize, vertexCount - first);
+					writeGlbVertices(positions, normals, uvs, first, count, chunk.data());
+					vertexBuffer.encode(std::span(chunk).first(count), bounds, stagingVertices + first);
+				}
+			}
+			vertexBuffer.commit(name);
 
-			barrier.dstStageMask = vk::PipelineStageFlagBits2::eAllCommands;
-			barrier.dstAccessMask = vk::AccessFlagBits2::eMemoryRead;
+			//Indices, 16 and 32 bit ones without gaps are read in place
+			size_t indexCount = vertexCount;
+			if (primitive.indices >= 0)
+			{
+				GlbAccessor indexAccessor = parser.accessor(primitive.indices);
+				indexCount = indexAccessor.count;
 
-			vk::DependencyInfo dependency = {};
-			dependency.memoryBarrierCount = 1;
-			dependency.pMemoryBarriers = &barrier;
+				uint32_t maxIndex = 0;
+				for (size_t i = 0; i < indexCount; i++) { maxIndex = std::max(maxIndex, indexAccessor.index(i)); }
+				if (indexCount > 0 && maxIndex >= vertexCount) { KILL(std::format("Indices of [{}] reference missing vertices", name)); }
 
-			transferCommandBuffer_.vk().pipelineBarrier2(&dependency);
+				bool aligned = reinterpret_cast<uintptr_t>(indexAccessor.data) % GlbAccessor::componentSize(indexAccessor.componentType) == 0;
+				if (aligned && indexAccessor.componentType == GlbAccessor::UNSIGNED_SHORT && indexAccessor.stride == sizeof(uint16_t))
+				{
+					indexBuffer.add(name, std::span(reinterpret_cast<const uint16_t*>(indexAccessor.data), indexCount));
+				}
+				else if (aligned && indexAccessor.componentType == GlbAccessor::UNSIGNED_INT && indexAccessor.stride == sizeof(uint32_t))
+				{
+					indexBuffer.add(name, std::span(reinterpret_cast<const uint32_t*>(indexAccessor.data), indexCount), vertexCount);
+				}
+				else
+				{
+					indices.resize(indexCount);
+					for (size_t i = 0; i < indexCount; i++) { indices[i] = indexAccessor.index(i); }
+					indexBuffer.add(name, indices, vertexCount);
+				}
+			}
+			else
+			{
+				//Non indexed triangle list
+				indices.resize(vertexCount);
+				std::iota(indices.begin(), indices.end(), 0);
+				indexBuffer.add(name, indices, vertexCount);
+			}
 
-			transferCommandBuffer_.end();
+			meshPrimitives[primitive.mesh].push_back(scene.meshes.size());
+			scene.meshes.push_back(Mesh(name, vertexCount, indexCount, bounds, sphere));
+			scene.materials.push_back(primitive.material);
+		}
 
-			transferQueue_.submit(transferCommandBuffer_, transferFence_);
+		//One matrix per node, shared by the instances of its primitives
+		for (const auto& node : parser.nodes())
+		{
+			ElementHandle matrix = matrixBuffer.add(glbNodeName(filename, node.node), &node.world, sizeof(glm::mat4));
 
-			stagingVoidStart_ = 0; //Staging buffer can be filled up from the start again
+			for (size_t mesh : meshPrimitives[node.mesh])
+			{
+				scene.instances.push_back({ node.name, mesh, matrix, node.world });
+			}
 		}
 
-		void remove(std::string name)
+		return scene;
+	}
+
+	//Copyable movable
+	//TODO:Boolean indicating if offset and size are in bytes or vertex mode
+	class BufferView
+	{
+	public:
+		BufferView(ref<Buffer> buffer, vk::DeviceSize offset, vk::DeviceSize size) :
+			buffer_(buffer), offset_(offset), size_(size) {}
+
+		BufferView(ref<Buffer> buffer, std::pair<vk::DeviceSize, vk::DeviceSize> offsetSize) :
+			buffer_(buffer), offset_(offsetSize.first), size_(offsetSize.second) {}
+
+		vk::DeviceSize offset()
 		{
-			vk::DeviceSize elementOffset = elements_[name].first;
-			vk::DeviceSize elementSize = elements_[name].second;
+			return offset_;
+		}
 
-			//In case a void follows the one we're going to create
-			//TODO:Do it for a void before this one
-			voids_[elementOffset] = elementSize;
-			if (voids_.find(elementOffset + elementSize) != voids_.end()) //Found
-			{
-				vk::DeviceSize extra = voids_[elementOffset + elementSize];
+		vk::DeviceSize size()
+		{
+			return size_;
+		}
 
-				voids_[elementOffset] = elementSize + extra;
-			}
+		//View over the first size units of this one
+		BufferView first(vk::DeviceSize size)
+		{
+			return BufferView(buffer_, offset_, std::min(size_, size));
 		}
 
-		vk::DeviceAddress address()
+		//View over size units starting offset units into this one
+		BufferView range(vk::DeviceSize offset, vk::DeviceSize size)
 		{
-			return Buffer::address();
+			offset = std::min(offset, size_);
+			return BufferView(buffer_, offset_ + offset, std::min(size_ - offset, size));
 		}
 
+		//Follows an element of its buffer moved by LocalBuffer::defragment, unit being the size in bytes of the units of the view
+		void relocate(const LocalBuffer::ElementMove& move, vk::DeviceSize unit)
+		{
+			vk::DeviceSize byteOffset = offset_ * unit;
+			if (&buffer_.get() != move.buffer || byteOffset < move.from || byteOffset >= move.from + move.size) { return; }
 
-		//Size of total freeSpace
-		vk::DeviceSize voidSize()
+			offset_ = (byteOffset - move.from + move.to) / unit;
+		}
+	private:
+		ref<Buffer> buffer_;
+		vk::DeviceSize offset_;
+		vk::DeviceSize size_;
+	};
+
+	class Camera;
+
+	class MeshInstance
+	{
+	public:
+		MeshInstance(std::string name, BufferView meshView, BufferView indexView, vk::IndexType indexType, BufferView matrixView) :
+			name_(name), meshView_(meshView), lods_{ std::make_pair(indexView, 0.f) }, indexType_(indexType), matrixView_(matrixView)
+		{}
+
+		std::string name()
 		{
-			vk::DeviceSize total = 0;
+			return name_;
+		}
 
-			for (auto& v : voids_)
-			{
-				total += v.second;
-			}
 
-			return total;
+		BufferView meshView()
+		{
+			return meshView_;
 		}
 
-		vk::DeviceSize stagingVoidSize()
+		//Index view of the selected level of detail
+		BufferView indexView()
 		{
-			return stagingBuffer_.size() - stagingVoidStart_;
+			BufferView view = lods_[lod_].first;
+			return view.first(indexCount_);
 		}
 
-	protected:
-		//Elements located inside the device local buffer
-		//["Monkey"] = (0, 1024) meaning that a mesh called monkey is located at offset 0 of the buffer and is of size 1024
-		std::map<std::string, std::pair<vk::DeviceSize, vk::DeviceSize>> elements_{};
+		vk::IndexType indexType()
+		{
+			return indexType_;
+		}
 
-		//Free spaces, key being offset in buffer and value being size of free space starting at key
-		std::map<vk::DeviceSize, vk::DeviceSize> voids_{};
+		BufferView matrixView()
+		{
+			return matrixView_;
+		}
 
-		//Offset of the first free space in the stagingBuffer
-		vk::DeviceSize stagingVoidStart_ = 0;
+		//Coarser index view over the same vertices, levels being added from finest to coarsest with their error in mesh space (see Mesh::lodError)
+		void addLod(BufferView indexView, float error)
+		{
+			lods_.push_back(std::make_pair(indexView, error));
+		}
 
-		//Meshes to be uploaded, awaiting transfer from staging to local
-		std::map<std::string, std::pair<vk::DeviceSize, vk::DeviceSize>> toBeUploaded_{};
+		//Selects the coarsest level whose error, projected at the distance between the camera and position (world space center of the instance),
+		//stays under maxPixelError pixels, scale being the largest scale of the model matrix
+		void selectLod(Camera& camera, glm::vec3 position, float scale = 1.f, float maxPixelError = 1.f); //Defined after Camera definition
 
-		StagingBuffer stagingBuffer_;
+		size_t lod()
+		{
+			return lod_;
+		}
 
-		CommandPool transferPool_;
-		CommandBuffer transferCommandBuffer_;
-		Fence transferFence_;
-		Queue transferQueue_;
+		//Draws only the first indexCount indices, for a mesh still streaming (see MeshStream::drawableIndexCount)
+		void setIndexCount(vk::DeviceSize indexCount = std::numeric_limits<vk::DeviceSize>::max())
+		{
+			indexCount_ = indexCount;
+		}
 
-		vk::DeviceSize firstBufferVoid(vk::DeviceSize meshSize)
+		//Mesh space bounding volumes of the instanced mesh, see Mesh::bounds and Mesh::sphere
+		void setBounds(Bounds bounds, BoundingSphere sphere)
 		{
-			uint64_t selectedOffset = std::numeric_limits<uint64_t>::max();
+			bounds_ = bounds;
+			sphere_ = sphere;
+			worldBounds_ = bounds;
+			worldSphere_ = sphere;
+		}
 
-			for (auto& [key, val] : voids_)
+		//Follows an element moved by LocalBuffer::defragment, vertexSize being the size of the vertex layout of the mesh view
+		void relocate(const LocalBuffer::ElementMove& move, vk::DeviceSize vertexSize)
+		{
+			meshView_.relocate(move, vertexSize);
+			for (auto& lod : lods_)
 			{
-				if (val > meshSize)//Enough space to store mesh at offset key
-				{
-					return key;
-					break;
-				}
+				lod.first.relocate(move, (indexType_ == vk::IndexType::eUint16) ? sizeof(uint16_t) : sizeof(uint32_t));
 			}
-
-			return selectedOffset;
+			matrixView_.relocate(move, sizeof(glm::mat4));
 		}
-	};
-	
-	//Big buffer holding lots of vertices in device_local memory
-	class VertexBuffer : public LocalBuffer
-	{
-	public:
-		VertexBuffer(ref<Device> device, ref<Allocator> allocator, vk::DeviceSize localSize, vk::DeviceSize stagingSize = 10'000'000) :
-			LocalBuffer(device, allocator, localSize, stagingSize) {}
 
-		//vertexMode = true -> (vertex offset, vertex count) will be returned
-		//When set to false, (real offset, real count) will be returned (in bytes)
-		std::pair<vk::DeviceSize, vk::DeviceSize> mesh(std::string name, bool vertexMode = true)
+		//Mesh space submeshes of the full level, see Mesh::submeshes
+		void setSubmeshes(std::span<const Submesh> submeshes)
 		{
-			auto trueOffsetSize = elements_[name];
-			return (vertexMode ? std::make_pair(trueOffsetSize.first / sizeof(Vertex), trueOffsetSize.second / sizeof(Vertex)) : trueOffsetSize);
+			submeshes_.assign(submeshes.begin(), submeshes.end());
+			submeshSpheres_.clear();
+			for (const auto& submesh : submeshes_) { submeshSpheres_.push_back(submesh.sphere.transformed(model_)); }
 		}
-	private:
 
-	};
+		//Updates the world space bounding volumes from the model matrix of the instance
+		void setModel(const glm::mat4& model)
+		{
+			model_ = model;
+			worldBounds_ = bounds_.transformed(model);
+			worldSphere_ = sphere_.transformed(model);
+			for (size_t s = 0; s < submeshes_.size(); s++) { submeshSpheres_[s] = submeshes_[s].sphere.transformed(model); }
+		}
 
-	class MatrixBuffer : public LocalBuffer
-	{
-	public:
-		MatrixBuffer(ref<Device> device, ref<Allocator> allocator, vk::DeviceSize localSize, vk::DeviceSize stagingSize = 10'000'000) :
-			LocalBuffer(device, allocator, localSize, stagingSize) {}
+		//Part of the instance drawn with a single material, see draws
+		struct DrawRange
+		{
+			BufferView indexView;
+			int32_t material = -1; //Index in Mesh::materials, -1 without material
+		};
 
-		//vertexMode = true -> (vertex offset, vertex count) will be returned
-		//When set to false, (real offset, real count) will be returned (in bytes)
-		std::pair<vk::DeviceSize, vk::DeviceSize> matrix(std::string name, bool matrixMode = true)
+		//Index views to draw for a world space frustum (see Camera::frustum), empty when the whole instance is outside
+		//Submeshes outside the frustum are skipped and the rest is sorted by material so that bindings change once per material
+		//INFO:Submeshes only exist for the full level, other levels and meshes still streaming are drawn whole
+		std::vector<DrawRange> draws(const Frustum& frustum)
 		{
-			auto trueOffsetSize = elements_[name];
-			return (matrixMode ? std::make_pair(trueOffsetSize.first / sizeof(glm::mat4), trueOffsetSize.second / sizeof(glm::mat4)) : trueOffsetSize);
-		}
-	private:
+			if (!bounds_.empty() && !frustum.intersects(worldSphere_)) { return {}; }
 
-	};
+			if (submeshes_.empty() || lod_ != 0 || indexCount_ != std::numeric_limits<vk::DeviceSize>::max())
+			{
+				return { DrawRange{ indexView(), -1 } };
+			}
 
-	//Copyable movable
-	//TODO:Boolean indicating if offset and size are in bytes or vertex mode
-	class BufferView
-	{
-	public:
-		BufferView(ref<Buffer> buffer, vk::DeviceSize offset, vk::DeviceSize size) :
-			buffer_(buffer), offset_(offset), size_(size) {}
+			std::vector<DrawRange> draws;
+			for (size_t s = 0; s < submeshes_.size(); s++)
+			{
+				if (!frustum.intersects(submeshSpheres_[s])) { continue; }
 
-		BufferView(ref<Buffer> buffer, std::pair<vk::DeviceSize, vk::DeviceSize> offsetSize) :
-			buffer_(buffer), offset_(offsetSize.first), size_(offsetSize.second) {}
+				draws.push_back(DrawRange{ lods_[0].first.range(submeshes_[s].firstIndex, submeshes_[s].indexCount), submeshes_[s].material });
+			}
 
-		vk::DeviceSize offset()
-		{
-			return offset_;
-		}
+			std::stable_sort(draws.begin(), draws.end(), [](const DrawRange& a, const DrawRange& b) { return a.material < b.material; });
 
-		vk::DeviceSize size()
-		{
-			return size_;
+			return draws;
 		}
-	private:
-		ref<Buffer> buffer_;
-		vk::DeviceSize offset_;
-		vk::DeviceSize size_;
-	};
-
-	class MeshInstance
-	{
-	public:
-		MeshInstance(std::string name, BufferView meshView, BufferView matrixView) :
-			name_(name), meshView_(meshView), matrixView_(matrixView)
-		{}
 
-		std::string name()
+		Bounds worldBounds()
 		{
-			return name_;
+			return worldBounds_;
 		}
 
-
-		BufferView meshView()
+		BoundingSphere worldSphere()
 		{
-			return meshView_;
+			return worldSphere_;
 		}
 
-		BufferView matrixView()
+		glm::mat4 model()
 		{
-			return matrixView_;
+			return model_;
 		}
 	private:
 		std::string name_;
 		BufferView meshView_;
+		std::vector<std::pair<BufferView, float>> lods_; //(index view, error) of every level of detail, level 0 being the full mesh
+		size_t lod_ = 0;
+		vk::DeviceSize indexCount_ = std::numeric_limits<vk::DeviceSize>::max();
+		Bounds bounds_ = {};
+		BoundingSphere sphere_ = {};
+		Bounds worldBounds_ = {};
+		BoundingSphere worldSphere_ = {};
+		glm::mat4 model_{ 1.f };
+		std::vector<Submesh> submeshes_{};
+		std::vector<BoundingSphere> submeshSpheres_{}; //World space
+		vk::IndexType indexType_;
 		BufferView matrixView_;
 	};
 
@@ -2834,7 +9888,7 @@ namespace SOULKAN_NAMESPACE
 			
 			destroyed_ = true; //No need to destroy here, no image has been created
 		}
-		Image(ref<Device> device, ref<Allocator> allocator, std::string filename, vk::Flags<vk::ImageUsageFlagBits> usage)
+		Image(ref<Device> device, ref<Allocator> allocator, std::string filename, vk::Flags<vk::ImageUsageFlagBits> usage, MemoryPool pool = MemoryPool::TEXTURE)
 			: allocator_(allocator)
 		{
 			//Loading
@@ -2851,9 +9905,9 @@ namespace SOULKAN_NAMESPACE
 
 			vk::Format imageFormat = vk::Format::eR8G8B8A8Srgb;
 
-			StagingBuffer staging(device, allocator, imageSize, true);
+			staging_ = std::make_unique<StagingBuffer>(device, allocator, imageSize, true);
 
-			staging.upload(pixels, imageSize);
+			staging_->upload(pixels, imageSize);
 
 			stbi_image_free(pixels);
 
@@ -2883,59 +9937,22 @@ namespace SOULKAN_NAMESPACE
 
 			VmaAllocationCreateInfo allocationCreateInfo = {};
 			allocationCreateInfo.usage = VMA_MEMORY_USAGE_AUTO; //TODO:Should be GPU preferred
+			allocationCreateInfo.pool = allocator.get().pool(pool, vkImageCreateInfo, allocationCreateInfo);
 
 			VkImage vkImage;
 
-			vmaCreateImage(allocator.get().vma(), &vkImageCreateInfo, &allocationCreateInfo, &vkImage, &allocation_, nullptr);
+			VK_CHECK(vk::Result(vmaCreateImage(allocator.get().vma(), &vkImageCreateInfo, &allocationCreateInfo, &vkImage, &allocation_, nullptr)));
 
 			image_ = vk::Image(vkImage);
+			allocator.get().track(MemoryTag::IMAGE, allocation_);
 
-			//Converting to copy reading layout
-			CommandPool graphicsCommandPool(device, device.get().queueIndex(QueueFamilyCapability::GRAPHICS));
-			CommandBuffer graphicsCommandBuffer = graphicsCommandPool.allocate();
-
-			Fence fence(device);
-			device.get().waitFence(fence);
-			device.get().resetFence(fence);
-
-			Queue graphicsQueue = device.get().queue(QueueFamilyCapability::GRAPHICS, 0);//TODO:Hardcoded queue index, should change later, currently 0 is used for local buffers and this
-
-			graphicsCommandBuffer.begin();
-
-			graphicsCommandBuffer.imageLayoutTransition(vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, image_,
-														vk::PipelineStageFlagBits2::eNone, vk::AccessFlagBits2::eNone,
-															vk::PipelineStageFlagBits2::eTransfer, vk::AccessFlagBits2::eTransferWrite);
-
-			vk::BufferImageCopy2 copyRegion = {};
-			copyRegion.bufferOffset = 0;
-			copyRegion.bufferRowLength = 0;
-			copyRegion.bufferImageHeight = 0;
-
-			copyRegion.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-			copyRegion.imageSubresource.mipLevel = 0;
-			copyRegion.imageSubresource.baseArrayLayer = 0;
-			copyRegion.imageSubresource.layerCount = 1;
-			copyRegion.imageExtent = imageExtent;
-
-			vk::CopyBufferToImageInfo2 copy = {};
-			copy.regionCount = 1;
-			copy.pRegions = &copyRegion;
-			copy.srcBuffer = staging.vk();
-			copy.dstImage = image_;
-			copy.dstImageLayout = vk::ImageLayout::eTransferDstOptimal;
-
-			graphicsCommandBuffer.vk().copyBufferToImage2(&copy);
-
-			graphicsCommandBuffer.imageLayoutTransition(vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, image_,
-				vk::PipelineStageFlagBits2::eTransfer, vk::AccessFlagBits2::eTransferWrite,
-				vk::PipelineStageFlagBits2::eFragmentShader, vk::AccessFlagBits2::eShaderRead);
-
-			graphicsCommandBuffer.end();
-			graphicsQueue.submit(graphicsCommandBuffer, fence);
-
+			//Copied and transitioned to a sampling layout by the next batch of the upload scheduler, staging being kept until then
+			uploads_ = &device.get().uploads();
+			uploadValue_ = uploads_->copyImage(staging_->vk(), image_, imageExtent);
 		}
 
-		Image(Image&& other) noexcept : image_(other.image_), allocator_(other.allocator_), allocation_(other.allocation_)
+		Image(Image&& other) noexcept : image_(other.image_), allocator_(other.allocator_), allocation_(other.allocation_),
+			staging_(std::move(other.staging_)), uploads_(other.uploads_), uploadValue_(other.uploadValue_)
 		{
 			other.image_ = vk::Image(nullptr);
 			other.allocation_ = VmaAllocation(nullptr);
@@ -2951,6 +9968,10 @@ namespace SOULKAN_NAMESPACE
 			allocator_ = other.allocator_;
 			allocation_ = other.allocation_;
 
+			staging_ = std::move(other.staging_);
+			uploads_ = other.uploads_;
+			uploadValue_ = other.uploadValue_;
+
 			other.image_ = vk::Image(nullptr);
 			other.allocation_ = VmaAllocation(nullptr);
 
@@ -2968,6 +9989,13 @@ namespace SOULKAN_NAMESPACE
 		{
 			if (destroyed_) { return; }
 
+			if (uploads_ != nullptr)
+			{
+				uploads_->wait(uploadValue_); //Must not destroy the image or its staging while being copied
+				uploads_->discard(image_);
+			}
+			staging_.reset();
+			allocator_.get().untrack(MemoryTag::IMAGE, allocation_);
 			vmaDestroyImage(allocator_.get().vma(), image_, allocation_);
 
 			destroyed_ = true;
@@ -2978,11 +10006,31 @@ namespace SOULKAN_NAMESPACE
 			if (manual_) { return; }
 			destroy();
 		}
+
+		//Timeline semaphore and value reached once the pixels are copied, for the submits sampling the image (see UploadScheduler::submit)
+		std::pair<vk::Semaphore, uint64_t> uploadSignal()
+		{
+			if (uploads_ == nullptr) { return std::make_pair(vk::Semaphore(nullptr), 0); }
+
+			return std::make_pair(uploads_->signal().first, uploadValue_);
+		}
+
+		//Frees the staging memory once the copy is finished, returns whether it is
+		bool releaseStaging()
+		{
+			if (staging_ != nullptr && uploads_->completedValue() >= uploadValue_) { staging_.reset(); }
+
+			return staging_ == nullptr;
+		}
 	
 	private:
 		vk::Image image_;
 		ref<Allocator> allocator_;
 		VmaAllocation allocation_;
+
+		std::unique_ptr<StagingBuffer> staging_{};
+		UploadScheduler* uploads_ = nullptr; //nullptr for images not loaded from a file
+		uint64_t uploadValue_ = 0;
 	};
 
 	class Camera
@@ -2990,7 +10038,7 @@ namespace SOULKAN_NAMESPACE
 	public:
 		Camera(ref<Window> window, glm::vec3 position, float fov = 70.f, float movementSpeed = 10.f, float sensitivity = 0.5f)
 			: window_(window), position_(position), fov_(fov), movementSpeed_(movementSpeed), sensitivity_(sensitivity), 
-			projection_(glm::perspective(glm::radians(fov_), (float)(window_.get().width() / window_.get().height()), 0.1f, 200.0f))
+			projection_(glm::perspective(glm::radians(fov_), (float)(window_.get().width() / window_.get().height()), nearPlane_, farPlane_))
 		{
 			projection_[1][1] *= -1;
 		}
@@ -3009,7 +10057,7 @@ namespace SOULKAN_NAMESPACE
 
 		void setAspectRatio(float aspectRatio)
 		{
-			projection_ = glm::perspective(glm::radians(fov_), aspectRatio, 0.1f, 200.0f);
+			projection_ = glm::perspective(glm::radians(fov_), aspectRatio, nearPlane_, farPlane_);
 			projection_[1][1] *= -1;
 		}
 
@@ -3017,6 +10065,28 @@ namespace SOULKAN_NAMESPACE
 		{
 			return view_;
 		}
+
+		//World space frustum of the camera, see MeshInstance::draws
+		Frustum frustum()
+		{
+			return Frustum::fromMatrix(projection_ * view_);
+		}
+
+		glm::vec3 position()
+		{
+			return position_;
+		}
+
+		float nearPlane()
+		{
+			return nearPlane_;
+		}
+
+		//Height of the window in pixels
+		float viewportHeight()
+		{
+			return static_cast<float>(window_.get().height());
+		}
 		
 	private:
 		//TODO:Check vulkan coord system
@@ -3035,6 +10105,9 @@ namespace SOULKAN_NAMESPACE
 		float movementSpeed_;
 		float sensitivity_;
 
+		float nearPlane_ = 0.1f;
+		float farPlane_ = 200.f;
+
 		double lastMouseX_{0};
 		double lastMouseY_{0};
 		bool queryClickedPos = true;
@@ -3149,6 +10222,214 @@ namespace SOULKAN_NAMESPACE
 
 		}
 	};
+
+	void MeshInstance::selectLod(Camera& camera, glm::vec3 position, float scale, float maxPixelError)//Defined after Camera definition
+	{
+		float distance = std::max(glm::length(position - camera.position()), camera.nearPlane());
+
+		//Height in pixels of one world space unit at that distance
+		float pixelsPerUnit = std::abs(camera.projection()[1][1]) * 0.5f * camera.viewportHeight() / distance;
+
+		lod_ = 0;
+		for (size_t lod = 1; lod < lods_.size(); lod++)
+		{
+			if (lods_[lod].second * scale * pixelsPerUnit <= maxPixelError) { lod_ = lod; }
+		}
+	}
+
+	enum class AssetPriority
+	{
+		VISIBLE, //Needed to draw the current frame
+		PREFETCH //Likely needed soon, only loaded once no visible asset is waiting
+	};
+
+	//Bounded pool of loading threads serving prioritized requests, every request returning a future of its asset
+	//INFO:A request only starts if the memory estimates of the requests in flight plus its own stay under the budget, a request bigger than the budget runs alone
+	//Requests are served in order within a priority, the pending ones being dropped on destruction (their futures throw std::future_error)
+	//and the running ones waiting for staging in the buffers given to mesh or scene being cancelled (their futures throw std::runtime_error)
+	//INFO:These buffers must outlive the loader
+	//Non copyable non movable
+	class AssetLoader
+	{
+	public:
+		AssetLoader(uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency() / 2), size_t memoryBudget = 2'000'000'000) : memoryBudget_(memoryBudget)
+		{
+			workers_.reserve(threadCount);
+			for (uint32_t t = 0; t < threadCount; t++)
+			{
+				workers_.push_back(std::thread([this]() { work(); }));
+			}
+		}
+
+		//No copy constructors
+		AssetLoader(const AssetLoader&) = delete;
+		AssetLoader& operator=(const AssetLoader&) = delete;
+
+		~AssetLoader()
+		{
+			{
+				std::scoped_lock lock(mutex_);
+				stop_ = true;
+
+				for (auto& queue : queues_) { queue.clear(); }
+			}
+			requestsChanged_.notify_all();
+
+			//INFO:Nobody is left to upload the staging a streaming request may be waiting for, buffers_ is not modified anymore once stop_ is set
+			for (LocalBuffer* buffer : buffers_) { buffer->cancelStagingWaits(); }
+
+			for (auto& worker : workers_)
+			{
+				worker.join();
+			}
+
+			for (LocalBuffer* buffer : buffers_) { buffer->resumeStagingWaits(); }
+		}
+
+		//Generic request, memoryEstimate being the peak memory function is expected to use while loading
+		template<typename T>
+		std::future<T> load(std::string name, std::function<T()>&& function, AssetPriority priority = AssetPriority::VISIBLE, size_t memoryEstimate = 0)
+		{
+			//INFO:std::function needs a copyable target, the move only packaged_task is shared
+			auto task = std::make_shared<std::packaged_task<T()>>(std::move(function));
+			std::future<T> future = task->get_future();
+
+			{
+				std::scoped_lock lock(mutex_);
+				queues_[static_cast<size_t>(priority)].push_back({ name, memoryEstimate, [task]() { (*task)(); } });
+			}
+			requestsChanged_.notify_one();
+
+			return future;
+		}
+
+		//Staged mesh, see Mesh::objMesh
+		template<typename Layout>
+		std::future<Mesh> mesh(std::string filename, VertexBuffer<Layout>& vertexBuffer, IndexBuffer& indexBuffer, MeshOptions options = {},
+			AssetPriority priority = AssetPriority::VISIBLE)
+		{
+			track({ &vertexBuffer, &indexBuffer });
+			return load<Mesh>(filename, [=, &vertexBuffer, &indexBuffer]() { return Mesh::objMesh(filename, vertexBuffer, indexBuffer, options); },
+				priority, meshMemoryEstimate(filename));
+		}
+
+		std::future<Mesh> mesh(std::string filename, MeshOptions options = {}, AssetPriority priority = AssetPriority::VISIBLE)
+		{
+			return load<Mesh>(filename, [=]() { return Mesh::objMesh(filename, options); }, priority, meshMemoryEstimate(filename));
+		}
+
+		//Whole .glb scene, see Mesh::glbScene
+		//INFO:The binary chunk is mapped rather than copied, the estimate only covers the conversion chunks
+		template<typename Layout>
+		std::future<GlbScene> scene(std::string filename, VertexBuffer<Layout>& vertexBuffer, IndexBuffer& indexBuffer, MatrixBuffer& matrixBuffer,
+			AssetPriority priority = AssetPriority::VISIBLE)
+		{
+			track({ &vertexBuffer, &indexBuffer, &matrixBuffer });
+			return load<GlbScene>(filename, [=, &vertexBuffer, &indexBuffer, &matrixBuffer]() { return Mesh::glbScene(filename, vertexBuffer, indexBuffer, matrixBuffer); },
+				priority, 4096 * sizeof(Vertex));
+		}
+
+		std::future<Image> image(ref<Device> device, ref<Allocator> allocator, std::string filename, vk::Flags<vk::ImageUsageFlagBits> usage,
+			AssetPriority priority = AssetPriority::VISIBLE)
+		{
+			//Decoded RGBA pixels plus their staging copy
+			int width = 0, height = 0, channels = 0;
+			size_t memoryEstimate = stbi_info(filename.c_str(), &width, &height, &channels) ? 2 * size_t(width) * height * 4 : 0;
+
+			return load<Image>(filename, [=]() { return Image(device, allocator, filename, usage); }, priority, memoryEstimate);
+		}
+
+		//Compiles shader in place, it must outlive the request
+		std::future<void> shader(Shader& shader, AssetPriority priority = AssetPriority::VISIBLE)
+		{
+			return load<void>(shader.filename(), [&shader]() { shader.shader(); }, priority);
+		}
+
+		//Requests not started yet
+		size_t pendingCount()
+		{
+			std::scoped_lock lock(mutex_);
+			return queues_[0].size() + queues_[1].size();
+		}
+
+		size_t memoryInFlight()
+		{
+			std::scoped_lock lock(mutex_);
+			return memoryInFlight_;
+		}
+	private:
+		struct Request
+		{
+			std::string name;
+			size_t memoryEstimate;
+			std::function<void()> task;
+		};
+
+		std::vector<std::thread> workers_;
+		std::array<std::deque<Request>, 2> queues_{}; //Indexed by AssetPriority
+
+		std::mutex mutex_;
+		std::condition_variable requestsChanged_; //New request, or memory released by a finished one
+		size_t memoryBudget_;
+		size_t memoryInFlight_ = 0;
+		bool stop_ = false;
+
+		//Buffers requests stage into, see ~AssetLoader
+		std::set<LocalBuffer*> buffers_{};
+
+		void track(std::initializer_list<LocalBuffer*> buffers)
+		{
+			std::scoped_lock lock(mutex_);
+			buffers_.insert(buffers);
+		}
+
+		//INFO:Parsing holds the file, its positions, normals, uvs and face corners, roughly 3 times the size of the .obj
+		static size_t meshMemoryEstimate(std::string filename)
+		{
+			std::error_code error;
+			uintmax_t size = std::filesystem::file_size(filename, error);
+			return error ? 0 : 3 * static_cast<size_t>(size);
+		}
+
+		//Next request allowed to start, nullptr if there is none or if it does not fit in the budget yet
+		std::deque<Request>* next()
+		{
+			for (auto& queue : queues_)
+			{
+				if (queue.empty()) { continue; }
+
+				//INFO:Lower priorities wait behind a visible request that does not fit, they would delay it further
+				bool fits = memoryInFlight_ == 0 || memoryInFlight_ + queue.front().memoryEstimate <= memoryBudget_;
+				return fits ? &queue : nullptr;
+			}
+
+			return nullptr;
+		}
+
+		void work()
+		{
+			std::unique_lock lock(mutex_);
+
+			while (true)
+			{
+				std::deque<Request>* queue = nullptr;
+				requestsChanged_.wait(lock, [&]() { return stop_ || (queue = next()) != nullptr; });
+
+				if (stop_) { return; }
+
+				Request request = std::move(queue->front());
+				queue->pop_front();
+				memoryInFlight_ += request.memoryEstimate;
+
+				lock.unlock();
+				request.task();
+				lock.lock();
+
+				memoryInFlight_ -= request.memoryEstimate;
+				requestsChanged_.notify_all();
+			}
+		}
+	};
 }
 
 
@@ -3195,6 +10476,165 @@ namespace SOULKAN_TEST_NAMESPACE
 		dq.flush();
 	}
 
+	//Compares the native parallel .obj reader (Mesh::objMesh) with the single threaded tinyobj one (Mesh::tinyObjMesh)
+	void obj_loading_bench(std::vector<std::string> filenames = { "lost_empire.obj", "moai.obj" }, uint32_t runs = 3)
+	{
+		for (const auto& filename : filenames)
+		{
+			double tinyObjTime = 0;
+			double soulkanTime = 0;
+
+			std::pair<size_t, size_t> tinyObjCounts = {};
+			std::pair<size_t, size_t> soulkanCounts = {};
+
+			for (uint32_t r = 0; r < runs; r++)
+			{
+				tinyObjTime += SOULKAN_NAMESPACE::timeDiff("", [&]()
+					{
+						SOULKAN_NAMESPACE::Mesh mesh = SOULKAN_NAMESPACE::Mesh::tinyObjMesh(filename);
+						tinyObjCounts = std::make_pair(mesh.vertexCount(), mesh.indexCount());
+					});
+
+				soulkanTime += SOULKAN_NAMESPACE::timeDiff("", [&]()
+					{
+						SOULKAN_NAMESPACE::Mesh mesh = SOULKAN_NAMESPACE::Mesh::objMesh(filename, {}, false);
+						soulkanCounts = std::make_pair(mesh.vertexCount(), mesh.indexCount());
+					});
+			}
+
+			tinyObjTime /= runs;
+			soulkanTime /= runs;
+
+			double fileSize = static_cast<double>(std::filesystem::file_size(filename)) / 1'000'000.0;
+
+			std::cout << std::format("[{}] {} MB, {} threads", filename, fileSize, std::thread::hardware_concurrency()) << std::endl;
+			std::cout << std::format("tinyobj : {} ms ({} MB/s)", tinyObjTime, fileSize / (tinyObjTime / 1000.0)) << std::endl;
+			std::cout << std::format("soulkan : {} ms ({} MB/s), x{}", soulkanTime, fileSize / (soulkanTime / 1000.0), tinyObjTime / soulkanTime) << std::endl;
+
+			if (tinyObjCounts != soulkanCounts)
+			{
+				std::cout << std::format("Readers disagree on [{}]: tinyobj ({} vertices, {} indices), soulkan ({} vertices, {} indices)", filename,
+					tinyObjCounts.first, tinyObjCounts.second, soulkanCounts.first, soulkanCounts.second) << std::endl;
+			}
+		}
+	}
+
+	//Churns mesh sized additions and removals through TlsfAllocator (LocalBuffer elements) and through a first fit over a map of free spaces
+	//(the previous LocalBuffer allocator), printing the throughput and the fragmentation left by both
+	//INFO:Additions are made while the buffer is less than fillRatio full, random elements being removed otherwise
+	void local_buffer_allocator_bench(uint32_t operations = 200'000, vk::DeviceSize bufferSize = 1'000'000'000, float fillRatio = 0.85f)
+	{
+		//Log uniform sizes between 1 KB and 4 MB, vertex aligned
+		auto randomSize = [](std::mt19937_64& random)
+			{
+				std::uniform_real_distribution<double> exponent(10.0, 22.0);
+				return (static_cast<vk::DeviceSize>(std::exp2(exponent(random))) / 32 + 1) * 32;
+			};
+
+		struct Stats
+		{
+			double time = 0;
+			size_t failures = 0;
+			size_t liveCount = 0;
+			vk::DeviceSize freeSize = 0;
+			vk::DeviceSize largestFree = 0;
+		};
+
+		auto churn = [&](auto&& allocate, auto&& free, auto&& largestFree)
+			{
+				std::mt19937_64 random(operations);
+				std::vector<std::pair<vk::DeviceSize, vk::DeviceSize>> live; //(offset, size)
+				vk::DeviceSize used = 0;
+
+				Stats stats = {};
+				stats.time = SOULKAN_NAMESPACE::timeDiff("", [&]()
+					{
+						for (uint32_t o = 0; o < operations; o++)
+						{
+							if (used < bufferSize * fillRatio || live.empty())
+							{
+								vk::DeviceSize size = randomSize(random);
+								vk::DeviceSize offset = allocate(size);
+								if (offset == std::numeric_limits<uint64_t>::max()) { stats.failures++; continue; }
+
+								live.push_back(std::make_pair(offset, size));
+								used += size;
+								continue;
+							}
+
+							size_t removed = std::uniform_int_distribution<size_t>(0, live.size() - 1)(random);
+							free(live[removed].first);
+							used -= live[removed].second;
+
+							live[removed] = live.back();
+							live.pop_back();
+						}
+					});
+
+				stats.liveCount = live.size();
+				stats.freeSize = bufferSize - used;
+				stats.largestFree = largestFree();
+
+				return stats;
+			};
+
+		SOULKAN_NAMESPACE::TlsfAllocator tlsf(bufferSize, 32);
+		Stats tlsfStats = churn([&](vk::DeviceSize size) { return tlsf.allocate(size); }, [&](vk::DeviceSize offset) { tlsf.free(offset); },
+			[&]() { return tlsf.largestFreeBlock(); });
+
+		std::map<vk::DeviceSize, vk::DeviceSize> voids = { { 0, bufferSize } };
+		std::map<vk::DeviceSize, vk::DeviceSize> allocations;
+		Stats firstFitStats = churn([&](vk::DeviceSize size)
+			{
+				for (auto v = voids.begin(); v != voids.end(); v++)
+				{
+					if (v->second < size) { continue; }
+
+					auto [offset, voidSize] = *v;
+					voids.erase(v);
+					if (voidSize > size) { voids[offset + size] = voidSize - size; }
+					allocations[offset] = size;
+
+					return offset;
+				}
+
+				return std::numeric_limits<uint64_t>::max();
+			},
+			[&](vk::DeviceSize offset)
+			{
+				auto allocation = allocations.find(offset);
+				vk::DeviceSize size = allocation->second;
+				allocations.erase(allocation);
+
+				auto next = voids.find(offset + size);
+				if (next != voids.end()) { size += next->second; voids.erase(next); }
+
+				auto previous = voids.lower_bound(offset);
+				if (previous != voids.begin() && std::prev(previous)->first + std::prev(previous)->second == offset)
+				{
+					std::prev(previous)->second += size;
+					return;
+				}
+
+				voids[offset] = size;
+			},
+			[&]()
+			{
+				vk::DeviceSize largest = 0;
+				for (const auto& v : voids) { largest = std::max(largest, v.second); }
+
+				return largest;
+			});
+
+		std::cout << std::format("{} operations on a {} MB buffer filled up to {}%", operations, bufferSize / 1'000'000, fillRatio * 100.f) << std::endl;
+		for (const auto& [name, stats] : { std::make_pair("tlsf", tlsfStats), std::make_pair("first fit", firstFitStats) })
+		{
+			double fragmentation = (stats.freeSize == 0) ? 0.0 : 1.0 - static_cast<double>(stats.largestFree) / static_cast<double>(stats.freeSize);
+			std::cout << std::format("{} : {} ms ({} Mops/s), {} failed allocations, {} live elements, fragmentation {}", name, stats.time,
+				operations / (stats.time * 1000.0), stats.failures, stats.liveCount, fragmentation) << std::endl;
+		}
+	}
+
 	void triangle_test()
 	{
 		SOULKAN_NAMESPACE::DeletionQueue dq;
@@ -3216,6 +10656,10 @@ namespace SOULKAN_TEST_NAMESPACE
 		SOULKAN_NAMESPACE::Device device(physicalDevice, window, surface);
 
 		SOULKAN_NAMESPACE::Allocator allocator(instance, device);
+		allocator.onBudgetPressure([](uint32_t heap, const SOULKAN_NAMESPACE::HeapStats& stats)
+			{
+				std::cout << std::format("Heap {} at {} / {} MB of its budget", heap, stats.usage / 1'000'000, stats.budget / 1'000'000) << std::endl;
+			});
 
 		SOULKAN_NAMESPACE::Swapchain swapchain(device);
 
@@ -3226,91 +10670,116 @@ namespace SOULKAN_TEST_NAMESPACE
 		SOULKAN_NAMESPACE::CommandBuffer commandBuffer = graphicsCommandPool.allocate();
 		SOULKAN_NAMESPACE::Queue graphicsQueue = device.queue(SOULKAN_NAMESPACE::QueueFamilyCapability::GRAPHICS, 0);
 
-		std::string lostEmpireMeshLoading = "lostEmpireMeshLoading";
-		std::string moaiMeshLoading = "moaiMeshLoading";
-		std::string vertShaderCompilation = "vertShaderCompilation";
-		std::string fragShaderCompilation = "fragShaderCompilation";
-		std::string lostEmpireImageLoading = "lostEmpireImageLoading";
-		std::map<std::string, bool> operationsStatus{ {lostEmpireMeshLoading, false}, {moaiMeshLoading, false},
-														{vertShaderCompilation, false}, {fragShaderCompilation, false},
-														{lostEmpireImageLoading, false} };
-
-		SOULKAN_NAMESPACE::Mesh mesh;
-		SOULKAN_NAMESPACE::detachThreadNotify([&]() { SOULKAN_NAMESPACE::timeDiff("Lost empire mesh loading", [&]() {mesh = SOULKAN_NAMESPACE::Mesh::objMesh("lost_empire.obj"); }); },
-			operationsStatus, lostEmpireMeshLoading);
+		//Mesh vertex buffer, quantized vertices (see triangle.vert and the decode matrices below)
+		//INFO:Staging does not have to hold a whole mesh, larger ones are streamed through it
+		//Sized for the usual scenes, growing when a larger one is loaded
+		SOULKAN_NAMESPACE::VertexBuffer<SOULKAN_NAMESPACE::CompactVertex> vertexBuffer(device, allocator, 4'000'000 * sizeof(SOULKAN_NAMESPACE::CompactVertex), 16'000'000);
+		vertexBuffer.growth(1.5f);
 
-		SOULKAN_NAMESPACE::Mesh mesh2;
-		SOULKAN_NAMESPACE::detachThreadNotify([&]() { SOULKAN_NAMESPACE::timeDiff("Moai mesh loading", [&]() {mesh2 = SOULKAN_NAMESPACE::Mesh::objMesh("moai.obj"); }); },
-			operationsStatus, moaiMeshLoading);
+		//Mesh index buffer
+		SOULKAN_NAMESPACE::IndexBuffer indexBuffer(device, allocator, 4'000'000 * sizeof(uint32_t), 16'000'000);
+		indexBuffer.growth(1.5f);
 
-		SOULKAN_NAMESPACE::Image lostEmpireImage(allocator);
-		SOULKAN_NAMESPACE::detachThreadNotify([&]() {SOULKAN_NAMESPACE::timeDiff("Lost empire image loading", [&]() {lostEmpireImage = SOULKAN_NAMESPACE::Image(device, allocator, "lost_empire-RGBA.png", vk::ImageUsageFlagBits::eSampled); }); },
-			operationsStatus, lostEmpireImageLoading);
+		SOULKAN_NAMESPACE::MeshStream lostEmpireStream;
 
 		SOULKAN_NAMESPACE::Shader vertShader(device, "triangle.vert", vk::ShaderStageFlagBits::eVertex);
-		SOULKAN_NAMESPACE::detachThreadNotify([&]() {SOULKAN_NAMESPACE::timeDiff("Vertex shader compilation", [&]() {vertShader.shader(); }); },
-			operationsStatus, vertShaderCompilation);
+		vertShader.vertexLayout<SOULKAN_NAMESPACE::CompactVertex>();
 
-		SOULKAN_NAMESPACE::Shader fragShader(device, "triangle.frag", vk::ShaderStageFlagBits::eFragment);;
-		SOULKAN_NAMESPACE::detachThreadNotify([&]() {SOULKAN_NAMESPACE::timeDiff("Fragment shader compilation", [&]() {fragShader.shader(); }); },
-			operationsStatus, fragShaderCompilation);
+		SOULKAN_NAMESPACE::Shader fragShader(device, "triangle.frag", vk::ShaderStageFlagBits::eFragment);
 
-		//Mesh vertex buffer
-		SOULKAN_NAMESPACE::VertexBuffer vertexBuffer(device, allocator, 15'625'000 * sizeof(SOULKAN_NAMESPACE::Vertex), 100'000'000);
+		//INFO:Declared after everything its requests reference, its workers are joined before those are destroyed
+		SOULKAN_NAMESPACE::AssetLoader loader;
 
+		//Meshes are written straight into the staging memory of both buffers
+		std::future<SOULKAN_NAMESPACE::Mesh> moaiMesh = loader.mesh("moai.obj", vertexBuffer, indexBuffer, { .lods = 3, .optimize = true });
+		std::future<void> vertShaderCompilation = loader.shader(vertShader);
+		std::future<void> fragShaderCompilation = loader.shader(fragShader);
+		std::future<SOULKAN_NAMESPACE::Image> lostEmpireImageLoading = loader.image(device, allocator, "lost_empire-RGBA.png", vk::ImageUsageFlagBits::eSampled,
+			SOULKAN_NAMESPACE::AssetPriority::PREFETCH);
 
-		SOULKAN_NAMESPACE::waitingForOperation(operationsStatus, "lostEmpireMeshLoading", true);
-		SOULKAN_NAMESPACE::waitingForOperation(operationsStatus, "moaiMeshLoading");
-		vertexBuffer.add(mesh.name(), mesh.data(), mesh.size());
-		vertexBuffer.add(mesh2.name(), mesh2.data(), mesh2.size());
+		SOULKAN_NAMESPACE::Mesh mesh2;
+		SOULKAN_NAMESPACE::timeDiff("Moai mesh loading", [&]() {mesh2 = moaiMesh.get(); });
 
 		vertexBuffer.upload();
+		indexBuffer.upload();
 
-		//Mesh matrix buffer
-		SOULKAN_NAMESPACE::MatrixBuffer meshMatrixBuffer(device, allocator, 1'000 * sizeof(glm::mat4));
-		
-		glm::mat4 identityMat = glm::mat4(1.f);
-		meshMatrixBuffer.add("identity", &identityMat, sizeof(glm::mat4));
+		//Lost empire is drawn block after block while it streams, uploads happening in the render loop
+		SOULKAN_NAMESPACE::Mesh mesh;
+		std::future<SOULKAN_NAMESPACE::Mesh> lostEmpireMesh = loader.load<SOULKAN_NAMESPACE::Mesh>("lost_empire.obj", [&]()
+			{
+				return SOULKAN_NAMESPACE::Mesh::streamObjMesh("lost_empire.obj", vertexBuffer, indexBuffer, lostEmpireStream);
+			});
+		bool lostEmpireStreaming = true;
 
-		meshMatrixBuffer.add("rotatingSomewhere1", &identityMat, sizeof(glm::mat4));
-		meshMatrixBuffer.add("rotatingSomewhere2", &identityMat, sizeof(glm::mat4));
-		meshMatrixBuffer.add("rotatingSomewhere3", &identityMat, sizeof(glm::mat4));
-		meshMatrixBuffer.add("rotatingSomewhere4", &identityMat, sizeof(glm::mat4));
+		//Positions are stored normalized to the mesh bounds
+		glm::mat4 lostEmpireDecode = glm::mat4(1.f); //Known once the stream has started
+		glm::mat4 moaiDecode = SOULKAN_NAMESPACE::CompactVertex::decodeMatrix(mesh2.bounds());
 
-		meshMatrixBuffer.upload();
+		//Mesh matrix buffer, matrices being written in place every frame
+		SOULKAN_NAMESPACE::DynamicMatrixBuffer meshMatrixBuffer(device, allocator, 1'000);
 
-		std::vector<SOULKAN_NAMESPACE::MeshInstance> meshInstances{};
-		meshInstances.push_back(SOULKAN_NAMESPACE::MeshInstance("sponza1",
-							    SOULKAN_NAMESPACE::BufferView(vertexBuffer, vertexBuffer.mesh("lost_empire.obj")),
-							    SOULKAN_NAMESPACE::BufferView(meshMatrixBuffer, meshMatrixBuffer.matrix("identity"))));
+		constexpr size_t identityMatrix = 0;
+		constexpr std::array<size_t, 4> rotatingMatrices = { 1, 2, 3, 4 };
 
+		std::vector<SOULKAN_NAMESPACE::MeshInstance> meshInstances{};
 		meshInstances.push_back(SOULKAN_NAMESPACE::MeshInstance("moai1",
 							    SOULKAN_NAMESPACE::BufferView(vertexBuffer, vertexBuffer.mesh("moai.obj")),
-							    SOULKAN_NAMESPACE::BufferView(meshMatrixBuffer, meshMatrixBuffer.matrix("rotatingSomewhere1"))));
+							    SOULKAN_NAMESPACE::BufferView(indexBuffer, indexBuffer.mesh("moai.obj")), indexBuffer.type("moai.obj"),
+							    SOULKAN_NAMESPACE::BufferView(meshMatrixBuffer, rotatingMatrices[0], 1)));
 
 		meshInstances.push_back(SOULKAN_NAMESPACE::MeshInstance("moai2",
 							    SOULKAN_NAMESPACE::BufferView(vertexBuffer, vertexBuffer.mesh("moai.obj")),
-							    SOULKAN_NAMESPACE::BufferView(meshMatrixBuffer, meshMatrixBuffer.matrix("rotatingSomewhere2"))));
+							    SOULKAN_NAMESPACE::BufferView(indexBuffer, indexBuffer.mesh("moai.obj")), indexBuffer.type("moai.obj"),
+							    SOULKAN_NAMESPACE::BufferView(meshMatrixBuffer, rotatingMatrices[1], 1)));
 
 		meshInstances.push_back(SOULKAN_NAMESPACE::MeshInstance("moai3",
 							    SOULKAN_NAMESPACE::BufferView(vertexBuffer, vertexBuffer.mesh("moai.obj")),
-							    SOULKAN_NAMESPACE::BufferView(meshMatrixBuffer, meshMatrixBuffer.matrix("rotatingSomewhere3"))));
+							    SOULKAN_NAMESPACE::BufferView(indexBuffer, indexBuffer.mesh("moai.obj")), indexBuffer.type("moai.obj"),
+							    SOULKAN_NAMESPACE::BufferView(meshMatrixBuffer, rotatingMatrices[2], 1)));
 
 		meshInstances.push_back(SOULKAN_NAMESPACE::MeshInstance("moai4",
 							    SOULKAN_NAMESPACE::BufferView(vertexBuffer, vertexBuffer.mesh("moai.obj")),
-							    SOULKAN_NAMESPACE::BufferView(meshMatrixBuffer, meshMatrixBuffer.matrix("rotatingSomewhere4"))));
+							    SOULKAN_NAMESPACE::BufferView(indexBuffer, indexBuffer.mesh("moai.obj")), indexBuffer.type("moai.obj"),
+							    SOULKAN_NAMESPACE::BufferView(meshMatrixBuffer, rotatingMatrices[3], 1)));
+
+		//Moai levels of detail, sharing the same vertices
+		for (size_t i = 0; i < meshInstances.size(); i++)
+		{
+			for (size_t lod = 1; lod < mesh2.lodCount(); lod++)
+			{
+				std::string lodName = SOULKAN_NAMESPACE::Mesh::lodName("moai.obj", lod);
+				meshInstances[i].addLod(SOULKAN_NAMESPACE::BufferView(indexBuffer, indexBuffer.mesh(lodName)), mesh2.lodError(lod));
+			}
+		}
+		for (size_t i = 0; i < meshInstances.size(); i++)
+		{
+			meshInstances[i].setBounds(mesh2.bounds(), mesh2.sphere());
+		}
 
+		//Instances follow the meshes moved by defragmentation
+		auto relocateInstances = [&](const std::vector<SOULKAN_NAMESPACE::LocalBuffer::ElementMove>& moves)
+			{
+				for (const auto& move : moves)
+				{
+					for (auto& meshInstance : meshInstances)
+					{
+						meshInstance.relocate(move, sizeof(SOULKAN_NAMESPACE::CompactVertex));
+					}
+				}
+			};
+		vertexBuffer.onRelocation(relocateInstances);
+		indexBuffer.onRelocation(relocateInstances);
 
 
-		std::vector<vk::DeviceAddress> pushConstants{ vertexBuffer.address(), meshMatrixBuffer.address(), meshInstances[0].matrixView().offset()};
+		std::vector<vk::DeviceAddress> pushConstants{ vertexBuffer.address(), meshMatrixBuffer.sliceAddress(), meshInstances[0].matrixView().offset()};
 
 		SOULKAN_NAMESPACE::Fence renderFence(device);
 		SOULKAN_NAMESPACE::Semaphore presentSemaphore(device);
 		SOULKAN_NAMESPACE::Semaphore renderSemaphore(device);
 
 
-		SOULKAN_NAMESPACE::waitingForOperation(operationsStatus, "vertShaderCompilation");
-		SOULKAN_NAMESPACE::waitingForOperation(operationsStatus, "fragShaderCompilation");
+		vertShaderCompilation.get();
+		fragShaderCompilation.get();
 		SOULKAN_NAMESPACE::vec_ref<SOULKAN_NAMESPACE::Shader> shaders{ vertShader, fragShader };
 
 		SOULKAN_NAMESPACE::GraphicsPipeline solidPipelineTmp(device);
@@ -3366,7 +10835,7 @@ namespace SOULKAN_TEST_NAMESPACE
 
 		//std::cout << "Sampler layout size = " << samplerLayoutSize << std::endl;
 
-		SOULKAN_NAMESPACE::waitingForOperations(operationsStatus);
+		SOULKAN_NAMESPACE::Image lostEmpireImage = lostEmpireImageLoading.get();
 
 		while (!glfwWindowShouldClose(window.window()))
 		{
@@ -3378,7 +10847,7 @@ namespace SOULKAN_TEST_NAMESPACE
 			if (status)
 			{
 				std::cout << "Changing pipelines" << std::endl;
-				device.vk().waitIdle(); //MAYB:Use vkQueueWaitIdle instead for better performance ?
+				device.waitIdle(); //MAYB:Use vkQueueWaitIdle instead for better performance ?
 				solidPipeline = std::move(solidPipelineTmp);
 				wireframePipeline = std::move(wireframePipelineTmp);
 
@@ -3393,6 +10862,37 @@ namespace SOULKAN_TEST_NAMESPACE
 
 			camera.update(deltaTime);
 
+			//Lost empire streaming, its instance draws the indices whose vertices and indices have both been uploaded
+			if (lostEmpireStreaming && lostEmpireStream.started())
+			{
+				if (meshInstances.size() == 4)
+				{
+					//INFO:The view covers the whole allocated element, 32 bit indices, the drawn part being set with setIndexCount
+					auto [indexOffset, indexSize] = indexBuffer.mesh("lost_empire.obj", false);
+					meshInstances.push_back(SOULKAN_NAMESPACE::MeshInstance("sponza1",
+											SOULKAN_NAMESPACE::BufferView(vertexBuffer, vertexBuffer.mesh("lost_empire.obj")),
+											SOULKAN_NAMESPACE::BufferView(indexBuffer, indexOffset / sizeof(uint32_t), indexSize / sizeof(uint32_t)), vk::IndexType::eUint32,
+											SOULKAN_NAMESPACE::BufferView(meshMatrixBuffer, identityMatrix, 1)));
+					lostEmpireDecode = SOULKAN_NAMESPACE::CompactVertex::decodeMatrix(lostEmpireStream.bounds());
+				}
+
+				vertexBuffer.upload();
+				indexBuffer.upload();
+
+				size_t drawable = lostEmpireStream.drawableIndexCount(vertexBuffer.streamedSize("lost_empire.obj") / sizeof(SOULKAN_NAMESPACE::CompactVertex),
+																	  indexBuffer.streamedSize("lost_empire.obj") / sizeof(uint32_t));
+				meshInstances[4].setIndexCount(drawable);
+
+				if (lostEmpireMesh.wait_for(std::chrono::seconds(0)) == std::future_status::ready && drawable == lostEmpireStream.indexCount())
+				{
+					mesh = lostEmpireMesh.get();
+					meshInstances[4].setBounds(mesh.bounds(), mesh.sphere());
+					meshInstances[4].setSubmeshes(mesh.submeshes());
+					meshInstances[4].setIndexCount(); //INFO:Submeshes are only culled for instances drawing all their indices
+					lostEmpireStreaming = false;
+				}
+			}
+
 			//model rotation
 			glm::mat4 model = glm::rotate(glm::mat4{ 1.0f }, glm::radians(i * rotationSpeed), glm::vec3(0, 1, 0));
 			//glm::mat4 view = glm::translate(glm::mat4(1.f), camPos);
@@ -3403,19 +10903,21 @@ namespace SOULKAN_TEST_NAMESPACE
 			glm::mat4 view = camera.view();
 
 			//calculate final mesh matrix
-			glm::mat4 meshMatrix = projection * view * glm::mat4{ 1.0f };
-			glm::mat4 meshRotatingMatrix1 = projection * view * glm::translate(model, glm::vec3(3.0, 3.0, 0.0));
-			glm::mat4 meshRotatingMatrix2 = projection * view * glm::translate(model, glm::vec3(-3.0, 3.0, 0.0));
-			glm::mat4 meshRotatingMatrix3 = projection * view * glm::translate(model, glm::vec3(3.0, -3.0, 0.0));
-			glm::mat4 meshRotatingMatrix4 = projection * view * glm::translate(model, glm::vec3(-3.0, -3.0, 0.0));
+			glm::mat4 meshMatrix = projection * view * glm::mat4{ 1.0f } * lostEmpireDecode;
 
-			meshMatrixBuffer.add("identity", &meshMatrix, sizeof(meshMatrix));
-			meshMatrixBuffer.add("rotatingSomewhere1", &meshRotatingMatrix1, sizeof(meshRotatingMatrix1));
-			meshMatrixBuffer.add("rotatingSomewhere2", &meshRotatingMatrix2, sizeof(meshRotatingMatrix2));
-			meshMatrixBuffer.add("rotatingSomewhere3", &meshRotatingMatrix3, sizeof(meshRotatingMatrix3));
-			meshMatrixBuffer.add("rotatingSomewhere4", &meshRotatingMatrix4, sizeof(meshRotatingMatrix4));
+			//INFO:Written straight into the slice of this frame, the frame that read it last has finished (one frame runs ahead, two slices)
+			meshMatrixBuffer.beginFrame();
+			meshMatrixBuffer.write(identityMatrix, meshMatrix);
 
-			meshMatrixBuffer.upload(true);
+			//INFO:The drawn matrix is built from the model of the instance, the one its LOD selection and culling use
+			std::array<glm::vec3, 4> moaiOffsets = { glm::vec3(3.0, 3.0, 0.0), glm::vec3(-3.0, 3.0, 0.0), glm::vec3(3.0, -3.0, 0.0), glm::vec3(-3.0, -3.0, 0.0) };
+			for (size_t m = 0; m < moaiOffsets.size(); m++)
+			{
+				meshInstances[m].setModel(glm::translate(model, moaiOffsets[m]));
+				meshInstances[m].selectLod(camera, meshInstances[m].worldSphere().center);
+				meshMatrixBuffer.write(rotatingMatrices[m], projection * view * meshInstances[m].model() * moaiDecode);
+			}
+			meshMatrixBuffer.flush();
 
 
 
@@ -3425,7 +10927,8 @@ namespace SOULKAN_TEST_NAMESPACE
 			{
 				lastInputTime = glfwGetTime();
 
-				std::thread shaderCompilationThread([&]()
+				//Away from our render loop, status signals the pipelines are ready
+				loader.load<void>("pipelines", [&]()
 					{
 						shaders[0].get().shader();//Vertex
 						shaders[1].get().shader();//Fragment
@@ -3436,8 +10939,6 @@ namespace SOULKAN_TEST_NAMESPACE
 
 						status = true; //Signaling thread has finished
 					});
-
-				shaderCompilationThread.detach(); //Let it do its thing away from our render loop
 			}
 
 
@@ -3477,6 +10978,12 @@ namespace SOULKAN_TEST_NAMESPACE
 			//DRAWING
 			device.waitFence(renderFence);
 			device.resetFence(renderFence);
+			allocator.nextFrame();
+
+			//INFO:No command reads the buffers anymore, old offsets of published moves and buffers replaced by growth can be released
+			constexpr vk::DeviceSize defragmentationBudget = 4'000'000;
+			vertexBuffer.defragment(defragmentationBudget);
+			indexBuffer.defragment(defragmentationBudget);
 
 			uint32_t imageIndex = swapchain.nextImage(presentSemaphore);
 
@@ -3485,6 +10992,9 @@ namespace SOULKAN_TEST_NAMESPACE
 
 			commandBuffer.begin();
 
+			//INFO:Every copy of the frame (buffers, textures) goes in one transfer submit, acquired here when the transfer queue has its own family
+			uint64_t uploadValue = device.uploads().acquire(commandBuffer);
+
 			//INFO:Transitioning image from undefined to attachmentOptimal, this imageLayout is needed to begin rendering
 			commandBuffer.imageLayoutTransition(vk::ImageLayout::eUndefined, vk::ImageLayout::eAttachmentOptimal, swapchain.images()[imageIndex],
 												vk::PipelineStageFlagBits2::eNone, vk::AccessFlagBits2::eNone,
@@ -3495,11 +11005,23 @@ namespace SOULKAN_TEST_NAMESPACE
 			commandBuffer.vk().bindPipeline(vk::PipelineBindPoint::eGraphics, boundPipeline);
 
 			//MeshInstance drawing
+			//INFO:Vertex offset is passed as first instance, the shader fetches vertices at gl_BaseInstance + gl_VertexIndex (index read from the index buffer)
+			//One draw per visible submesh, materials are not bound yet
+			SOULKAN_NAMESPACE::Frustum frustum = camera.frustum();
+			pushConstants[0] = vertexBuffer.address(); //INFO:Changes when the vertex buffer grows
+			pushConstants[1] = meshMatrixBuffer.sliceAddress();
 			for (auto& meshInstance : meshInstances)
 			{
+				std::vector<SOULKAN_NAMESPACE::MeshInstance::DrawRange> draws = meshInstance.draws(frustum);
+				if (draws.empty()) { continue; }
+
 				pushConstants[2] = meshInstance.matrixView().offset();
 				commandBuffer.vk().pushConstants(boundPipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, 2 * sizeof(vk::DeviceAddress) + 1 * sizeof(vk::DeviceSize), pushConstants.data());
-				commandBuffer.vk().draw(meshInstance.meshView().size(), 1, 0, meshInstance.meshView().offset());
+				commandBuffer.vk().bindIndexBuffer(indexBuffer.vk(), 0, meshInstance.indexType());
+				for (auto& draw : draws)
+				{
+					commandBuffer.vk().drawIndexed(draw.indexView.size(), 1, draw.indexView.offset(), 0, meshInstance.meshView().offset());
+				}
 			}
 
 			commandBuffer.endRendering();
@@ -3511,7 +11033,10 @@ namespace SOULKAN_TEST_NAMESPACE
 
 			commandBuffer.end();
 
-			graphicsQueue.submit(commandBuffer, presentSemaphore, renderSemaphore, renderFence);
+			//INFO:The draws wait for the value of the upload submit on the GPU
+			std::array<std::pair<vk::Semaphore, uint64_t>, 1> uploads = { std::make_pair(device.uploads().signal().first, uploadValue) };
+			graphicsQueue.submit(commandBuffer, presentSemaphore, renderSemaphore, renderFence, uploads);
+			lostEmpireImage.releaseStaging();
 
 			graphicsQueue.present(swapchain, renderSemaphore, imageIndex);
 
@@ -5,6 +5,16 @@
 #extension GL_ARB_gpu_shader_int64 : enable
 #extension GL_EXT_scalar_block_layout : enable
 
+//Replaced by the PackedVertex and Vertex structs and the decodeVertex function of the VertexBuffer layout (see Shader::vertexLayout)
+//The Vertex layout stands in between the markers so that the file compiles on its own
+//SOULKAN_VERTEX_LAYOUT
+struct PackedVertex
+{
+	vec3 position;
+	vec3 normal;
+	vec2 uv;
+};
+
 struct Vertex
 {
 	vec3 position;
@@ -12,9 +22,15 @@ struct Vertex
 	vec2 uv;
 };
 
+Vertex decodeVertex(PackedVertex packed)
+{
+	return Vertex(packed.position, packed.normal, packed.uv);
+}
+//SOULKAN_VERTEX_LAYOUT_END
+
 layout(buffer_reference, scalar, buffer_reference_align = 4) readonly buffer Vertices
 {
-	Vertex v[];
+	PackedVertex v[];
 };
 
 layout(buffer_reference, std430, buffer_reference_align = 64) readonly buffer Matrices
@@ -37,9 +53,12 @@ void main()
 	//output the position of each vertex
 	mat4 currentMatrix = constants.matrices.meshMatrices[uint(constants.matrixIndex)];
 
-	vec4 vertexPosition = vec4(constants.vertices.v[gl_BaseInstance + gl_VertexIndex].position, 1.f);
-	vec4 vertexColor = vec4(constants.vertices.v[gl_BaseInstance + gl_VertexIndex].normal, 1.f);
-	vec2 uvCoords = constants.vertices.v[gl_BaseInstance + gl_VertexIndex].uv;
+	//Indexed draw: gl_VertexIndex is the index fetched from the bound index buffer, gl_BaseInstance the mesh offset in the vertex buffer
+	Vertex vertex = decodeVertex(constants.vertices.v[gl_BaseInstance + gl_VertexIndex]);
+
+	vec4 vertexPosition = vec4(vertex.position, 1.f);
+	vec4 vertexColor = vec4(vertex.normal, 1.f);
+	vec2 uvCoords = vertex.uv;
 
 	gl_Position = currentMatrix * vertexPosition;
 